@@ -0,0 +1,88 @@
+#pragma once
+
+#include "AdcSource.h"
+#include "constants.h"
+
+#include <array>
+#include <cstdint>
+
+// Host stand-in for DmaAdcSource with the same ring of ADC_RING_BLOCKS
+// blocks. complete() plays the part of the DMA interrupt and fills the next
+// blocks with synthetic interleaved conversions; completing more than
+// ADC_RING_BLOCKS - 2 blocks between polls overruns the consumer the same
+// way the DMA channels would.
+class SimulatedAdcSource final : public IAdcSource {
+public:
+  // Slow ramp on the light sensor, temperature noise around ~27 degC
+  static uint16_t light_at(const uint32_t tick) {
+    return static_cast<uint16_t>((tick >> 4) & 0x0fff);
+  }
+
+  static uint16_t temperature_at(const uint32_t tick) {
+    return static_cast<uint16_t>(876 + (tick * 2654435761u >> 29));
+  }
+
+  bool start(uint32_t) override {
+    running = true;
+    completed = 0;
+    consumed = 0;
+
+    return true;
+  }
+
+  void stop() override { running = false; }
+
+  [[nodiscard]] AdcBlock acquire() override {
+    if (!running || consumed == completed)
+      return {};
+
+    // As on the device, two blocks always belong to the DMA channels
+    constexpr uint32_t readable = ADC_RING_BLOCKS - 2;
+
+    if (completed - consumed > readable) {
+      overrun_count += completed - consumed - readable;
+      consumed = completed - readable;
+    }
+
+    const auto index = consumed % ADC_RING_BLOCKS;
+
+    return {blocks[index].data(), ADC_BLOCK_SAMPLES, completed_at_us[index]};
+  }
+
+  void release() override {
+    if (consumed != completed) {
+      ++consumed;
+    }
+  }
+
+  [[nodiscard]] uint32_t overruns() const override { return overrun_count; }
+
+  // Completes `count` blocks; one round-robin sequence takes a microsecond.
+  void complete(const uint32_t count) {
+    for (uint32_t n = 0; n < count; ++n) {
+      const auto index = completed % ADC_RING_BLOCKS;
+      auto &block = blocks[index];
+
+      for (size_t i = 0; i < block.size(); i += CHANNELS) {
+        block[i] = light_at(tick);
+        block[i + 1] = temperature_at(tick);
+
+        ++tick;
+      }
+
+      completed_at_us[index] = tick;
+      ++completed;
+    }
+  }
+
+private:
+  std::array<std::array<uint16_t, ADC_BLOCK_SAMPLES>, ADC_RING_BLOCKS>
+      blocks{};
+  std::array<uint64_t, ADC_RING_BLOCKS> completed_at_us{};
+
+  uint32_t completed = 0;
+  uint32_t consumed = 0;
+  uint32_t overrun_count = 0;
+  uint32_t tick = 0;
+  bool running = false;
+};
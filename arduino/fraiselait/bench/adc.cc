@@ -0,0 +1,156 @@
+#include "bench.h"
+
+#include "AdcEngine.h"
+#include "SimulatedAdcSource.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr size_t BLOCKS = 200'000;
+
+int32_t light_total = 0;
+int32_t temperature_total = 0;
+
+void sum_block(const uint16_t *light, const uint16_t *temperature,
+               const size_t count, uint64_t) {
+  for (size_t i = 0; i < count; ++i) {
+    light_total += light[i] >> 2;
+    temperature_total += temperature[i];
+  }
+}
+
+// The per-sample path that loop1 used to run: one boxcar update per reading
+void boxcar(const uint16_t light, const uint16_t temperature) {
+  static std::array<int32_t, ANALOG_READINGS> light_readings{};
+  static std::array<int32_t, ANALOG_READINGS> temperature_readings{};
+  static size_t index = 0;
+
+  light_total += (light >> 2) - light_readings[index];
+  light_readings[index] = light >> 2;
+  temperature_total += temperature - temperature_readings[index];
+  temperature_readings[index] = temperature;
+
+  if (++index >= ANALOG_READINGS) {
+    index = 0;
+  }
+}
+
+void boxcar_block(const uint16_t *light, const uint16_t *temperature,
+                  const size_t count, uint64_t) {
+  for (size_t i = 0; i < count; ++i) {
+    boxcar(light[i], temperature[i]);
+  }
+}
+
+struct Run {
+  std::vector<uint16_t> light;
+  std::vector<uint16_t> temperature;
+  uint64_t completed_at_us;
+};
+
+std::vector<Run> runs;
+
+void record(const uint16_t *light, const uint16_t *temperature,
+            const size_t count, const uint64_t completed_at_us) {
+  runs.push_back({{light, light + count},
+                  {temperature, temperature + count},
+                  completed_at_us});
+}
+
+// Whether the run holds the conversions of ticks [first, first + count)
+bool holds_ticks(const Run &run, const uint32_t first) {
+  for (size_t i = 0; i < run.light.size(); ++i) {
+    if (run.light[i] != SimulatedAdcSource::light_at(first + i) ||
+        run.temperature[i] != SimulatedAdcSource::temperature_at(first + i))
+      return false;
+  }
+
+  return run.completed_at_us == first + run.light.size();
+}
+
+void check_pipeline() {
+  constexpr auto samples = AdcEngine::SAMPLES_PER_CHANNEL;
+  constexpr uint32_t readable = ADC_RING_BLOCKS - 2;
+
+  SimulatedAdcSource source;
+  AdcEngine engine{source, record};
+
+  runs.clear();
+  engine.start(ADC_SAMPLE_RATE_HZ);
+  source.complete(1);
+
+  const bool one = engine.poll() == samples && runs.size() == 1 &&
+                   runs[0].light.size() == samples;
+
+  bench::check("channels de-interleaved, light first",
+               one && holds_ticks(runs[0], 0));
+
+  runs.clear();
+  source.complete(readable);
+
+  bool in_order = engine.poll() == readable * samples &&
+                  runs.size() == readable && engine.overruns() == 0;
+
+  for (uint32_t i = 0; in_order && i < runs.size(); ++i) {
+    in_order = holds_ticks(runs[i], (1 + i) * samples);
+  }
+
+  bench::check("every readable block delivered in order", in_order);
+
+  // A stalled consumer: the oldest blocks are overwritten and counted, the
+  // newest readable ones are still delivered
+  runs.clear();
+  source.complete(readable + 5);
+
+  const bool newest = engine.poll() == readable * samples &&
+                      runs.size() == readable &&
+                      holds_ticks(runs[0], (1 + readable + 5) * samples);
+
+  bench::check("overrun blocks are skipped and counted",
+               newest && engine.overruns() == 5);
+
+  engine.stop();
+}
+
+} // namespace
+
+void bench_adc() {
+  bench::section("adc engine");
+
+  check_pipeline();
+
+  constexpr auto samples = AdcEngine::SAMPLES_PER_CHANNEL;
+
+  SimulatedAdcSource summing_source;
+  AdcEngine summing{summing_source, sum_block};
+
+  summing.start(ADC_SAMPLE_RATE_HZ);
+
+  const auto deinterleave = bench::run("poll + sum (one block)", BLOCKS,
+                                       [&](size_t) {
+                                         summing_source.complete(1);
+                                         summing.poll();
+                                       });
+
+  SimulatedAdcSource boxcar_source;
+  AdcEngine boxcar_engine{boxcar_source, boxcar_block};
+
+  boxcar_engine.start(ADC_SAMPLE_RATE_HZ);
+
+  const auto filtered = bench::run("poll + boxcar (one block)", BLOCKS,
+                                   [&](size_t) {
+                                     boxcar_source.complete(1);
+                                     boxcar_engine.poll();
+                                   });
+
+  bench::do_not_optimize(light_total);
+  bench::do_not_optimize(temperature_total);
+
+  std::printf("  %-48s %10.2f ns/sample\n", "poll + sum",
+              deinterleave / samples);
+  std::printf("  %-48s %10.2f ns/sample\n", "poll + boxcar",
+              filtered / samples);
+}
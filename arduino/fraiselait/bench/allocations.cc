@@ -0,0 +1,28 @@
+#include "bench.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<size_t> allocation_count{0};
+
+} // namespace
+
+size_t bench::allocations() {
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+void *operator new(const size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+  if (void *pointer = std::malloc(size ? size : 1))
+    return pointer;
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "SerialCommunicator.h"
+
+namespace bench {
+
+template <typename T> inline void do_not_optimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Runs fn(i) for i in [0, iterations) after a short warm-up and prints the
+// mean wall time per call.
+template <typename Fn>
+double run(const char *name, const size_t iterations, Fn &&fn) {
+  for (size_t i = 0; i < iterations / 10; ++i) {
+    fn(i);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < iterations; ++i) {
+    fn(i);
+  }
+
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  const double ns_per_op =
+      std::chrono::duration<double, std::nano>(elapsed).count() /
+      static_cast<double>(iterations);
+
+  std::printf("  %-48s %10.2f ns/op\n", name, ns_per_op);
+
+  return ns_per_op;
+}
+
+inline void section(const char *name) { std::printf("\n[%s]\n", name); }
+
+inline void print_per_op(const char *name, const double value,
+                         const char *unit) {
+  std::printf("  %-48s %10.2f %s\n", name, value, unit);
+}
+
+// Checks that failed so far; main() exits non-zero unless this is 0
+inline size_t failed_checks = 0;
+
+inline bool check(const char *name, const bool ok) {
+  std::printf("  %-48s %10s\n", name, ok ? "ok" : "FAILED");
+
+  if (!ok) {
+    failed_checks++;
+  }
+
+  return ok;
+}
+
+// Device capability with nothing to negotiate
+class EmptyCapability final : public ICapability {
+public:
+  static constexpr uint16_t ID = 0x0040;
+
+  [[nodiscard]] uint16_t id() const override { return ID; }
+
+  [[nodiscard]] uint16_t min_size() const override { return 0; }
+
+  void serialize(const pcomm::bytes::Encoder &) const override {}
+
+  bool deserialize(pcomm::bytes::Decoder &) override { return true; }
+};
+
+// One HostHello entry: a capability id and the body the host sends for it
+struct HostCapability {
+  uint16_t id;
+  std::vector<uint8_t> body;
+};
+
+inline pcomm::packets::Packet
+host_hello(const std::vector<HostCapability> &capabilities) {
+  std::vector<uint8_t> payload;
+  const pcomm::bytes::Encoder encoder{payload};
+
+  encoder.push_number(SerialCommunicator::VERSION);
+  encoder.push_number(static_cast<uint8_t>(capabilities.size()));
+
+  for (const auto &capability : capabilities) {
+    encoder.push_number(capability.id);
+    encoder.push_number(static_cast<uint16_t>(capability.body.size()));
+    encoder.push_bytes(capability.body.data(), capability.body.size());
+  }
+
+  return pcomm::packets::Packet{static_cast<uint16_t>(PacketType::HostHello),
+                                std::move(payload)};
+}
+
+inline const pcomm::packets::Packet host_ack{
+    static_cast<uint16_t>(PacketType::HostAck)};
+
+// Calls to the global operator new so far, see allocations.cc
+size_t allocations();
+
+} // namespace bench
+
+void bench_dispatch();
+void bench_core_commands();
+void bench_adc();
+void bench_filters();
+void bench_raw_stream();
+void bench_goodput();
+void bench_compression();
+void bench_crc();
+void bench_protocol();
+void bench_latency();
+void bench_pcm();
+void bench_session();
+void bench_handshake();
+void bench_tx_scheduler();
+void bench_led_animation();
+void bench_command_scheduler();
+void bench_tone_sequence();
+void bench_flow_control();
+void bench_telemetry_stream();
+void bench_delta_telemetry();
+
+// Writes the firmware encoder's output for the host decoder's tests, see
+// README.md
+bool write_compression_fixtures(const char *directory);
@@ -0,0 +1,116 @@
+#include "bench.h"
+
+#include "CommandScheduler.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr size_t ROUNDS = 200'000;
+
+// Commands are told apart by their tone duration
+std::vector<uint32_t> applied;
+
+void record(const CoreCommand &command) {
+  applied.push_back(command.tone.duration);
+}
+
+CoreCommand tone_at(const uint32_t id, const uint64_t at_us) {
+  auto command = CoreCommand::play_tone({440.f, 1.f, id});
+
+  command.execute_at_us = at_us;
+
+  return command;
+}
+
+void check_due_times() {
+  CommandScheduler scheduler{record};
+
+  applied.clear();
+
+  scheduler.submit(tone_at(1, CoreCommand::IMMEDIATE), 5'000);
+  scheduler.submit(tone_at(2, 4'000), 5'000);
+
+  bench::check("immediate and past-due apply on submit",
+               applied == std::vector<uint32_t>{1, 2} &&
+                   scheduler.pending() == 0);
+
+  applied.clear();
+
+  scheduler.submit(tone_at(3, 6'000), 5'000);
+  scheduler.poll(5'999);
+
+  const bool early = applied.empty();
+
+  scheduler.poll(6'000);
+
+  bench::check("held until due, applied at due time",
+               early && applied == std::vector<uint32_t>{3});
+
+  scheduler.submit(tone_at(4, 7'000), 6'000);
+  scheduler.poll(7'250);
+
+  bench::check("lateness is measured at apply time",
+               scheduler.stats().max_lateness_us == 250);
+}
+
+void check_ordering() {
+  CommandScheduler scheduler{record};
+
+  applied.clear();
+
+  // Submitted out of order; 3 and 4 share a due time
+  scheduler.submit(tone_at(1, 300), 0);
+  scheduler.submit(tone_at(2, 100), 0);
+  scheduler.submit(tone_at(3, 200), 0);
+  scheduler.submit(tone_at(4, 200), 0);
+
+  scheduler.poll(1'000);
+
+  bench::check("applied in due order, ties in submit order",
+               applied == std::vector<uint32_t>{2, 3, 4, 1});
+
+  applied.clear();
+
+  scheduler.submit(tone_at(5, 2'000), 1'000);
+  scheduler.submit(CoreCommand::clear_schedule(), 1'000);
+  scheduler.poll(3'000);
+
+  bench::check("ClearSchedule drops pending commands",
+               applied.empty() && scheduler.pending() == 0);
+
+  for (uint32_t i = 0; i <= SCHEDULED_COMMAND_CAPACITY; ++i) {
+    scheduler.submit(tone_at(i, 10'000 + i), 3'000);
+  }
+
+  bench::check("a full heap drops and counts",
+               scheduler.pending() == SCHEDULED_COMMAND_CAPACITY &&
+                   scheduler.stats().dropped == 1);
+}
+
+} // namespace
+
+void bench_command_scheduler() {
+  bench::section("CommandScheduler");
+
+  check_due_times();
+  check_ordering();
+
+  CommandScheduler scheduler{[](const CoreCommand &command) {
+    bench::do_not_optimize(command);
+  }};
+
+  // Keeps SCHEDULED_COMMAND_CAPACITY / 2 pending and applies one per round
+  constexpr uint64_t PENDING = SCHEDULED_COMMAND_CAPACITY / 2;
+
+  for (uint64_t i = 1; i <= PENDING; ++i) {
+    scheduler.submit(tone_at(0, i), 0);
+  }
+
+  bench::run("submit + poll, 32 pending", ROUNDS, [&](const size_t i) {
+    scheduler.submit(tone_at(0, i + 1 + PENDING), i);
+    scheduler.poll(i + 1);
+  });
+}
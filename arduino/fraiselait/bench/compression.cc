@@ -0,0 +1,256 @@
+#include "bench.h"
+
+#include "Compression.h"
+#include "RawSampleStream.h"
+#include "codecs.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t ITERATIONS = 20'000;
+
+template <typename T> void put_le(std::vector<uint8_t> &out, const T value) {
+  uint8_t bytes[sizeof(T)];
+
+  std::memcpy(bytes, &value, sizeof(T));
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+uint32_t noise(const uint32_t i) { return (i * 2654435761u) >> 29; }
+
+// ResponseDataStream body: 32 samples 1 ms apart of a dim, slowly changing
+// room with some ADC noise
+std::vector<uint8_t> telemetry_batch() {
+  std::vector<uint8_t> out;
+
+  put_le<uint32_t>(out, 1234);
+  put_le<uint32_t>(out, 0);
+  put_le<uint64_t>(out, 987'654'321);
+  put_le<uint8_t>(out, 32);
+
+  for (uint32_t i = 0; i < 32; ++i) {
+    put_le<uint32_t>(out, i * 1000 + noise(i) % 3);
+    put_le<uint8_t>(out, i > 20);
+    put_le<int32_t>(out, 310 + static_cast<int32_t>(noise(i + 7) % 3));
+    put_le<float>(out, 27.4f + static_cast<float>(noise(i + 3) % 2) * 0.5f);
+  }
+
+  return out;
+}
+
+// ResponseRawStream body: a 50 Hz flicker on top of ambient light
+std::vector<uint8_t> raw_block() {
+  std::vector<uint8_t> out(RawSampleBlock::HEADER_SIZE);
+
+  for (uint32_t i = 0; i < RAW_BLOCK_SAMPLES; i += 2) {
+    uint16_t pair[2];
+
+    for (uint32_t j = 0; j < 2; ++j) {
+      const auto t = static_cast<float>(i + j) / 20'000.f;
+
+      pair[j] = static_cast<uint16_t>(
+          1800 + 120 * std::sin(2 * 3.14159265f * 50 * t) + noise(i + j));
+    }
+
+    out.push_back(static_cast<uint8_t>(pair[0]));
+    out.push_back(static_cast<uint8_t>((pair[0] >> 8) | (pair[1] << 4)));
+    out.push_back(static_cast<uint8_t>(pair[1] >> 4));
+  }
+
+  return out;
+}
+
+// Reference decoders, kept here so the bench can check round trips
+
+std::vector<uint8_t> lz_decompress(const uint8_t *in, const size_t size) {
+  std::vector<uint8_t> out;
+  size_t position = 0;
+
+  const auto read_length = [&](size_t length) {
+    if (length != 15)
+      return length;
+
+    uint8_t byte;
+
+    do {
+      byte = in[position++];
+      length += byte;
+    } while (byte == 255);
+
+    return length;
+  };
+
+  while (position < size) {
+    const auto token = in[position++];
+    const auto literal_length = read_length(token >> 4);
+
+    out.insert(out.end(), in + position, in + position + literal_length);
+    position += literal_length;
+
+    if (position >= size)
+      break;
+
+    const size_t offset = in[position] | in[position + 1] << 8;
+
+    position += 2;
+
+    const auto match_length = read_length(token & 0x0f) + 4;
+    const auto start = out.size() - offset;
+
+    for (size_t i = 0; i < match_length; ++i) {
+      out.push_back(out[start + i]);
+    }
+  }
+
+  return out;
+}
+
+std::vector<uint8_t> adc12_delta_decompress(const uint8_t *in,
+                                            const size_t size,
+                                            const size_t raw_size,
+                                            const size_t prefix) {
+  std::vector<uint8_t> out(in, in + prefix);
+  size_t position = prefix;
+  int32_t previous = 0;
+
+  const auto read_sample = [&] {
+    uint32_t value = 0;
+
+    for (uint8_t shift = 0;; shift += 7) {
+      const auto byte = in[position++];
+
+      value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+
+      if (!(byte & 0x80))
+        break;
+    }
+
+    previous += static_cast<int32_t>(value >> 1) ^
+                -static_cast<int32_t>(value & 1);
+
+    return static_cast<uint16_t>(previous);
+  };
+
+  for (size_t i = 0; i < (raw_size - prefix) / 3; ++i) {
+    const auto first = read_sample();
+    const auto second = read_sample();
+
+    out.push_back(static_cast<uint8_t>(first));
+    out.push_back(static_cast<uint8_t>((first >> 8) | (second << 4)));
+    out.push_back(static_cast<uint8_t>(second >> 4));
+  }
+
+  out.insert(out.end(), in + position, in + size);
+
+  return out;
+}
+
+void report(const char *name, const std::vector<uint8_t> &input,
+            const size_t encoded_size, const double ns_per_frame,
+            const bool round_trip) {
+  std::printf("  %-30s %6zu -> %6zu  %5.1f%%  %6.2f ns/B  %s\n", name,
+              input.size(), encoded_size,
+              100.0 * static_cast<double>(encoded_size) /
+                  static_cast<double>(input.size()),
+              ns_per_frame / static_cast<double>(input.size()),
+              round_trip ? "ok" : "MISMATCH");
+
+  if (!round_trip) {
+    bench::failed_checks++;
+  }
+}
+
+void run_lz(const char *name, const std::vector<uint8_t> &input) {
+  static compression::LzTable table;
+  std::vector<uint8_t> out(input.size());
+  size_t encoded = 0;
+
+  const auto ns = bench::run(name, ITERATIONS, [&](size_t) {
+    encoded = compression::lz_compress(input.data(), input.size(), out.data(),
+                                       out.size(), table);
+    bench::do_not_optimize(encoded);
+  });
+
+  report(name, input, encoded, ns,
+         encoded != 0 && lz_decompress(out.data(), encoded) == input);
+}
+
+void run_adc12_delta(const char *name, const std::vector<uint8_t> &input) {
+  std::vector<uint8_t> out(input.size());
+  size_t encoded = 0;
+
+  const auto ns = bench::run(name, ITERATIONS, [&](size_t) {
+    encoded = compression::adc12_delta_compress(
+        input.data(), input.size(), RawSampleBlock::HEADER_SIZE, out.data(),
+        out.size());
+    bench::do_not_optimize(encoded);
+  });
+
+  report(name, input, encoded, ns,
+         encoded != 0 &&
+             adc12_delta_decompress(out.data(), encoded, input.size(),
+                                    RawSampleBlock::HEADER_SIZE) == input);
+}
+
+bool write_file(const std::string &path, const uint8_t *data,
+                const size_t size) {
+  auto *file = std::fopen(path.c_str(), "wb");
+
+  if (!file)
+    return false;
+
+  const bool written = std::fwrite(data, 1, size, file) == size;
+
+  return std::fclose(file) == 0 && written;
+}
+
+// Writes <name>.bin with the raw body and <name>.<codec>.bin with the
+// CompressedData body after the data code, as Compressor produces it for a
+// host that decodes every codec
+bool write_fixture(const std::string &name, const char *codec,
+                   const std::vector<uint8_t> &raw,
+                   const CompressionHint hint) {
+  static CompressionCapability capability;
+  static Compressor compressor{capability};
+
+  const std::vector<uint8_t> codecs{0xff};
+  pcomm::bytes::Decoder decoder{codecs.data(), codecs.size()};
+
+  capability.deserialize(decoder);
+
+  const auto size = compressor.compress(raw.data(), raw.size(), hint);
+
+  return size != 0 && write_file(name + ".bin", raw.data(), raw.size()) &&
+         write_file(name + "." + codec + ".bin", compressor.data(), size);
+}
+
+} // namespace
+
+bool write_compression_fixtures(const char *directory) {
+  const std::string telemetry = std::string{directory} + "/telemetry";
+  const std::string raw = std::string{directory} + "/raw_block";
+
+  return write_fixture(telemetry, "lz", telemetry_batch(),
+                       {CompressionCodec::Lz}) &&
+         write_fixture(raw, "lz", raw_block(), {CompressionCodec::Lz}) &&
+         write_fixture(raw, "adc12", raw_block(),
+                       {CompressionCodec::Adc12Delta,
+                        RawSampleBlock::HEADER_SIZE});
+}
+
+void bench_compression() {
+  bench::section("compression (per frame, then size and ns/byte)");
+
+  const auto telemetry = telemetry_batch();
+  const auto raw = raw_block();
+
+  run_lz("lz telemetry batch", telemetry);
+  run_lz("lz raw block", raw);
+  run_adc12_delta("adc12 delta raw block", raw);
+}
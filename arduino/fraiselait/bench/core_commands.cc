@@ -0,0 +1,107 @@
+#include "bench.h"
+
+#include "CoreCommand.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+constexpr uint32_t COMMANDS = 2'000'000;
+
+// Every field carries the sequence number so a torn record shows up as a
+// mismatch between fields.
+CoreCommand make_command(const uint32_t sequence) {
+  return CoreCommand::play_tone({static_cast<float>(sequence & 0xffffff),
+                                 static_cast<float>(sequence & 0xffffff),
+                                 sequence});
+}
+
+bool is_consistent(const CoreCommand &command, const uint32_t sequence) {
+  return command.type == CoreCommandType::Tone &&
+         command.tone.duration == sequence &&
+         command.tone.frequency == static_cast<float>(sequence & 0xffffff) &&
+         command.tone.volume == static_cast<float>(sequence & 0xffffff);
+}
+
+// Spin briefly, then sleep so the benchmark still makes progress when both
+// threads share a single CPU.
+void back_off(uint32_t &spins) {
+  if (++spins < 64) {
+    std::this_thread::yield();
+
+    return;
+  }
+
+  spins = 0;
+
+  std::this_thread::sleep_for(std::chrono::microseconds(10));
+}
+
+} // namespace
+
+void bench_core_commands() {
+  bench::section("core commands");
+
+  CoreCommandQueue queue;
+
+  uint32_t full_retries = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+
+  std::thread producer([&] {
+    uint32_t spins = 0;
+
+    for (uint32_t sequence = 0; sequence < COMMANDS;) {
+      if (queue.push(make_command(sequence))) {
+        sequence++;
+      } else {
+        full_retries++;
+
+        back_off(spins);
+      }
+    }
+  });
+
+  std::thread consumer([&] {
+    CoreCommand command;
+    uint32_t spins = 0;
+
+    for (uint32_t expected = 0; expected < COMMANDS;) {
+      if (!queue.pop(command)) {
+        back_off(spins);
+
+        continue;
+      }
+
+      if (!is_consistent(command, expected)) {
+        std::fprintf(stderr,
+                     "core command queue corrupted at %u (duration %u)\n",
+                     expected, command.tone.duration);
+        std::abort();
+      }
+
+      expected++;
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  const double ns_per_command =
+      std::chrono::duration<double, std::nano>(elapsed).count() / COMMANDS;
+
+  std::printf("  %-48s %10.2f ns/op\n", "2-thread push/pop, verified",
+              ns_per_command);
+  std::printf("  %-48s %10u\n", "full queue retries", full_retries);
+  std::printf("  %-48s %10u\n", "overflows counted", queue.overflows());
+
+  if (queue.overflows() != full_retries) {
+    std::fprintf(stderr, "overflow accounting mismatch\n");
+    std::abort();
+  }
+}
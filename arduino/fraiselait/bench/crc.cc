@@ -0,0 +1,109 @@
+#include "bench.h"
+
+#include "CrcCopy.h"
+#include "crc16.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr size_t BUFFER_SIZE = 1024;
+constexpr size_t ITERATIONS = 20'000;
+
+// Straight from the definition, one bit at a time
+uint16_t crc16_bitwise(const uint8_t *data, const size_t size) {
+  uint16_t crc = 0x0000;
+
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= static_cast<uint16_t>(data[i] << 8);
+
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                           : static_cast<uint16_t>(crc << 1);
+    }
+  }
+
+  return crc;
+}
+
+// SoftwareCrcCopy fed in pieces of varying size, like chunks spanning
+// several segments
+bool incremental_matches(const uint8_t *data, const size_t size,
+                         const uint32_t seed) {
+  std::array<uint8_t, BUFFER_SIZE> out{};
+  SoftwareCrcCopy crc;
+
+  crc.begin();
+
+  for (size_t offset = 0, step = seed % 7; offset < size;
+       step = (step * 5 + 3) % 41) {
+    const auto take = std::min(step + 1, size - offset);
+
+    crc.copy(out.data() + offset, data + offset, take);
+    offset += take;
+  }
+
+  return crc.finish() == crc16_bitwise(data, size) &&
+         std::memcmp(out.data(), data, size) == 0;
+}
+
+} // namespace
+
+void bench_crc() {
+  bench::section("crc16 (per 1 KiB)");
+
+  std::array<uint8_t, BUFFER_SIZE> data{};
+  std::array<uint8_t, BUFFER_SIZE> out{};
+
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>((i * 2654435761u) >> 24);
+  }
+
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  bool identical = crc16::compute(check, sizeof(check)) == 0x31c3;
+
+  for (size_t size = 0; size <= data.size(); size += 13) {
+    identical = identical &&
+                crc16::compute(data.data(), size) ==
+                    crc16_bitwise(data.data(), size) &&
+                incremental_matches(data.data(), size,
+                                    static_cast<uint32_t>(size));
+  }
+
+  const auto bitwise = bench::run("bitwise reference", ITERATIONS, [&](size_t) {
+    bench::do_not_optimize(crc16_bitwise(data.data(), data.size()));
+  });
+
+  const auto table = bench::run("crc16::compute (table)", ITERATIONS,
+                                [&](size_t) {
+                                  bench::do_not_optimize(crc16::compute(
+                                      data.data(), data.size()));
+                                });
+
+  const auto copy = bench::run("memcpy only", ITERATIONS, [&](size_t) {
+    std::memcpy(out.data(), data.data(), data.size());
+    bench::do_not_optimize(out);
+  });
+
+  SoftwareCrcCopy software;
+
+  const auto fused = bench::run("SoftwareCrcCopy (copy + crc)", ITERATIONS,
+                                [&](size_t) {
+                                  software.begin();
+                                  software.copy(out.data(), data.data(),
+                                                data.size());
+                                  bench::do_not_optimize(software.finish());
+                                });
+
+  std::printf("  %-48s %10.3f ns/byte\n", "bitwise reference",
+              bitwise / BUFFER_SIZE);
+  std::printf("  %-48s %10.3f ns/byte\n", "table", table / BUFFER_SIZE);
+  std::printf("  %-48s %10.3f ns/byte\n", "memcpy", copy / BUFFER_SIZE);
+  std::printf("  %-48s %10.3f ns/byte\n", "SoftwareCrcCopy",
+              fused / BUFFER_SIZE);
+  bench::check("table and incremental match bitwise", identical);
+}
@@ -0,0 +1,198 @@
+#include "bench.h"
+
+#include "DeltaTelemetry.h"
+#include "TelemetryStream.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <pico/time.h>
+#include <vector>
+
+namespace {
+
+constexpr size_t ROUNDS = 1'000'000;
+constexpr uint16_t KEYFRAME_INTERVAL = 8;
+constexpr int32_t LIGHT_DEADBAND = 4;
+constexpr float TEMP_DEADBAND = 0.25f;
+
+constexpr uint8_t ALL = DeltaEncoder::KEYFRAME | DeltaEncoder::FIELDS_ALL;
+
+template <typename T> void put_le(std::vector<uint8_t> &out, const T value) {
+  uint8_t bytes[sizeof(T)];
+
+  std::memcpy(bytes, &value, sizeof(T));
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// keyframe_interval(2) light_deadband(4) temp_deadband(4)
+std::vector<uint8_t> capability_body(const uint16_t keyframe_interval,
+                                     const int32_t light_deadband,
+                                     const float temp_deadband) {
+  std::vector<uint8_t> body;
+
+  put_le(body, keyframe_interval);
+  put_le(body, light_deadband);
+  put_le(body, temp_deadband);
+
+  return body;
+}
+
+bool accepts(const std::vector<uint8_t> &body) {
+  DeltaTelemetryCapability capability;
+  pcomm::bytes::Decoder decoder{body.data(), body.size()};
+
+  return capability.deserialize(decoder) && capability.enabled();
+}
+
+void check_capability() {
+  SerialCommunicator comm;
+  bench::EmptyCapability device_capability;
+  DeltaTelemetryCapability delta_capability;
+
+  const bool registered =
+      comm.add_capability(device_capability, device_capability) &&
+      comm.add_capability(delta_capability, delta_capability);
+
+  comm.on_recv(bench::host_hello(
+      {{bench::EmptyCapability::ID, {}},
+       {DeltaTelemetryCapability::ID,
+        capability_body(KEYFRAME_INTERVAL, LIGHT_DEADBAND, TEMP_DEADBAND)}}));
+  comm.on_recv(bench::host_ack);
+
+  bench::check("negotiated through HostHello",
+               registered && comm.is_connected() &&
+                   delta_capability.enabled() &&
+                   delta_capability.keyframe_interval() == KEYFRAME_INTERVAL &&
+                   delta_capability.light_deadband() == LIGHT_DEADBAND);
+
+  bench::check("zero keyframe interval is refused",
+               !accepts(capability_body(0, LIGHT_DEADBAND, TEMP_DEADBAND)));
+  bench::check("negative or NaN deadbands are refused",
+               !accepts(capability_body(KEYFRAME_INTERVAL, -1, 0)) &&
+                   !accepts(capability_body(KEYFRAME_INTERVAL, 0, -1)) &&
+                   !accepts(capability_body(KEYFRAME_INTERVAL, 0, NAN)));
+}
+
+DeltaTelemetryCapability configured() {
+  DeltaTelemetryCapability capability;
+  const auto body =
+      capability_body(KEYFRAME_INTERVAL, LIGHT_DEADBAND, TEMP_DEADBAND);
+  pcomm::bytes::Decoder decoder{body.data(), body.size()};
+
+  capability.deserialize(decoder);
+
+  return capability;
+}
+
+void check_masks() {
+  const auto capability = configured();
+  DeltaEncoder encoder{capability};
+
+  const bool keyframe = encoder.next_mask({false, 100, 27.f}) == ALL;
+  const bool unchanged = encoder.next_mask({false, 100, 27.f}) == 0;
+
+  bench::check("first sample is a keyframe, then unchanged",
+               keyframe && unchanged);
+
+  const bool within = encoder.next_mask({false, 104, 27.25f}) == 0;
+  const bool past = encoder.next_mask({true, 105, 27.5f}) ==
+                    DeltaEncoder::FIELDS_ALL;
+
+  bench::check("fields are sent once past their deadband", within && past);
+
+  // Each step stays inside the deadband of the previous sample, but the
+  // drift is measured against the last value sent
+  uint8_t drift = 0;
+
+  for (int32_t light = 107; light <= 111; light += 2) {
+    drift |= encoder.next_mask({true, light, 27.5f});
+  }
+
+  bench::check("slow drift is sent", drift == DeltaEncoder::FIELD_LIGHT);
+
+  // Six samples since the keyframe so far
+  uint8_t mask = 0;
+
+  for (uint16_t i = 0; i < KEYFRAME_INTERVAL - 7; ++i) {
+    mask = encoder.next_mask({true, 111, 27.5f});
+  }
+
+  const bool held = mask == 0;
+
+  bench::check("a keyframe every keyframe_interval samples",
+               held && encoder.next_mask({true, 111, 27.5f}) == ALL);
+
+  encoder.next_mask({true, 111, 27.5f});
+  encoder.reset();
+
+  bench::check("reset forces a keyframe",
+               encoder.next_mask({true, 111, 27.5f}) == ALL);
+}
+
+size_t serialized_size(const uint8_t mask) {
+  std::vector<uint8_t> bytes;
+
+  DeltaEncoder::serialize(mask, {true, 1, 2.f}, pcomm::bytes::Encoder{bytes});
+
+  return bytes.size();
+}
+
+void check_serialize() {
+  bench::check("only the masked fields are written",
+               serialized_size(0) == 1 &&
+                   serialized_size(DeltaEncoder::FIELD_BUTTON) == 2 &&
+                   serialized_size(DeltaEncoder::FIELD_LIGHT) == 5 &&
+                   serialized_size(ALL) == 1 + 1 + 4 + 4);
+}
+
+DeviceData constant_sample() { return {false, 310, 27.5f}; }
+
+void check_stream() {
+  const auto capability = configured();
+  DeltaEncoder encoder{capability};
+  TelemetryStream stream{constant_sample};
+  TelemetryBlock block;
+
+  stream.start(1'000, 4);
+
+  for (int i = 0; i < 4; ++i) {
+    fire_repeating_timers();
+  }
+
+  const bool first =
+      stream.take_batch(block, &encoder) && block.delta &&
+      block.count == 1 && block.masks[0] == ALL && block.sequence == 0;
+
+  for (int i = 0; i < 4; ++i) {
+    fire_repeating_timers();
+  }
+
+  const bool skipped = !stream.take_batch(block, &encoder);
+
+  bench::check("unchanged samples are left out of blocks",
+               first && skipped && !stream.batch_ready());
+
+  stream.stop();
+}
+
+} // namespace
+
+void bench_delta_telemetry() {
+  bench::section("DeltaTelemetry");
+
+  check_capability();
+  check_masks();
+  check_serialize();
+  check_stream();
+
+  const auto capability = configured();
+  DeltaEncoder encoder{capability};
+
+  bench::run("next_mask, noisy light", ROUNDS, [&](const size_t i) {
+    const auto light = static_cast<int32_t>(300 + (i * 2654435761u >> 29));
+
+    bench::do_not_optimize(encoder.next_mask({false, light, 27.5f}));
+  });
+}
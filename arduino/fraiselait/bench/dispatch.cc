@@ -0,0 +1,118 @@
+#include "bench.h"
+
+#include "DispatchTable.h"
+#include "InplaceFunction.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Stand-in for pcomm::bytes::Decoder so the benchmark does not depend on the
+// Arduino core.
+struct Cursor {
+  const uint8_t *data;
+  size_t size;
+};
+
+constexpr uint16_t CODE_GET_IMMEDIATE = 0x0090;
+constexpr uint16_t CODE_GET_LOOP_OFF = 0x0092;
+constexpr uint16_t CODE_GET_LOOP_ON = 0x0093;
+constexpr uint16_t CODE_SET = 0x00e0;
+constexpr uint16_t CODE_UNKNOWN = 0x00f7;
+
+constexpr std::array<uint16_t, 8> TRAFFIC{
+    CODE_SET,          CODE_SET,          CODE_GET_IMMEDIATE, CODE_SET,
+    CODE_GET_LOOP_OFF, CODE_GET_LOOP_ON,  CODE_SET,           CODE_UNKNOWN,
+};
+
+constexpr size_t ITERATIONS = 20'000'000;
+
+volatile uint32_t sink;
+
+void on_get_immediate(Cursor &) { sink = sink + 1; }
+void on_get_loop_off(Cursor &) { sink = sink + 2; }
+void on_get_loop_on(Cursor &) { sink = sink + 3; }
+void on_set(Cursor &cursor) { sink = sink + cursor.size; }
+
+using Handler = void (*)(Cursor &);
+
+using StaticHandlers = StaticDispatchTable<
+    Handler, DispatchRoute<CODE_GET_IMMEDIATE, on_get_immediate>,
+    DispatchRoute<CODE_GET_LOOP_OFF, on_get_loop_off>,
+    DispatchRoute<CODE_GET_LOOP_ON, on_get_loop_on>,
+    DispatchRoute<CODE_SET, on_set>>;
+
+// Previous SerialCommunicator layout: sorted vector of std::function looked
+// up with lower_bound.
+template <typename Callback> class SortedCallbacks {
+public:
+  void add(const uint16_t code, Callback &&callback) {
+    callbacks.emplace(std::ranges::upper_bound(callbacks, code, {},
+                                               &pair_t::first),
+                      code, std::move(callback));
+  }
+
+  void dispatch(const uint16_t code, Cursor &cursor) {
+    const auto it =
+        std::ranges::lower_bound(callbacks, code, {}, &pair_t::first);
+
+    if (it == callbacks.end() || it->first != code)
+      return;
+
+    it->second(cursor);
+  }
+
+private:
+  using pair_t = std::pair<uint16_t, Callback>;
+
+  std::vector<pair_t> callbacks;
+};
+
+template <typename Callback> SortedCallbacks<Callback> make_sorted() {
+  SortedCallbacks<Callback> callbacks;
+
+  callbacks.add(CODE_GET_IMMEDIATE, [](Cursor &c) { on_get_immediate(c); });
+  callbacks.add(CODE_GET_LOOP_OFF, [](Cursor &c) { on_get_loop_off(c); });
+  callbacks.add(CODE_GET_LOOP_ON, [](Cursor &c) { on_get_loop_on(c); });
+  callbacks.add(CODE_SET, [](Cursor &c) { on_set(c); });
+
+  return callbacks;
+}
+
+} // namespace
+
+void bench_dispatch() {
+  bench::section("dispatch");
+
+  uint8_t payload[8]{};
+  Cursor cursor{payload, sizeof(payload)};
+
+  auto functions = make_sorted<std::function<void(Cursor &)>>();
+
+  bench::run("sorted vector<std::function> (before)", ITERATIONS,
+             [&](const size_t i) {
+               functions.dispatch(TRAFFIC[i % TRAFFIC.size()], cursor);
+             });
+
+  auto inplace = make_sorted<InplaceFunction<void(Cursor &)>>();
+
+  bench::run("sorted vector<InplaceFunction> (runtime)", ITERATIONS,
+             [&](const size_t i) {
+               inplace.dispatch(TRAFFIC[i % TRAFFIC.size()], cursor);
+             });
+
+  constexpr auto table = StaticHandlers::view();
+
+  bench::run("StaticDispatchTable (static)", ITERATIONS,
+             [&](const size_t i) {
+               if (const auto handler =
+                       table.find(TRAFFIC[i % TRAFFIC.size()])) {
+                 handler(cursor);
+               }
+             });
+}
@@ -0,0 +1,164 @@
+#include "bench.h"
+
+#include "SensorFilter.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr size_t SAMPLES = 4'000'000;
+constexpr size_t DRIFT_SAMPLES = 20'000'000;
+
+// Noisy 12-bit signal that is cheap enough not to dominate the timings
+int32_t sample_at(const size_t i) {
+  const auto noise = (static_cast<uint32_t>(i) * 2654435761u) >> 26;
+
+  return 2048 + static_cast<int32_t>(noise) - 32;
+}
+
+template <typename Filter> void run_filter(const char *name) {
+  Filter filter;
+  int32_t out = 0;
+
+  bench::run(name, SAMPLES, [&](const size_t i) {
+    if (filter.process(sample_at(i), out)) {
+      bench::do_not_optimize(out);
+    }
+  });
+}
+
+void run_preset(const char *name, const FilterPreset preset) {
+  SensorFilter filter;
+  int32_t out = 0;
+
+  filter.select(preset);
+
+  bench::run(name, SAMPLES, [&](const size_t i) {
+    if (filter.process(sample_at(i), out)) {
+      bench::do_not_optimize(out);
+    }
+  });
+}
+
+// Feeds inputs through a stage and collects what it emits
+template <typename Filter>
+std::vector<int32_t> outputs(Filter &&filter,
+                             const std::vector<int32_t> &inputs) {
+  std::vector<int32_t> out;
+  int32_t value = 0;
+
+  for (const auto in : inputs) {
+    if (filter.process(in, value)) {
+      out.push_back(value);
+    }
+  }
+
+  return out;
+}
+
+void check_stages() {
+  bench::check("boxcar step response",
+               outputs(filters::Boxcar<4>{}, {100, 100, 100, 100, 100}) ==
+                   std::vector<int32_t>{25, 50, 75, 100, 100});
+
+  // alpha = 1/2, primed with the first input
+  bench::check("ema step response",
+               outputs(filters::Ema<1>{}, {0, 100, 100, 100}) ==
+                   std::vector<int32_t>{0, 50, 75, 88});
+
+  bench::check("median rejects a spike",
+               outputs(filters::Median<3>{}, {10, 10, 500, 10, 10}) ==
+                   std::vector<int32_t>{10, 10, 10, 10, 10});
+
+  // The first Order outputs are the comb section filling up
+  const auto cic =
+      outputs(filters::Cic<4, 2>{}, std::vector<int32_t>(32, 100));
+
+  bench::check("cic emits one output per 4 inputs", cic.size() == 8);
+  bench::check("cic has unity DC gain once settled",
+               std::all_of(cic.begin() + 2, cic.end(),
+                           [](const int32_t value) { return value == 100; }));
+}
+
+// A constant input has to come back out unchanged from every preset once
+// the windows are full.
+bool settles_on_constant(const FilterPreset preset) {
+  SensorFilter filter;
+  int32_t out = -1;
+
+  filter.select(preset);
+
+  for (size_t i = 0; i < 4096; ++i) {
+    filter.process(1234, out);
+  }
+
+  return out == 1234;
+}
+
+// Running float total, as the temperature boxcar used to keep it
+float float_boxcar_error() {
+  std::array<float, ANALOG_READINGS> readings{};
+  float total = 0;
+  size_t index = 0;
+
+  for (size_t i = 0; i < DRIFT_SAMPLES; ++i) {
+    const float reading = 20.f + static_cast<float>(sample_at(i)) / 997.f;
+
+    total -= readings[index];
+    readings[index] = reading;
+    total += readings[index];
+
+    if (++index >= readings.size()) {
+      index = 0;
+    }
+  }
+
+  float exact = 0;
+
+  for (const auto reading : readings) {
+    exact += reading;
+  }
+
+  return std::fabs(total - exact) / ANALOG_READINGS;
+}
+
+} // namespace
+
+void bench_filters() {
+  bench::section("filter stages (per sample)");
+
+  check_stages();
+
+  run_filter<filters::Boxcar<ANALOG_READINGS>>("Boxcar<ANALOG_READINGS>");
+  run_filter<filters::Ema<FILTER_EMA_SHIFT>>("Ema<FILTER_EMA_SHIFT>");
+  run_filter<filters::Median<FILTER_MEDIAN_WINDOW>>(
+      "Median<FILTER_MEDIAN_WINDOW>");
+  run_filter<filters::Cic<FILTER_CIC_DECIMATION, FILTER_CIC_ORDER>>(
+      "Cic<FILTER_CIC_DECIMATION, FILTER_CIC_ORDER>");
+
+  bench::section("runtime-selected presets (per sample)");
+
+  run_preset("SensorFilter Raw", FilterPreset::Raw);
+  run_preset("SensorFilter Boxcar", FilterPreset::Boxcar);
+  run_preset("SensorFilter Ema", FilterPreset::Ema);
+  run_preset("SensorFilter Median", FilterPreset::Median);
+  run_preset("SensorFilter MedianEma", FilterPreset::MedianEma);
+  run_preset("SensorFilter Cic", FilterPreset::Cic);
+
+  bool settled = true;
+
+  for (const auto preset :
+       {FilterPreset::Raw, FilterPreset::Boxcar, FilterPreset::Ema,
+        FilterPreset::Median, FilterPreset::MedianEma, FilterPreset::Cic}) {
+    settled = settles_on_constant(preset) && settled;
+  }
+
+  bench::check("constant input reproduced", settled);
+  std::printf("  %-48s %10.6f degC\n", "float running total drift (20M samples)",
+              float_boxcar_error());
+}
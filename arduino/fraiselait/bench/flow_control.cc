@@ -0,0 +1,118 @@
+#include "bench.h"
+
+#include "DeviceData.h"
+#include "FlowControl.h"
+#include "SerialCommunicator.h"
+#include "constants.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr uint16_t HOST_WINDOW = 4;
+
+SerialCommunicator comm;
+bench::EmptyCapability device_capability;
+FlowControlCapability flow_capability;
+FlowControl flow{flow_capability};
+
+std::vector<uint8_t> le16(const uint16_t value) {
+  return {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8)};
+}
+
+pcomm::packets::Packet credit_update(const uint16_t credits) {
+  return pcomm::packets::Packet{
+      static_cast<uint16_t>(PacketType::CreditUpdate), le16(credits)};
+}
+
+// Whether one more Data frame reached the wire
+bool send_one() {
+  const auto before = Serial.bytes_written;
+
+  comm.send_message<DeviceDataMessage>({true, 512, 27.5f});
+
+  return Serial.bytes_written > before;
+}
+
+void check_tx_credits() {
+  bool sent = true;
+
+  for (uint16_t i = 0; i < HOST_WINDOW; ++i) {
+    sent &= send_one();
+  }
+
+  bench::check("tx: the host window is spent frame by frame", sent);
+  bench::check("tx: out of credit, sends are held back",
+               !comm.can_send() && !send_one() &&
+                   flow.stats().tx_blocked == 1);
+
+  comm.on_recv(credit_update(2));
+
+  const bool resumed = comm.can_send() && send_one() && send_one();
+
+  bench::check("tx: a CreditUpdate resumes sending",
+               resumed && !send_one() && flow.stats().tx_blocked == 2);
+}
+
+void check_rx_credits() {
+  const pcomm::packets::Packet data{static_cast<uint16_t>(PacketType::Data),
+                                    le16(0xFFFF)};
+
+  for (uint16_t i = 1; i < FLOW_CONTROL_DEVICE_WINDOW / 2; ++i) {
+    comm.on_recv(data);
+  }
+
+  const bool batched = flow.stats().credit_updates == 0;
+
+  comm.on_recv(data);
+
+  bench::check("rx: credits return at half the window",
+               batched && flow.stats().credit_updates == 1 &&
+                   flow.stats().credits_returned ==
+                       FLOW_CONTROL_DEVICE_WINDOW / 2);
+}
+
+// Runs with the host window spent and the credits just handed back
+bool answered_without_credit(const DataTypes request) {
+  std::vector<uint8_t> payload = le16(static_cast<uint16_t>(request));
+
+  payload.resize(2 + 8);
+
+  const auto before = Serial.bytes_written;
+  const auto blocked = flow.stats().tx_blocked;
+
+  comm.on_recv(pcomm::packets::Packet{static_cast<uint16_t>(PacketType::Data),
+                                      std::move(payload)});
+
+  return !comm.can_send() && Serial.bytes_written > before &&
+         flow.stats().tx_blocked == blocked;
+}
+
+} // namespace
+
+void bench_flow_control() {
+  bench::section("Flow control (fake socket)");
+
+  bench::check(
+      "capabilities registered",
+      comm.add_capability(device_capability, device_capability) &&
+          comm.add_capability(flow_capability, flow_capability));
+  comm.set_flow_control(flow);
+
+  comm.on_recv(bench::host_hello({{bench::EmptyCapability::ID, {}},
+                                  {FlowControlCapability::ID,
+                                   le16(HOST_WINDOW)}}));
+  comm.on_recv(bench::host_ack);
+
+  if (!bench::check("negotiated", comm.is_connected() && flow.enabled()))
+    return;
+
+  check_tx_credits();
+  check_rx_credits();
+  bench::check("ping: answered without credit",
+               answered_without_credit(DataTypes::CommandPing));
+  bench::check("time sync: answered without credit",
+               answered_without_credit(DataTypes::CommandTimeSync));
+}
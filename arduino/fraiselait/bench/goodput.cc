@@ -0,0 +1,81 @@
+#include "bench.h"
+
+#include "FrameWriter.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// Bulk bandwidth of USB full-speed: 19 64-byte packets per 1 ms frame
+constexpr double LINK_BYTES_PER_SECOND = 19 * 64 * 1000;
+
+constexpr size_t FRAMES = 20'000;
+
+struct Payload {
+  const char *name;
+  size_t size;
+};
+
+// Code(2) plus body, as sent by send_data
+constexpr std::array PAYLOADS{
+    Payload{"DeviceData", 2 + 9},
+    Payload{"telemetry batch of 32", 2 + 17 + 32 * 13},
+    Payload{"raw sample block", 2 + 26 + 1536},
+};
+
+constexpr std::array<uint16_t, 6> CHUNK_SIZES{
+    FrameWriter::DEFAULT_CHUNK_SIZE, 64, 128, 256, 512,
+    FrameWriter::MAX_CHUNK_SIZE};
+
+} // namespace
+
+void bench_goodput() {
+  bench::section("chunk MTU goodput");
+
+  std::vector<uint8_t> body(FrameWriter::MAX_FRAME_SIZE);
+
+  for (size_t i = 0; i < body.size(); ++i) {
+    body[i] = static_cast<uint8_t>(i * 31);
+  }
+
+  std::printf("  %-24s %6s %10s %8s %12s %10s\n", "payload", "chunk",
+              "wire B", "eff.", "goodput", "ns/frame");
+
+  for (const auto &payload : PAYLOADS) {
+    for (const auto chunk_size : CHUNK_SIZES) {
+      size_t wire_bytes = 0;
+
+      FrameWriter writer{[&](const uint8_t *, const size_t size) {
+        wire_bytes += size;
+      }};
+
+      writer.set_chunk_size(chunk_size);
+      writer.write(0x0004, {{body.data(), payload.size}});
+
+      const auto per_frame = wire_bytes;
+      const auto efficiency =
+          static_cast<double>(payload.size) / static_cast<double>(per_frame);
+
+      // Timed here rather than through bench::run to keep a single table
+      const auto start = std::chrono::steady_clock::now();
+
+      for (size_t i = 0; i < FRAMES; ++i) {
+        writer.write(0x0004, {{body.data(), payload.size}});
+      }
+
+      const auto elapsed = std::chrono::steady_clock::now() - start;
+      const double ns_per_frame =
+          std::chrono::duration<double, std::nano>(elapsed).count() / FRAMES;
+
+      bench::do_not_optimize(wire_bytes);
+
+      std::printf("  %-24s %6u %10zu %7.1f%% %8.1f kB/s %10.0f\n",
+                  payload.name, chunk_size, per_frame, efficiency * 100,
+                  efficiency * LINK_BYTES_PER_SECOND / 1000, ns_per_frame);
+    }
+  }
+}
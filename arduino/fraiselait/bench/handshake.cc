@@ -0,0 +1,129 @@
+#include "bench.h"
+
+#include "SerialCommunicator.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr size_t CAPABILITIES = 64;
+constexpr size_t HANDSHAKES = 20'000;
+
+constexpr uint16_t FIRST_ID = 0x0040;
+
+// Stand-in for a real capability: a 4-byte setting each way
+class NumberCapability final : public ICapability {
+public:
+  uint16_t capability_id = 0;
+  uint32_t value = 0;
+
+  [[nodiscard]] uint16_t id() const override { return capability_id; }
+
+  [[nodiscard]] uint16_t min_size() const override { return 4; }
+
+  void serialize(const pcomm::bytes::Encoder &encoder) const override {
+    encoder.push_number(value);
+  }
+
+  bool deserialize(pcomm::bytes::Decoder &decoder) override {
+    value = decoder.pop_number<uint32_t>();
+
+    return true;
+  }
+
+  void reset() override { value = 0; }
+};
+
+SerialCommunicator comm;
+std::array<NumberCapability, CAPABILITIES> capabilities;
+
+// Lists the capabilities back to front, so none is found first by luck.
+// Capability i carries the value i.
+pcomm::packets::Packet host_hello() {
+  std::vector<bench::HostCapability> entries;
+
+  for (size_t i = CAPABILITIES; i-- > 0;) {
+    std::vector<uint8_t> body;
+    const pcomm::bytes::Encoder encoder{body};
+
+    encoder.push_number(static_cast<uint32_t>(i));
+
+    entries.push_back({capabilities[i].id(), std::move(body)});
+  }
+
+  return bench::host_hello(entries);
+}
+
+void check_registry() {
+  CapabilityRegistry registry;
+  std::array<NumberCapability, 3> entries;
+
+  entries[0].capability_id = 0;
+  entries[1].capability_id = 2;
+  entries[2].capability_id = MAX_DISPATCH_TABLE_SPAN;
+
+  const bool added = registry.add(entries[0]) && registry.add(entries[1]);
+
+  bench::check("registry: id 0 first, then a higher id",
+               added && registry.find(0) == &entries[0] &&
+                   registry.find(1) == nullptr &&
+                   registry.find(2) == &entries[1]);
+  bench::check("registry: taken id and over-wide span refused",
+               !registry.add(entries[1]) && !registry.add(entries[2]));
+}
+
+} // namespace
+
+void bench_handshake() {
+  bench::section("Handshake with 64 capabilities (fake socket)");
+
+  check_registry();
+
+  bool registered = true;
+
+  for (size_t i = 0; i < CAPABILITIES; ++i) {
+    capabilities[i].capability_id = static_cast<uint16_t>(FIRST_ID + i);
+
+    registered &= comm.add_capability(capabilities[i], capabilities[i]);
+  }
+
+  bench::check("64 capabilities registered", registered);
+
+  const auto hello = host_hello();
+
+  const auto allocations = bench::allocations();
+
+  const auto ns = bench::run("hello + ack", HANDSHAKES, [&](size_t) {
+    comm.on_unavailable();
+    comm.on_recv(hello);
+    comm.on_recv(bench::host_ack);
+  });
+
+  const auto per_handshake =
+      static_cast<double>(bench::allocations() - allocations) /
+      (HANDSHAKES + HANDSHAKES / 10);
+
+  const auto hello_size =
+      comm.sent.empty() ? 0 : comm.sent.back().payload.size();
+
+  comm.sent.clear();
+  comm.sent.shrink_to_fit();
+
+  bench::print_per_op("per capability", ns / CAPABILITIES, "ns");
+  bench::print_per_op("allocations per handshake", per_handshake,
+               "(DeviceHello and debug strings)");
+  bench::print_per_op("DeviceHello payload", static_cast<double>(hello_size),
+               "bytes");
+  // Each capability got its own value; reset() leaves every one at 0, so
+  // only the non-zero ones show that the lookup found the right entry
+  bool negotiated = comm.is_connected();
+
+  for (size_t i = 1; i < CAPABILITIES; ++i) {
+    negotiated &= capabilities[i].value == i;
+  }
+
+  bench::check("all capabilities negotiated", negotiated);
+}
@@ -0,0 +1,65 @@
+#include "bench.h"
+
+#include "LatencyTrace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr size_t SAMPLES = 2'000'000;
+
+// Long-tailed cycle counts: mostly a few hundred, occasionally thousands
+uint32_t sample_at(const size_t i) {
+  const auto hash = static_cast<uint32_t>(i) * 2654435761u;
+  const auto base = 200 + (hash >> 24);
+
+  return (hash & 0x3f) == 0 ? base * 20 : base;
+}
+
+} // namespace
+
+void bench_latency() {
+  bench::section("latency histogram");
+
+  LatencyHistogram histogram;
+
+  bench::run("record", SAMPLES,
+             [&](const size_t i) { histogram.record(sample_at(i)); });
+
+  bench::run("summary", 10'000, [&](size_t) {
+    bench::do_not_optimize(histogram.summary());
+  });
+
+  // bench::run also records its warm-up, so accuracy is checked against a
+  // histogram holding exactly the samples it is compared with
+  std::vector<uint32_t> values(SAMPLES);
+  LatencyHistogram exact;
+
+  for (size_t i = 0; i < SAMPLES; ++i) {
+    values[i] = sample_at(i);
+    exact.record(values[i]);
+  }
+
+  const auto summary = exact.summary();
+
+  std::ranges::sort(values);
+
+  const auto exact_p99 = values[SAMPLES - SAMPLES / 100 - 1];
+  const auto error = 100.0 * (static_cast<double>(summary.p99) - exact_p99) /
+                     exact_p99;
+
+  std::printf("  %-48s %10u\n", "exact p99", exact_p99);
+  std::printf("  %-48s %10u (%+.1f%%)\n", "histogram p99", summary.p99, error);
+  std::printf("  %-48s %10u / %u\n", "min / max", summary.min, summary.max);
+
+  constexpr auto RESOLUTION = 1u << LatencyHistogram::SUB_BUCKET_BITS;
+
+  bench::check("p99 within one sub-bucket above the exact value",
+               summary.p99 >= exact_p99 &&
+                   summary.p99 <= exact_p99 + exact_p99 / RESOLUTION);
+  bench::check("min / max are exact",
+               summary.min == values.front() && summary.max == values.back());
+}
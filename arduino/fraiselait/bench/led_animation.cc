@@ -0,0 +1,174 @@
+#include "bench.h"
+
+#include "LedAnimation.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr size_t FRAMES = 2'000'000;
+
+constexpr uint32_t ONE = LedAnimation::ONE;
+
+constexpr std::array EASINGS{Easing::Linear, Easing::Step, Easing::EaseIn,
+                             Easing::EaseOut, Easing::EaseInOut};
+
+// count(1) and then each keyframe as at_ms(2) r g b easing
+std::vector<uint8_t> animation_body(const std::vector<Keyframe> &keyframes,
+                                    const size_t count) {
+  std::vector<uint8_t> body;
+  const pcomm::bytes::Encoder encoder{body};
+
+  encoder.push_number(static_cast<uint8_t>(count));
+
+  for (const auto &keyframe : keyframes) {
+    encoder.push_number(keyframe.at_ms);
+    encoder.push_number(keyframe.color.r);
+    encoder.push_number(keyframe.color.g);
+    encoder.push_number(keyframe.color.b);
+    encoder.push_number(static_cast<uint8_t>(keyframe.easing));
+  }
+
+  return body;
+}
+
+bool parses(const std::vector<uint8_t> &body, LedAnimation &animation) {
+  pcomm::bytes::Decoder decoder{body.data(), body.size()};
+
+  return parse_led_animation(decoder, animation);
+}
+
+bool same(const RGBColor &a, const RGBColor &b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+// Black to white in 100 ms, then to red in another 100 ms
+const std::vector<Keyframe> FADE{
+    {0, {0, 0, 0}, Easing::Linear},
+    {100, {255, 255, 255}, Easing::EaseInOut},
+    {200, {255, 0, 0}, Easing::Linear},
+};
+
+void check_easing() {
+  bool endpoints = true;
+  bool monotonic = true;
+
+  for (const auto easing : EASINGS) {
+    endpoints &= ease(easing, 0) == 0 && ease(easing, ONE) == ONE;
+
+    for (uint32_t t = 0, last = 0; t <= ONE; t += ONE / 256) {
+      const auto value = ease(easing, t);
+
+      monotonic &= value >= last && value <= ONE;
+      last = value;
+    }
+  }
+
+  bench::check("ease: 0 -> 0 and ONE -> ONE", endpoints);
+  bench::check("ease: monotonic within 0..ONE", monotonic);
+  bench::check("ease: in-out passes the midpoint",
+               ease(Easing::EaseInOut, ONE / 2) == ONE / 2);
+  bench::check("ease: step holds until the end",
+               ease(Easing::Step, ONE - 1) == 0);
+
+  bench::check("mix: weight 0 and ONE give the ends",
+               mix(10, 200, 0) == 10 && mix(10, 200, ONE) == 200 &&
+                   mix(200, 10, ONE) == 10);
+  bench::check("mix: halfway rounds to nearest",
+               mix(0, 255, ONE / 2) == 128 && mix(20, 10, ONE / 2) == 15);
+}
+
+void check_sample() {
+  LedAnimation animation;
+
+  if (!bench::check("parse: fade", parses(animation_body(FADE, FADE.size()),
+                                          animation)))
+    return;
+
+  size_t segment = 0;
+
+  const auto start = animation.sample(0, segment);
+  const auto half = animation.sample(50'000, segment);
+  const auto white = animation.sample(100'000, segment);
+  const auto end = animation.sample(200'000, segment);
+  const auto past = animation.sample(250'000, segment);
+
+  bench::check("sample: keyframes are hit exactly",
+               same(start, {0, 0, 0}) && same(white, {255, 255, 255}) &&
+                   same(end, {255, 0, 0}));
+  bench::check("sample: linear halfway", same(half, {128, 128, 128}));
+  bench::check("sample: holds the last keyframe", same(past, {255, 0, 0}));
+
+  // Going back in time must not reuse the cached segment
+  bench::check("sample: rewinds past the cached segment",
+               same(animation.sample(50'000, segment), half));
+
+  LedAnimation empty;
+
+  bench::check("sample: empty animation is black",
+               same(empty.sample(0, segment), {0, 0, 0}));
+}
+
+void check_parse() {
+  LedAnimation animation;
+
+  bench::check("parse: empty body is refused", !parses({}, animation));
+  bench::check("parse: zero keyframes are refused",
+               !parses(animation_body({}, 0), animation));
+
+  auto truncated = animation_body(FADE, FADE.size());
+
+  truncated.pop_back();
+
+  bench::check("parse: truncated keyframe is refused",
+               !parses(truncated, animation));
+  bench::check("parse: count past the body is refused",
+               !parses(animation_body(FADE, FADE.size() + 1), animation));
+
+  const std::vector<Keyframe> too_many(LED_ANIMATION_CAPACITY + 1);
+
+  bench::check("parse: over LED_ANIMATION_CAPACITY is refused",
+               !parses(animation_body(too_many, too_many.size()), animation));
+
+  auto unordered = FADE;
+
+  unordered[2].at_ms = unordered[1].at_ms;
+
+  bench::check("parse: non-increasing times are refused",
+               !parses(animation_body(unordered, unordered.size()),
+                       animation));
+
+  auto body = animation_body(FADE, FADE.size());
+
+  // Easing byte of the last keyframe
+  body.back() = static_cast<uint8_t>(Easing::EaseInOut) + 1;
+
+  bench::check("parse: unknown easing is refused", !parses(body, animation));
+}
+
+} // namespace
+
+void bench_led_animation() {
+  bench::section("LED animation");
+
+  check_easing();
+  check_sample();
+  check_parse();
+
+  LedAnimation animation;
+
+  if (!parses(animation_body(FADE, FADE.size()), animation))
+    return;
+
+  size_t segment = 0;
+
+  // One 200 Hz frame per call, sweeping the animation over and over
+  bench::run("sample (3 keyframes)", FRAMES, [&](const size_t i) {
+    const auto at_us = static_cast<uint32_t>(i % 40 * 5'000);
+
+    bench::do_not_optimize(animation.sample(at_us, segment));
+  });
+}
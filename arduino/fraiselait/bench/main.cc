@@ -0,0 +1,37 @@
+#include "bench.h"
+
+#include <cstring>
+
+int main(const int argc, char **argv) {
+  if (argc == 3 && std::strcmp(argv[1], "--write-fixtures") == 0)
+    return write_compression_fixtures(argv[2]) ? 0 : 1;
+
+  bench_dispatch();
+  bench_core_commands();
+  bench_adc();
+  bench_filters();
+  bench_raw_stream();
+  bench_goodput();
+  bench_compression();
+  bench_crc();
+  bench_protocol();
+  bench_latency();
+  bench_pcm();
+  bench_session();
+  bench_handshake();
+  bench_tx_scheduler();
+  bench_led_animation();
+  bench_command_scheduler();
+  bench_tone_sequence();
+  bench_flow_control();
+  bench_telemetry_stream();
+  bench_delta_telemetry();
+
+  if (bench::failed_checks > 0) {
+    std::printf("\n%zu checks FAILED\n", bench::failed_checks);
+
+    return 1;
+  }
+
+  return 0;
+}
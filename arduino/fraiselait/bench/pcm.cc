@@ -0,0 +1,158 @@
+#include "bench.h"
+
+#include "PcmJitterBuffer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SAMPLE_RATE_HZ = 22'050;
+constexpr size_t PACKET_SAMPLES = 441; // 20 ms
+constexpr size_t SIMULATED_PACKETS = 30'000;
+
+// Deterministic stand-in for USB and host scheduling delays
+class Jitter {
+public:
+  // 0-3 ms normally, plus a 30 ms stall on one packet in a hundred
+  double next_ms() {
+    const auto value = step();
+    const auto delay = static_cast<double>(value % 3000) / 1000.0;
+
+    return value % 100 == 0 ? delay + 30.0 : delay;
+  }
+
+private:
+  uint32_t state = 0x12345678;
+
+  uint32_t step() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    return state;
+  }
+};
+
+struct Simulation {
+  PcmStats stats;
+  double latency_ms;
+};
+
+// Host sends a packet every 20 ms; each arrives late by Jitter but never
+// overtakes the previous one. The DMA side reads a block every
+// PCM_BLOCK_SAMPLES / SAMPLE_RATE_HZ.
+Simulation simulate(const size_t prebuffer) {
+  auto buffer = std::make_unique<PcmJitterBuffer>();
+  Jitter jitter;
+
+  buffer->set_prebuffer(prebuffer);
+
+  std::array<uint8_t, PACKET_SAMPLES> packet;
+  std::array<uint16_t, PCM_BLOCK_SAMPLES> block;
+
+  packet.fill(200);
+
+  constexpr double packet_period_ms = 1000.0 * PACKET_SAMPLES / SAMPLE_RATE_HZ;
+  constexpr double block_period_ms =
+      1000.0 * PCM_BLOCK_SAMPLES / SAMPLE_RATE_HZ;
+
+  double arrival_ms = jitter.next_ms();
+  size_t sent = 0;
+
+  for (double now_ms = 0; sent < SIMULATED_PACKETS;
+       now_ms += block_period_ms) {
+    while (sent < SIMULATED_PACKETS && arrival_ms <= now_ms) {
+      buffer->write(packet.data(), packet.size());
+
+      sent++;
+
+      arrival_ms = std::max(arrival_ms,
+                            sent * packet_period_ms + jitter.next_ms());
+    }
+
+    buffer->read(block.data(), block.size());
+  }
+
+  return {buffer->stats(), 1000.0 * prebuffer / SAMPLE_RATE_HZ};
+}
+
+// A stream left a full buffer behind; the next one restarts it and its
+// first samples arrive before the consumer has read anything
+void check_restart() {
+  auto buffer = std::make_unique<PcmJitterBuffer>();
+  std::vector<uint8_t> old_stream(PCM_BUFFER_SAMPLES, 0x00);
+  std::vector<uint8_t> new_stream(PCM_BLOCK_SAMPLES, 0xff);
+  std::array<uint16_t, PCM_BLOCK_SAMPLES> block{};
+
+  buffer->set_prebuffer(PCM_BLOCK_SAMPLES);
+  buffer->write(old_stream.data(), old_stream.size());
+  buffer->restart();
+
+  const auto accepted = buffer->write(new_stream.data(), new_stream.size());
+
+  bench::check("restart: frees the old stream for the new one",
+               accepted == new_stream.size());
+
+  buffer->read(block.data(), block.size());
+
+  bench::check("restart: the new stream plays first",
+               std::ranges::all_of(block, [](const uint16_t level) {
+                 return level == PCM_PWM_WRAP;
+               }));
+  bench::check("restart: nothing is left over",
+               buffer->stats().buffered_samples == 0);
+}
+
+} // namespace
+
+void bench_pcm() {
+  bench::section("PCM jitter buffer");
+
+  check_restart();
+
+  auto buffer = std::make_unique<PcmJitterBuffer>();
+  std::array<uint8_t, 512> bytes{};
+  std::array<uint16_t, PCM_BLOCK_SAMPLES> block{};
+
+  buffer->set_prebuffer(0);
+
+  for (const auto format : {PcmFormat::U8, PcmFormat::S16}) {
+    const auto is_u8 = format == PcmFormat::U8;
+
+    buffer->set_format(format);
+
+    const auto ns = bench::run(
+        is_u8 ? "write + read 512 B u8" : "write + read 512 B s16", 200'000,
+        [&](size_t) {
+          const auto written = buffer->write(bytes.data(), bytes.size());
+
+          for (size_t done = 0; done < written; done += block.size()) {
+            buffer->read(block.data(), block.size());
+          }
+
+          bench::do_not_optimize(block);
+        });
+
+    std::printf("  %-48s %10.2f ns/sample\n",
+                is_u8 ? "u8 per sample" : "s16 per sample",
+                ns / (is_u8 ? 512 : 256));
+  }
+
+  // Each underrun leaves the buffer fuller by the silence it played, so
+  // small prebuffers pay with glitches first and latency later
+  std::printf("  %-20s %10s %10s %10s %10s\n", "prebuffer (samples)",
+              "latency", "settled", "underruns", "overruns");
+
+  for (const size_t prebuffer : {0, 256, 1024, 2048}) {
+    const auto [stats, latency_ms] = simulate(prebuffer);
+
+    std::printf("  %-20zu %7.1f ms %7.1f ms %10u %10u\n", prebuffer,
+                latency_ms, 1000.0 * stats.buffered_samples / SAMPLE_RATE_HZ,
+                stats.underrun_samples, stats.overrun_samples);
+  }
+}
@@ -0,0 +1,143 @@
+#include "bench.h"
+
+#include "DataCommands.h"
+#include "DeviceData.h"
+#include "SerialCommunicator.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr size_t PACKETS = 500'000;
+constexpr size_t HANDSHAKES = 50'000;
+
+SerialCommunicator comm;
+bench::EmptyCapability device_capability;
+CoreCommandQueue core_commands;
+
+void handle_data_set(pcomm::bytes::Decoder &decoder) {
+  const auto flags = decoder.pop_number<uint8_t>();
+
+  if (const auto error = process_data(flags, decoder, core_commands)) {
+    comm.send_error(static_cast<uint16_t>(error.value()));
+  }
+
+  // Stand-in for core 1
+  for (CoreCommand command; core_commands.pop(command);) {
+    bench::do_not_optimize(command);
+  }
+}
+
+using Handlers = StaticDispatchTable<
+    DataHandler, DispatchRoute<DataTypes::CommandDataSet, handle_data_set>>;
+
+void handshake(const pcomm::packets::Packet &hello) {
+  comm.on_unavailable();
+  comm.on_recv(hello);
+  comm.on_recv(bench::host_ack);
+}
+
+// CommandDataSet with a tone and an RGB color, as the host sends per frame
+pcomm::packets::Packet data_set() {
+  std::vector<uint8_t> payload;
+  const pcomm::bytes::Encoder encoder{payload};
+
+  encoder.push_number(static_cast<uint16_t>(DataTypes::CommandDataSet));
+  encoder.push_number(static_cast<uint8_t>(1 << 3 | 1 << 5));
+  encoder.push_number(440.f);
+  encoder.push_number(0.5f);
+  encoder.push_number(static_cast<uint32_t>(100));
+  encoder.push_number(static_cast<uint8_t>(255));
+  encoder.push_number(static_cast<uint8_t>(128));
+  encoder.push_number(static_cast<uint8_t>(0));
+
+  return pcomm::packets::Packet{static_cast<uint16_t>(PacketType::Data),
+                                std::move(payload)};
+}
+
+// Fast-path request carrying an 8-byte host timestamp
+pcomm::packets::Packet timestamped(const DataTypes code) {
+  std::vector<uint8_t> payload;
+  const pcomm::bytes::Encoder encoder{payload};
+
+  encoder.push_number(static_cast<uint16_t>(code));
+  encoder.push_number(static_cast<uint64_t>(0x0123456789abcdef));
+
+  return pcomm::packets::Packet{static_cast<uint16_t>(PacketType::Data),
+                                std::move(payload)};
+}
+
+} // namespace
+
+void bench_protocol() {
+  bench::section("SerialCommunicator (fake socket)");
+
+  bench::check("capability registered",
+               comm.add_capability(device_capability, device_capability));
+  comm.set_static_data_handlers(Handlers::view());
+
+  const auto hello = bench::host_hello({{device_capability.id(), {}}});
+
+  auto allocations = bench::allocations();
+
+  bench::run("handshake (hello + ack)", HANDSHAKES,
+                                       [&](size_t) { handshake(hello); });
+
+  const auto handshake_allocations =
+      static_cast<double>(bench::allocations() - allocations) /
+      (HANDSHAKES + HANDSHAKES / 10);
+
+  comm.sent.clear();
+  comm.sent.shrink_to_fit();
+
+  handshake(hello);
+
+  if (!bench::check("handshake completes", comm.is_connected()))
+    return;
+
+  // Packets arrive by value, as pcomm hands them over; the copy made here
+  // stands in for pcomm's own reassembly buffer
+  const auto packet = data_set();
+
+  allocations = bench::allocations();
+
+  const auto recv_ns = bench::run("on_recv CommandDataSet", PACKETS,
+                                  [&](size_t) { comm.on_recv(packet); });
+
+  const auto recv_allocations =
+      static_cast<double>(bench::allocations() - allocations) /
+      (PACKETS + PACKETS / 10);
+
+  const auto ping = timestamped(DataTypes::CommandPing);
+  const auto time_sync = timestamped(DataTypes::CommandTimeSync);
+
+  bench::run("on_recv CommandPing (fast path)", PACKETS,
+             [&](size_t) { comm.on_recv(ping); });
+  bench::run("on_recv CommandTimeSync (fast path)", PACKETS,
+             [&](size_t) { comm.on_recv(time_sync); });
+
+  const DeviceData sample{true, 512, 27.5f};
+
+  allocations = bench::allocations();
+  Serial.bytes_written = 0;
+
+  bench::run("send_message DeviceData", PACKETS, [&](size_t) {
+    comm.send_message<DeviceDataMessage>(sample);
+  });
+
+  const auto send_allocations =
+      static_cast<double>(bench::allocations() - allocations) /
+      (PACKETS + PACKETS / 10);
+
+  bench::print_per_op("packets/s through on_recv", 1e9 / recv_ns, "");
+  bench::print_per_op("allocations per received packet", recv_allocations,
+               "(1 is the by-value copy)");
+  bench::print_per_op("allocations per send_message", send_allocations, "");
+  bench::print_per_op("wire bytes per send_message",
+               static_cast<double>(Serial.bytes_written) /
+                   (PACKETS + PACKETS / 10),
+               "");
+  bench::print_per_op("allocations per handshake", handshake_allocations, "");
+}
@@ -0,0 +1,121 @@
+#include "bench.h"
+
+#include "RawSampleStream.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+
+constexpr uint32_t SAMPLE_RATE_HZ = 40'000;
+constexpr size_t RUNS = 200'000;
+constexpr size_t RUN_SAMPLES = ADC_BLOCK_SAMPLES / 2;
+
+uint16_t sample_at(const uint32_t i) {
+  return static_cast<uint16_t>((i * 2654435761u) >> 20);
+}
+
+uint16_t unpack(const uint8_t *payload, const size_t i) {
+  const uint8_t *pair = payload + i / 2 * 3;
+
+  if (i % 2 == 0)
+    return pair[0] | (pair[1] & 0x0f) << 8;
+
+  return (pair[1] >> 4) | pair[2] << 4;
+}
+
+template <typename T> T get_le(const uint8_t *in) {
+  T value = 0;
+
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    value |= static_cast<T>(in[i]) << (8 * i);
+  }
+
+  return value;
+}
+
+} // namespace
+
+void bench_raw_stream() {
+  bench::section("raw sample stream");
+
+  static RawSampleStream stream;
+  std::array<uint16_t, RUN_SAMPLES> run{};
+  uint32_t next = 0;
+
+  stream.begin(SAMPLE_RATE_HZ);
+
+  // The consumer keeps up, so every block is verified and released
+  bool intact = true;
+  uint32_t expected_sequence = 0;
+  uint32_t verified = 0;
+
+  const auto ns_per_run = bench::run("push (one ADC run)", RUNS, [&](size_t) {
+    for (auto &sample : run) {
+      sample = sample_at(next++);
+    }
+
+    stream.push(run.data(), run.size(), next, 0);
+
+    while (const auto block = stream.front()) {
+      const auto *bytes = block->bytes.data();
+      const auto sequence = get_le<uint32_t>(bytes);
+      const auto first = sequence * RAW_BLOCK_SAMPLES;
+
+      intact = intact && sequence == expected_sequence++ &&
+               unpack(bytes + RawSampleBlock::HEADER_SIZE, 0) ==
+                   (sample_at(first) & 0x0fff) &&
+               unpack(bytes + RawSampleBlock::HEADER_SIZE,
+                      RAW_BLOCK_SAMPLES - 1) ==
+                   (sample_at(first + RAW_BLOCK_SAMPLES - 1) & 0x0fff);
+
+      verified++;
+      stream.pop();
+    }
+  });
+
+  std::printf("  %-48s %10.2f ns/sample\n", "push", ns_per_run / RUN_SAMPLES);
+  std::printf("  %-48s %10u\n", "blocks verified", verified);
+  bench::check("sequence and packing intact", intact && verified > 0);
+
+  // A consumer that never reads: the ring fills, the rest is counted
+  stream.begin(SAMPLE_RATE_HZ);
+
+  const auto pushed_blocks = 4 * RAW_RING_BLOCKS;
+
+  for (size_t i = 0; i < pushed_blocks * RAW_BLOCK_SAMPLES / RUN_SAMPLES; ++i) {
+    stream.push(run.data(), run.size(), 0, 0);
+  }
+
+  // Drop counts are stamped when a block closes, so one more block is pushed
+  // after draining to read the total back.
+  uint32_t queued = 0;
+  uint32_t last_queued = 0;
+
+  while (const auto block = stream.front()) {
+    last_queued = get_le<uint32_t>(block->bytes.data());
+
+    stream.pop();
+    queued++;
+  }
+
+  for (size_t i = 0; i < RAW_BLOCK_SAMPLES / RUN_SAMPLES; ++i) {
+    stream.push(run.data(), run.size(), 0, 0);
+  }
+
+  const auto *bytes = stream.front()->bytes.data();
+  const auto dropped = get_le<uint32_t>(bytes + 4);
+  const auto sequence = get_le<uint32_t>(bytes);
+
+  bench::check("a stalled consumer keeps the ring's blocks",
+               queued == RAW_RING_BLOCKS && last_queued == queued - 1);
+  bench::check("the rest is reported in dropped_blocks",
+               dropped == pushed_blocks - RAW_RING_BLOCKS);
+  bench::check("the sequence gap matches dropped_blocks",
+               sequence == pushed_blocks &&
+                   sequence - last_queued - 1 == dropped);
+
+  stream.pop();
+  stream.end();
+}
@@ -0,0 +1,152 @@
+#include "bench.h"
+
+#include "DeviceData.h"
+#include "SerialCommunicator.h"
+#include "SessionResume.h"
+#include "constants.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr size_t RECONNECTS = 50'000;
+
+// A full-speed USB host polls once per 1 ms frame, so every trip across the
+// link costs up to that much before the other side even sees it
+constexpr double USB_LEG_US = 1000.;
+
+// Host to device and back before the first sample, see the steps below
+constexpr size_t HANDSHAKE_LEGS = 4;
+constexpr size_t RESUME_LEGS = 2;
+
+SerialCommunicator comm;
+bench::EmptyCapability device_capability;
+SessionResumeCapability session_capability;
+SessionResume session{session_capability};
+
+// Stand-in for the application: streaming is the state a resume keeps
+bool streaming = false;
+
+void handle_loop_on(pcomm::bytes::Decoder &) { streaming = true; }
+
+using Handlers =
+    StaticDispatchTable<DataHandler,
+                        DispatchRoute<DataTypes::CommandDataGetLoopOn,
+                                      handle_loop_on>>;
+
+// One pass of the device's loop()
+void step() {
+  if (!comm.is_connected() || !streaming)
+    return;
+
+  comm.send_message<DeviceDataMessage>({true, 512, 27.5f});
+}
+
+pcomm::packets::Packet session_resume(const uint64_t token) {
+  std::vector<uint8_t> payload;
+  const pcomm::bytes::Encoder encoder{payload};
+
+  encoder.push_number(SerialCommunicator::VERSION);
+  encoder.push_number(token);
+
+  return pcomm::packets::Packet{
+      static_cast<uint16_t>(PacketType::SessionResume), std::move(payload)};
+}
+
+pcomm::packets::Packet loop_on() {
+  std::vector<uint8_t> payload;
+  const pcomm::bytes::Encoder encoder{payload};
+
+  encoder.push_number(static_cast<uint16_t>(DataTypes::CommandDataGetLoopOn));
+
+  return pcomm::packets::Packet{static_cast<uint16_t>(PacketType::Data),
+                                std::move(payload)};
+}
+
+} // namespace
+
+void bench_session() {
+  bench::section("Reconnect to first sample (fake socket)");
+
+  bench::check(
+      "capabilities registered",
+      comm.add_capability(device_capability, device_capability) &&
+          comm.add_capability(session_capability, session_capability));
+  comm.set_session_resume(session);
+  comm.set_static_data_handlers(Handlers::view());
+  comm.on_session_end([] { streaming = false; });
+
+  const auto hello = bench::host_hello(
+      {{device_capability.id(), {}}, {session_capability.id(), {}}});
+  const auto stream = loop_on();
+
+  // Full path: HostHello -> DeviceHello, HostAck + loop on -> first sample
+  const auto handshake_ns =
+      bench::run("drop + handshake + loop on + sample", RECONNECTS,
+                 [&](size_t) {
+                   comm.on_unavailable();
+                   comm.on_recv(hello);
+                   comm.on_recv(bench::host_ack);
+                   comm.on_recv(stream);
+                   step();
+                 });
+
+  bench::check("handshake resets streaming", [&] {
+    comm.on_unavailable();
+    comm.on_recv(hello);
+    comm.on_recv(bench::host_ack);
+
+    return comm.is_connected() && !streaming;
+  }());
+
+  comm.on_recv(stream);
+
+  const auto resume = session_resume(session_capability.token());
+
+  // Resume path: SessionResume -> SessionResumed and the next sample
+  const auto resume_ns = bench::run("drop + resume + sample", RECONNECTS,
+                                    [&](size_t) {
+                                      comm.on_unavailable();
+                                      comm.on_recv(resume);
+                                      step();
+                                    });
+
+  bench::check("resume keeps streaming", [&] {
+    comm.on_unavailable();
+    comm.on_recv(resume);
+
+    return comm.is_connected() && streaming;
+  }());
+
+  bench::check("wrong token is refused", [&] {
+    comm.on_unavailable();
+    comm.on_recv(session_resume(session_capability.token() + 1));
+
+    return !comm.is_connected() && streaming;
+  }());
+
+  bench::check("grace window ends the session", [&] {
+    // Jumps past the window instead of waiting it out
+    const auto now = time_us_64();
+
+    return !session.expire(now) &&
+           session.expire(now + SESSION_GRACE_MS * 1000ull) &&
+           !session.suspended();
+  }());
+
+  comm.sent.clear();
+
+  // Only the device's share is measured; the USB legs are assumed
+  bench::print_per_op("measured device time, handshake",
+                      handshake_ns / 1000., "us");
+  bench::print_per_op("measured device time, resume", resume_ns / 1000.,
+                      "us");
+  bench::print_per_op("modeled latency, handshake (4 USB legs)",
+                      HANDSHAKE_LEGS * USB_LEG_US + handshake_ns / 1000.,
+                      "us (modeled)");
+  bench::print_per_op("modeled latency, resume (2 USB legs)",
+                      RESUME_LEGS * USB_LEG_US + resume_ns / 1000.,
+                      "us (modeled)");
+}
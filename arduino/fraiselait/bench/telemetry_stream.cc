@@ -0,0 +1,138 @@
+#include "bench.h"
+
+#include "TelemetryStream.h"
+#include "constants.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <pico/time.h>
+#include <vector>
+
+namespace {
+
+constexpr size_t ROUNDS = 200'000;
+constexpr uint8_t BATCH = 4;
+
+// Samples are told apart by their light reading
+int32_t next_light = 0;
+
+DeviceData sample() { return {false, ++next_light, 27.5f}; }
+
+void fire(const size_t times) {
+  for (size_t i = 0; i < times; ++i) {
+    fire_repeating_timers();
+  }
+}
+
+std::vector<uint8_t> serialize(const TelemetryBlock &block) {
+  std::vector<uint8_t> bytes;
+
+  block.serialize(pcomm::bytes::Encoder{bytes});
+
+  return bytes;
+}
+
+void check_start() {
+  TelemetryStream stream{sample};
+
+  const bool rejected = !stream.start(MIN_STREAM_PERIOD_US - 1, 1) &&
+                        !stream.start(MIN_STREAM_PERIOD_US, 0) &&
+                        !stream.start(MIN_STREAM_PERIOD_US,
+                                      MAX_STREAM_BATCH + 1);
+
+  bench::check("start rejects short periods and bad batches",
+               rejected && !stream.active());
+
+  stream.start(MIN_STREAM_PERIOD_US, 1);
+  stream.stop();
+
+  bench::check("stop cancels the timer",
+               !stream.active() && active_repeating_timers.empty());
+}
+
+void check_batches() {
+  TelemetryStream stream{sample};
+  TelemetryBlock block;
+
+  next_light = 0;
+
+  stream.start(1'000, BATCH);
+  fire(BATCH - 1);
+
+  const bool early = !stream.batch_ready();
+
+  fire(1);
+
+  const bool taken = stream.batch_ready() && stream.take_batch(block);
+
+  bench::check("a batch is ready after batch_size samples",
+               early && taken && block.count == BATCH &&
+                   block.sequence == 0 && block.dropped_samples == 0);
+
+  bool in_order = true;
+
+  for (uint8_t i = 0; i < block.count; ++i) {
+    in_order &= block.samples[i].data.light_strength_average == i + 1;
+    in_order &= i == 0 || block.samples[i].timestamp_us >=
+                              block.samples[i - 1].timestamp_us;
+  }
+
+  bench::check("samples keep their order and timestamps", in_order);
+
+  // sequence(4) dropped(4) base(8) count(1), then offset(4) + DeviceData
+  std::vector<uint8_t> device_data;
+
+  DeviceDataMessage::encode(block.samples[0].data,
+                            pcomm::bytes::Encoder{device_data});
+
+  const auto bytes = serialize(block);
+  pcomm::bytes::Decoder decoder{bytes.data(), bytes.size()};
+
+  decoder.pop_number<uint32_t>();
+  decoder.pop_number<uint32_t>();
+
+  const bool header =
+      decoder.pop_number<uint64_t>() == block.samples[0].timestamp_us &&
+      decoder.pop_byte() == BATCH && decoder.pop_number<uint32_t>() == 0;
+
+  bench::check("block layout matches ResponseDataStream",
+               header && bytes.size() == 17 + BATCH * (4 + device_data.size()));
+
+  fire(STREAM_BUFFER_SAMPLES + 3);
+
+  stream.take_batch(block);
+
+  bench::check("a full ring drops and counts samples",
+               block.sequence == 1 && block.dropped_samples == 3);
+
+  stream.stop();
+}
+
+} // namespace
+
+void bench_telemetry_stream() {
+  bench::section("TelemetryStream");
+
+  check_start();
+  check_batches();
+
+  TelemetryStream stream{sample};
+  TelemetryBlock block;
+  std::vector<uint8_t> bytes;
+
+  bytes.reserve(256);
+
+  stream.start(1'000, 8);
+
+  bench::run("8 samples + take_batch + serialize", ROUNDS, [&](size_t) {
+    fire(8);
+    stream.take_batch(block);
+
+    bytes.clear();
+    block.serialize(pcomm::bytes::Encoder{bytes});
+
+    bench::do_not_optimize(bytes.data());
+  });
+
+  stream.stop();
+}
@@ -0,0 +1,110 @@
+#include "bench.h"
+
+#include "ToneSequence.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr size_t ROUNDS = 200'000;
+
+// count(1) and then each step in its wire form
+std::vector<uint8_t> sequence_body(const std::vector<ToneStep> &steps,
+                                   const size_t count) {
+  std::vector<uint8_t> body;
+  const pcomm::bytes::Encoder encoder{body};
+
+  encoder.push_number(static_cast<uint8_t>(count));
+
+  for (const auto &step : steps) {
+    encoder.push_number(step.frequency_dhz);
+    encoder.push_number(step.duration_ms);
+    encoder.push_number(step.gap_ms);
+    encoder.push_number(step.volume);
+    encoder.push_number(step.waveform);
+  }
+
+  return body;
+}
+
+bool parses(const std::vector<uint8_t> &body, ToneSequence &sequence) {
+  pcomm::bytes::Decoder decoder{body.data(), body.size()};
+
+  return parse_tone_sequence(decoder, sequence);
+}
+
+// A4, a rest and then C5 on a triangle wave
+const std::vector<ToneStep> TUNE{
+    {4400, 200, 20, 255, 0},
+    {0, 100, 0, 0, 0},
+    {5233, 400, 0, 128, static_cast<uint8_t>(WaveformType::Triangle)},
+};
+
+void check_parse() {
+  ToneSequence sequence;
+
+  const bool parsed = parses(sequence_body(TUNE, TUNE.size()), sequence);
+  const auto &last = sequence.steps[2];
+
+  bench::check("parse: tune", parsed && sequence.count == TUNE.size() &&
+                                  last.frequency_dhz == 5233 &&
+                                  last.duration_ms == 400 &&
+                                  last.waveform == TUNE[2].waveform);
+
+  bench::check("parse: empty body is refused", !parses({}, sequence));
+  bench::check("parse: zero steps are refused",
+               !parses(sequence_body({}, 0), sequence));
+
+  auto truncated = sequence_body(TUNE, TUNE.size());
+
+  truncated.pop_back();
+
+  bench::check("parse: truncated step is refused",
+               !parses(truncated, sequence));
+  bench::check("parse: count past the body is refused",
+               !parses(sequence_body(TUNE, TUNE.size() + 1), sequence));
+
+  const std::vector<ToneStep> too_many(TONE_SEQUENCE_CAPACITY + 1,
+                                       TUNE.front());
+
+  bench::check("parse: over TONE_SEQUENCE_CAPACITY is refused",
+               !parses(sequence_body(too_many, too_many.size()), sequence));
+
+  const std::vector<ToneStep> full(TONE_SEQUENCE_CAPACITY, TUNE.front());
+
+  bench::check("parse: exactly TONE_SEQUENCE_CAPACITY fits",
+               parses(sequence_body(full, full.size()), sequence) &&
+                   sequence.count == TONE_SEQUENCE_CAPACITY);
+
+  auto silent = TUNE;
+
+  silent[1].duration_ms = 0;
+
+  bench::check("parse: zero duration is refused",
+               !parses(sequence_body(silent, silent.size()), sequence));
+
+  auto unknown = TUNE;
+
+  unknown[0].waveform = static_cast<uint8_t>(WaveformType::Noise) + 1;
+
+  bench::check("parse: unknown waveform is refused",
+               !parses(sequence_body(unknown, unknown.size()), sequence));
+}
+
+} // namespace
+
+void bench_tone_sequence() {
+  bench::section("tone sequence");
+
+  check_parse();
+
+  const std::vector<ToneStep> full(TONE_SEQUENCE_CAPACITY, TUNE.front());
+  const auto body = sequence_body(full, full.size());
+  ToneSequence sequence;
+
+  bench::run("parse (128 steps)", ROUNDS, [&](size_t) {
+    bench::do_not_optimize(parses(body, sequence));
+  });
+}
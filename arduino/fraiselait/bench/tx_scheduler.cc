@@ -0,0 +1,168 @@
+#include "bench.h"
+
+#include "FrameWriter.h"
+#include "constants.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// Bulk bandwidth of USB full-speed: 19 64-byte packets per 1 ms frame
+constexpr double LINK_BYTES_PER_SECOND = 19 * 64 * 1000;
+constexpr size_t USB_PACKET_SIZE = 64;
+
+constexpr uint16_t DATA_TYPE = 0x0004;
+constexpr uint16_t ERROR_TYPE = 0x0005;
+
+// Code(2) plus body of a raw sample block, as sent by send_raw_block
+constexpr size_t BULK_FRAME_SIZE = 2 + 26 + 1536;
+constexpr size_t BULK_FRAMES = 2;
+
+// Link time the simulated USB buffer has drained for, in whole packets
+uint32_t link_us = 0;
+
+uint32_t link_clock() { return link_us; }
+
+// A USB buffer of USB_TX_BUFFER_SIZE drained at full-speed bulk rate. The
+// host sees an error once its last byte has left the buffer.
+struct SimulatedLink {
+  size_t written = 0;
+  size_t drained = 0;
+  size_t error_end = 0;
+
+  [[nodiscard]] size_t buffered() const { return written - drained; }
+
+  void drain_packet() {
+    drained = std::min(written, drained + USB_PACKET_SIZE);
+    link_us = static_cast<uint32_t>(drained * 1e6 / LINK_BYTES_PER_SECOND);
+  }
+
+  // Blocks like Serial.write by draining until the chunk fits
+  void write(const uint8_t *data, const size_t size) {
+    while (buffered() + size > USB_TX_BUFFER_SIZE) {
+      drain_packet();
+    }
+
+    written += size;
+
+    // The COBS overhead byte precedes the low byte of the chunk type
+    if (data[1] == ERROR_TYPE)
+      error_end = written;
+  }
+
+  [[nodiscard]] double error_latency_us() const {
+    return error_end * 1e6 / LINK_BYTES_PER_SECOND;
+  }
+};
+
+struct Result {
+  double error_latency_us;
+  TxStats stats;
+  size_t idle_packets;
+};
+
+// Queues BULK_FRAMES raw blocks and then an error, the way a malformed host
+// packet arriving mid-stream would, and runs the link until all is sent.
+Result run_burst(const bool scheduled, const std::vector<uint8_t> &body) {
+  SimulatedLink link;
+
+  link_us = 0;
+
+  FrameWriter writer{[&](const uint8_t *data, const size_t size) {
+    link.write(data, size);
+  }};
+
+  writer.set_clock(link_clock);
+
+  if (scheduled) {
+    // Same policy as SerialCommunicator
+    writer.set_room([&] {
+      const auto available = USB_TX_BUFFER_SIZE - link.buffered();
+
+      return available + USB_TX_BACKLOG >= USB_TX_BUFFER_SIZE ? available : 0;
+    });
+  }
+
+  for (size_t i = 0; i < BULK_FRAMES; ++i) {
+    writer.write(DATA_TYPE, {{body.data(), BULK_FRAME_SIZE}},
+                 TxPriority::Bulk);
+  }
+
+  const std::array<uint8_t, 2> code{0x02, 0x00};
+
+  writer.write(ERROR_TYPE, {{code.data(), code.size()}}, TxPriority::Control);
+
+  size_t idle_packets = 0;
+
+  while (!writer.idle() || link.buffered() > 0) {
+    writer.pump();
+
+    if (link.buffered() == 0)
+      idle_packets++;
+
+    link.drain_packet();
+  }
+
+  return {link.error_latency_us(), writer.stats(), idle_packets};
+}
+
+void print_result(const char *name, const Result &result) {
+  const auto &control =
+      result.stats.classes[static_cast<size_t>(TxPriority::Control)];
+  const auto &bulk =
+      result.stats.classes[static_cast<size_t>(TxPriority::Bulk)];
+
+  std::printf("  %-24s %10.0f us %7u us %7u us %6u %6zu\n", name,
+              result.error_latency_us, control.max_wait_us, bulk.max_wait_us,
+              bulk.max_depth, result.idle_packets);
+}
+
+} // namespace
+
+void bench_tx_scheduler() {
+  bench::section("tx scheduler");
+
+  std::vector<uint8_t> body(FrameWriter::MAX_FRAME_SIZE);
+
+  for (size_t i = 0; i < body.size(); ++i) {
+    body[i] = static_cast<uint8_t>(i * 31);
+  }
+
+  std::printf("  error behind %zu raw blocks, %u B chunks\n", BULK_FRAMES,
+              FrameWriter::DEFAULT_CHUNK_SIZE);
+  std::printf("  %-24s %13s %10s %10s %6s %6s\n", "", "error seen",
+              "ctl wait", "bulk wait", "depth", "idle");
+
+  print_result("in write order", run_burst(false, body));
+  print_result("by priority", run_burst(true, body));
+
+  // Cost of holding a frame back: the copy into the queue and the chunks
+  // written later by pump()
+  size_t wire_bytes = 0;
+  bool full = false;
+
+  FrameWriter writer{[&](const uint8_t *, const size_t size) {
+    wire_bytes += size;
+  }};
+
+  writer.set_room([&]() -> size_t { return full ? 0 : SIZE_MAX; });
+
+  bench::run("write-through raw block", 2'000, [&](size_t) {
+    writer.write(DATA_TYPE, {{body.data(), BULK_FRAME_SIZE}},
+                 TxPriority::Bulk);
+  });
+
+  bench::run("queued raw block + pump", 2'000, [&](size_t) {
+    full = true;
+    writer.write(DATA_TYPE, {{body.data(), BULK_FRAME_SIZE}},
+                 TxPriority::Bulk);
+    full = false;
+    writer.pump();
+  });
+
+  bench::do_not_optimize(wire_bytes);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// Just enough of the Arduino-Pico core for the protocol code to build in the
+// native environment. Nothing here touches hardware.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#define HIGH 1
+#define LOW 0
+#define LED_BUILTIN 25
+#define SRAM_END 0x20042000
+
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+inline void watchdog_reboot(uint32_t, uint32_t, uint32_t) {}
+
+inline void delay(unsigned long) {}
+
+inline uint64_t time_us_64() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+inline uint32_t time_us_32() { return static_cast<uint32_t>(time_us_64()); }
+
+// Counts what the framing layer writes instead of sending it anywhere.
+struct FakeSerial {
+  size_t bytes_written = 0;
+  size_t writes = 0;
+
+  explicit operator bool() const { return true; }
+
+  void begin(unsigned long) {}
+
+  size_t write(const uint8_t *, const size_t size) {
+    bytes_written += size;
+    writes++;
+
+    return size;
+  }
+
+  // Always empty, so frames are never held back
+  [[nodiscard]] int availableForWrite() const { return 2048; }
+};
+
+inline FakeSerial Serial;
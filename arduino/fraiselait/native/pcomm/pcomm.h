@@ -0,0 +1,110 @@
+#pragma once
+
+// In-memory stand-in for pcomm used by the native environment. Byte
+// encoding matches the device (little endian); the socket keeps every
+// packet sent through it instead of writing to USB, and packets are
+// delivered by calling on_recv directly.
+
+#include <Arduino.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pcomm {
+
+namespace bytes {
+
+class Encoder {
+public:
+  explicit Encoder(std::vector<uint8_t> &buffer) : buffer(buffer) {}
+
+  template <typename T> void push_number(const T value) const {
+    uint8_t bytes[sizeof(T)];
+
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+  }
+
+  void push_bytes(const uint8_t *data, const size_t size) const {
+    buffer.insert(buffer.end(), data, data + size);
+  }
+
+  void push_bool(const bool value) const { buffer.push_back(value); }
+
+private:
+  std::vector<uint8_t> &buffer;
+};
+
+class Decoder {
+public:
+  Decoder(const uint8_t *data, const size_t size) : data(data), size(size) {}
+
+  template <typename T> T pop_number() {
+    T value;
+
+    std::memcpy(&value, data + position, sizeof(T));
+    position += sizeof(T);
+
+    return value;
+  }
+
+  void pop_bytes(uint8_t *out, const size_t count) {
+    std::memcpy(out, data + position, count);
+    position += count;
+  }
+
+  uint8_t pop_byte() { return data[position++]; }
+
+  bool pop_bool() { return data[position++] != 0; }
+
+  [[nodiscard]] size_t remaining() const { return size - position; }
+
+private:
+  const uint8_t *data;
+  size_t size;
+  size_t position = 0;
+};
+
+} // namespace bytes
+
+namespace packets {
+
+struct Packet {
+  uint16_t type;
+  std::vector<uint8_t> payload;
+
+  explicit Packet(const uint16_t type, std::vector<uint8_t> payload = {})
+      : type(type), payload(std::move(payload)) {}
+};
+
+} // namespace packets
+
+namespace socket {
+
+class SerialUSBSocket {
+public:
+  virtual ~SerialUSBSocket() = default;
+
+  virtual void on_recv(packets::Packet packet) = 0;
+
+  virtual void on_unavailable() {}
+
+  void update() {}
+
+  void send(packets::Packet packet) { sent.push_back(std::move(packet)); }
+
+  void send_debug(const std::string &) { debug_messages++; }
+
+  // Packets sent through send(); frames written by FrameWriter go to
+  // Serial instead
+  std::vector<packets::Packet> sent;
+  size_t debug_messages = 0;
+};
+
+} // namespace socket
+
+} // namespace pcomm
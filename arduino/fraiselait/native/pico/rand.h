@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+inline uint64_t get_rand_64() {
+  static std::mt19937_64 engine{0x5eed};
+
+  return engine();
+}
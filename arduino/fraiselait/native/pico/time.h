@@ -0,0 +1,44 @@
+#pragma once
+
+// Repeating timers never fire on their own in the native environment; the
+// bench calls fire_repeating_timers() to stand in for the hardware alarm.
+
+#include <cstdint>
+#include <vector>
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+
+struct repeating_timer {
+  int64_t delay_us;
+  repeating_timer_callback_t callback;
+  void *user_data;
+};
+
+inline std::vector<repeating_timer_t *> active_repeating_timers;
+
+inline bool add_repeating_timer_us(const int64_t delay_us,
+                                   const repeating_timer_callback_t callback,
+                                   void *user_data, repeating_timer_t *out) {
+  *out = {delay_us, callback, user_data};
+
+  active_repeating_timers.push_back(out);
+
+  return true;
+}
+
+inline bool cancel_repeating_timer(repeating_timer_t *timer) {
+  return std::erase(active_repeating_timers, timer) > 0;
+}
+
+// Runs every active timer's callback once; a callback returning false
+// cancels its timer as on the device.
+inline void fire_repeating_timers() {
+  const auto timers = active_repeating_timers;
+
+  for (const auto timer : timers) {
+    if (!timer->callback(timer)) {
+      cancel_repeating_timer(timer);
+    }
+  }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+struct pico_unique_board_id_t {
+  uint8_t id[8];
+};
+
+inline void pico_get_unique_board_id(pico_unique_board_id_t *board_id) {
+  for (uint8_t i = 0; i < 8; ++i) {
+    board_id->id[i] = i;
+  }
+}
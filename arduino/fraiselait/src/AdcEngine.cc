@@ -0,0 +1,23 @@
+#include "AdcEngine.h"
+
+size_t AdcEngine::poll() {
+  size_t delivered = 0;
+
+  for (auto block = source.acquire(); block.size > 0;
+       block = source.acquire()) {
+    const auto count = block.size / IAdcSource::CHANNELS;
+
+    for (size_t i = 0; i < count; ++i) {
+      light[i] = block.samples[2 * i];
+      temperature[i] = block.samples[2 * i + 1];
+    }
+
+    source.release();
+
+    sink(light.data(), temperature.data(), count, block.completed_at_us);
+
+    delivered += count;
+  }
+
+  return delivered;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "AdcSource.h"
+#include "constants.h"
+
+// Pulls completed blocks from an IAdcSource and hands them to a sink split
+// into one contiguous run per channel.
+class AdcEngine {
+public:
+  static constexpr size_t SAMPLES_PER_CHANNEL =
+      ADC_BLOCK_SAMPLES / IAdcSource::CHANNELS;
+
+  // completed_at_us is the device time of the last sample in the run.
+  using Sink = void (*)(const uint16_t *light, const uint16_t *temperature,
+                        size_t count, uint64_t completed_at_us);
+
+  AdcEngine(IAdcSource &source, const Sink sink)
+      : source(source), sink(sink) {}
+
+  bool start(const uint32_t sample_rate_hz) {
+    return source.start(sample_rate_hz);
+  }
+
+  void stop() { source.stop(); }
+
+  // Drains every completed block; returns the number of samples delivered
+  // per channel.
+  size_t poll();
+
+  [[nodiscard]] uint32_t overruns() const { return source.overruns(); }
+
+private:
+  IAdcSource &source;
+  Sink sink;
+
+  std::array<uint16_t, SAMPLES_PER_CHANNEL> light{};
+  std::array<uint16_t, SAMPLES_PER_CHANNEL> temperature{};
+};
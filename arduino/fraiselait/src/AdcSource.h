@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Completed block of raw 12-bit conversions. Samples are interleaved in
+// round-robin order: light sensor, temperature, light sensor, ...
+struct AdcBlock {
+  const uint16_t *samples = nullptr;
+  size_t size = 0;
+  // Device time (time_us_64) the last conversion landed in the block
+  uint64_t completed_at_us = 0;
+};
+
+class IAdcSource {
+public:
+  static constexpr size_t CHANNELS = 2;
+
+  virtual ~IAdcSource() = default;
+
+  // sample_rate_hz is the total conversion rate across all channels.
+  virtual bool start(uint32_t sample_rate_hz) = 0;
+
+  virtual void stop() = 0;
+
+  // Oldest completed block that has not been released yet, or an empty
+  // block if none is ready.
+  [[nodiscard]] virtual AdcBlock acquire() = 0;
+
+  virtual void release() = 0;
+
+  // Blocks overwritten before they were consumed.
+  [[nodiscard]] virtual uint32_t overruns() const = 0;
+};
@@ -0,0 +1,20 @@
+#include "ChunkMtu.h"
+
+#include <algorithm>
+
+void ChunkMtuCapability::serialize(const pcomm::bytes::Encoder &encoder) const {
+  encoder.push_number(tx_chunk_size);
+  // Incoming chunks are reassembled by pcomm, which is fixed at the default
+  encoder.push_number(FrameWriter::DEFAULT_CHUNK_SIZE);
+}
+
+bool ChunkMtuCapability::deserialize(pcomm::bytes::Decoder &decoder) {
+  const auto host_max = decoder.pop_number<uint16_t>();
+
+  if (host_max < FrameWriter::DEFAULT_CHUNK_SIZE)
+    return false;
+
+  tx_chunk_size = std::min(host_max, FrameWriter::MAX_CHUNK_SIZE);
+
+  return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include "FrameWriter.h"
+#include "SerialCommunicator.h"
+
+// Negotiates the chunk payload size for frames the device sends. The host
+// sends the largest chunk payload it accepts in HostHello:
+//   max_chunk_size(2)
+// and the device answers with the size it will use from the end of the
+// handshake on, and the size it accepts in the other direction:
+//   tx_chunk_size(2) rx_chunk_size(2)
+// Hosts that do not send the capability keep getting
+// FrameWriter::DEFAULT_CHUNK_SIZE chunks.
+class ChunkMtuCapability final : public ICapability {
+public:
+  static constexpr uint16_t ID = 0x0043;
+
+  [[nodiscard]] uint16_t id() const override { return ID; }
+
+  [[nodiscard]] uint16_t min_size() const override { return 2; }
+
+  void serialize(const pcomm::bytes::Encoder &encoder) const override;
+
+  bool deserialize(pcomm::bytes::Decoder &decoder) override;
+
+  void reset() override { tx_chunk_size = FrameWriter::DEFAULT_CHUNK_SIZE; }
+
+  [[nodiscard]] uint16_t chunk_size() const { return tx_chunk_size; }
+
+private:
+  uint16_t tx_chunk_size = FrameWriter::DEFAULT_CHUNK_SIZE;
+};
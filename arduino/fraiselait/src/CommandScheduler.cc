@@ -0,0 +1,60 @@
+#include "CommandScheduler.h"
+
+#include <algorithm>
+
+namespace {
+
+// Min-heap on (at, order) so commands with the same target keep their
+// submission order
+constexpr auto later = [](const auto &a, const auto &b) {
+  return a.at != b.at ? a.at > b.at : a.order > b.order;
+};
+
+} // namespace
+
+void CommandScheduler::submit(const CoreCommand &command,
+                              const uint64_t now_us) {
+  if (command.type == CoreCommandType::ClearSchedule) {
+    count = 0;
+
+    return;
+  }
+
+  if (command.execute_at_us == CoreCommand::IMMEDIATE ||
+      command.execute_at_us <= now_us) {
+    executor(command);
+
+    return;
+  }
+
+  push(command);
+}
+
+void CommandScheduler::poll(const uint64_t now_us) {
+  while (count > 0 && heap.front().at <= now_us) {
+    std::pop_heap(heap.begin(), heap.begin() + count, later);
+
+    // Copied out: the executor may submit, which reuses the slot
+    const auto entry = heap[--count];
+
+    scheduler_stats.max_lateness_us =
+        std::max(scheduler_stats.max_lateness_us,
+                 static_cast<uint32_t>(now_us - entry.at));
+
+    executor(entry.command);
+  }
+}
+
+void CommandScheduler::push(const CoreCommand &command) {
+  if (count == heap.size()) {
+    scheduler_stats.dropped++;
+
+    return;
+  }
+
+  heap[count++] = {command.execute_at_us, next_order++, command};
+
+  std::push_heap(heap.begin(), heap.begin() + count, later);
+
+  scheduler_stats.scheduled++;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "CoreCommand.h"
+#include "constants.h"
+
+struct SchedulerStats {
+  uint32_t scheduled = 0;
+  uint32_t dropped = 0;
+  uint32_t max_lateness_us = 0;
+};
+
+// Holds commands with a future execute_at_us in a time-ordered heap and
+// applies them once poll() finds them due. Commands with the same due time
+// keep their submission order. Everything, the executor included, runs in
+// thread context on the owning core's loop, never from an interrupt; core 1
+// spins through loop1() without blocking, so polling keeps lateness within
+// one loop pass.
+class CommandScheduler {
+public:
+  using Executor = void (*)(const CoreCommand &command);
+
+  explicit CommandScheduler(const Executor executor) : executor(executor) {}
+
+  // Applies the command right away if it is immediate or already due at
+  // `now_us`; otherwise holds it until poll() finds it due.
+  void submit(const CoreCommand &command, uint64_t now_us);
+
+  // Applies everything due at `now_us`; call from the owning core's loop.
+  void poll(uint64_t now_us);
+
+  [[nodiscard]] size_t pending() const { return count; }
+
+  [[nodiscard]] const SchedulerStats &stats() const { return scheduler_stats; }
+
+private:
+  struct Entry {
+    uint64_t at;
+    uint32_t order;
+    CoreCommand command;
+  };
+
+  Executor executor;
+
+  std::array<Entry, SCHEDULED_COMMAND_CAPACITY> heap{};
+  size_t count = 0;
+  uint32_t next_order = 0;
+
+  SchedulerStats scheduler_stats;
+
+  void push(const CoreCommand &command);
+};
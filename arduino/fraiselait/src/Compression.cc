@@ -0,0 +1,64 @@
+#include "Compression.h"
+
+#include "constants.h"
+
+void CompressionCapability::serialize(
+    const pcomm::bytes::Encoder &encoder) const {
+  encoder.push_number(static_cast<uint8_t>(
+      1u << static_cast<uint8_t>(CompressionCodec::Lz) |
+      1u << static_cast<uint8_t>(CompressionCodec::Adc12Delta)));
+}
+
+bool CompressionCapability::deserialize(pcomm::bytes::Decoder &decoder) {
+  host_codecs = decoder.pop_byte();
+
+  return true;
+}
+
+size_t Compressor::compress(const uint8_t *body, const size_t size,
+                            CompressionHint hint) {
+  if (!config.enabled() || hint.codec == CompressionCodec::None ||
+      size < COMPRESSION_MIN_SIZE)
+    return 0;
+
+  if (!config.supports(hint.codec)) {
+    // Generic fallback for hosts without the specialised codec
+    hint = {CompressionCodec::Lz};
+
+    if (!config.supports(hint.codec))
+      return 0;
+  }
+
+  uint8_t *out = buffer.data();
+
+  *out++ = static_cast<uint8_t>(hint.codec);
+  *out++ = static_cast<uint8_t>(size);
+  *out++ = static_cast<uint8_t>(size >> 8);
+
+  if (hint.codec == CompressionCodec::Adc12Delta) {
+    *out++ = static_cast<uint8_t>(hint.verbatim_prefix);
+    *out++ = static_cast<uint8_t>(hint.verbatim_prefix >> 8);
+  }
+
+  const auto header_size = static_cast<size_t>(out - buffer.data());
+  // Anything that does not beat the plain body is not worth sending
+  const auto capacity = size > header_size ? size - header_size - 1 : 0;
+
+  const auto encoded_size =
+      hint.codec == CompressionCodec::Adc12Delta
+          ? compression::adc12_delta_compress(body, size, hint.verbatim_prefix,
+                                              out, capacity)
+          : compression::lz_compress(body, size, out, capacity, lz_table);
+
+  if (encoded_size == 0) {
+    tx_stats.skipped++;
+
+    return 0;
+  }
+
+  tx_stats.frames++;
+  tx_stats.raw_bytes += size;
+  tx_stats.compressed_bytes += header_size + encoded_size;
+
+  return header_size + encoded_size;
+}
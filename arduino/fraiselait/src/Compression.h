@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "FrameWriter.h"
+#include "SerialCommunicator.h"
+#include "codecs.h"
+
+// Negotiates CompressedData frames. The host lists the codecs it can decode
+// in HostHello, one bit per CompressionCodec value:
+//   codecs(1)
+// and the device answers with the codecs it can encode in the same form.
+class CompressionCapability final : public ICapability {
+public:
+  static constexpr uint16_t ID = 0x0044;
+
+  [[nodiscard]] uint16_t id() const override { return ID; }
+
+  [[nodiscard]] uint16_t min_size() const override { return 1; }
+
+  void serialize(const pcomm::bytes::Encoder &encoder) const override;
+
+  bool deserialize(pcomm::bytes::Decoder &decoder) override;
+
+  void reset() override { host_codecs = 0; }
+
+  [[nodiscard]] bool supports(const CompressionCodec codec) const {
+    return host_codecs & (1u << static_cast<uint8_t>(codec));
+  }
+
+  [[nodiscard]] bool enabled() const { return host_codecs != 0; }
+
+private:
+  uint8_t host_codecs = 0;
+};
+
+struct CompressionStats {
+  uint32_t frames = 0;
+  uint32_t raw_bytes = 0;
+  uint32_t compressed_bytes = 0;
+  // Frames sent as plain Data because compressing did not pay off
+  uint32_t skipped = 0;
+};
+
+// Body of a CompressedData frame after the data code:
+//   codec(1) raw_size(2) [verbatim_prefix(2), Adc12Delta only] data
+class Compressor {
+public:
+  static constexpr size_t MAX_HEADER_SIZE = 1 + 2 + 2;
+
+  explicit Compressor(const CompressionCapability &config) : config(config) {}
+
+  // Encodes body into an internal buffer. Returns the encoded size, or 0
+  // when the body should go out uncompressed.
+  size_t compress(const uint8_t *body, size_t size, CompressionHint hint);
+
+  [[nodiscard]] const uint8_t *data() const { return buffer.data(); }
+
+  [[nodiscard]] const CompressionStats &stats() const { return tx_stats; }
+
+private:
+  const CompressionCapability &config;
+
+  std::array<uint8_t, FrameWriter::MAX_FRAME_SIZE> buffer{};
+  compression::LzTable lz_table{};
+
+  CompressionStats tx_stats;
+};
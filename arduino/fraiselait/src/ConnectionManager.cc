@@ -0,0 +1,120 @@
+#include "ConnectionManager.h"
+
+#include <Arduino.h>
+
+#include "constants.h"
+
+void ConnectionManager::begin() {
+  current = State::WaitingForHost;
+  next_check_us = 0;
+
+  start_blinking();
+}
+
+bool ConnectionManager::poll(const bool connected) {
+  if (lost) {
+    lost = false;
+
+    enter(State::WaitingForHost);
+  }
+
+  switch (current) {
+    case State::WaitingForHost: {
+      const auto now = time_us_64();
+
+      if (now < next_check_us)
+        return false;
+
+      next_check_us = now + poll_interval_us;
+
+      if (!link_up())
+        return false;
+
+      enter(State::Handshaking);
+
+      return true;
+    }
+
+    case State::Handshaking:
+      if (connected) {
+        enter(State::Connected);
+      }
+
+      return true;
+
+    case State::Connected:
+      if (!connected) {
+        // Dropped back to a handshake without losing the port
+        enter(State::Handshaking);
+      }
+
+      return true;
+  }
+
+  return true;
+}
+
+void ConnectionManager::enter(const State next) {
+  if (next == current)
+    return;
+
+  // Set by the host through core 1; nothing else drives the pin while
+  // connected
+  if (current == State::Connected) {
+    host_led = digitalRead(LED_BUILTIN) == HIGH;
+  }
+
+  current = next;
+
+  if (blinking) {
+    cancel_repeating_timer(&blink_timer);
+
+    blinking = false;
+  }
+
+  switch (next) {
+    case State::WaitingForHost:
+      next_check_us = 0;
+
+      start_blinking();
+
+      break;
+
+    case State::Handshaking:
+      set_led(true);
+
+      break;
+
+    case State::Connected:
+      set_led(host_led);
+
+      break;
+  }
+}
+
+void ConnectionManager::reset_host_led() {
+  host_led = false;
+
+  if (current == State::Connected) {
+    set_led(false);
+  }
+}
+
+void ConnectionManager::start_blinking() {
+  blinking = add_repeating_timer_ms(-static_cast<int32_t>(STATUS_LED_BLINK_MS),
+                                    on_blink, this, &blink_timer);
+}
+
+void ConnectionManager::set_led(const bool on) {
+  led_on = on;
+
+  digitalWrite(LED_BUILTIN, on ? HIGH : LOW);
+}
+
+bool ConnectionManager::on_blink(repeating_timer_t *rt) {
+  auto &self = *static_cast<ConnectionManager *>(rt->user_data);
+
+  self.set_led(!self.led_on);
+
+  return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+#include <pico/time.h>
+
+// Tracks the USB link from loop() without ever blocking:
+//   WaitingForHost -> Handshaking   when a host opens the port
+//   Handshaking    -> Connected     when the handshake completes
+//   any            -> WaitingForHost when the communicator reports the drop
+// The built-in LED shows the state: blinking from a timer while waiting,
+// on while handshaking, and left to the host once connected. The host's
+// LED state is saved when the link drops and put back on reconnecting, so
+// a resumed session finds it as it left it.
+class ConnectionManager {
+public:
+  enum class State : uint8_t {
+    WaitingForHost,
+    Handshaking,
+    Connected,
+  };
+
+  // Whether a host has the port open, e.g. static_cast<bool>(Serial).
+  using LinkCheck = bool (*)();
+
+  ConnectionManager(const LinkCheck link_up, const uint32_t poll_interval_ms)
+      : link_up(link_up), poll_interval_us(poll_interval_ms * 1000ull) {}
+
+  // Starts out waiting for a host.
+  void begin();
+
+  // Call on every loop() with whether the handshake is complete. Returns
+  // whether the link is up, i.e. whether the communicator should run.
+  bool poll(bool connected);
+
+  // Safe from the communicator's disconnect callback: only records the
+  // drop; the next poll() picks it up.
+  void link_lost() { lost = true; }
+
+  // The session is over; the next one starts with the LED off.
+  void reset_host_led();
+
+  [[nodiscard]] State state() const { return current; }
+
+private:
+  LinkCheck link_up;
+  uint64_t poll_interval_us;
+
+  State current = State::WaitingForHost;
+  bool lost = false;
+  uint64_t next_check_us = 0;
+
+  repeating_timer_t blink_timer{};
+  bool blinking = false;
+  bool led_on = false;
+  bool host_led = false;
+
+  void enter(State next);
+
+  void start_blinking();
+
+  void set_led(bool on);
+
+  static bool on_blink(repeating_timer_t *rt);
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "LatencyTrace.h"
+#include "SensorFilter.h"
+#include "SpscRing.h"
+#include "constants.h"
+
+enum class WaveformType : uint16_t {
+  Square = 0x0001,
+  Square25 = 0x0002,
+  Square12 = 0x0003,
+  Triangle = 0x0004,
+  Saw = 0x0005,
+  Sine = 0x0006,
+  Noise = 0x0007,
+};
+
+struct ToneParams {
+  float frequency;
+  float volume;
+  uint32_t duration;
+};
+
+struct RGBColor {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
+struct FilterSelection {
+  SensorChannel sensor;
+  FilterPreset preset;
+};
+
+enum class SequenceOp : uint8_t {
+  Load, // Take the newest uploaded sequence
+  Play,
+  Stop,
+};
+
+struct SequenceControl {
+  SequenceOp op;
+  bool loop;
+  bool play; // Load only: start right away
+};
+
+enum class AnimationOp : uint8_t {
+  Play, // Take the newest uploaded animation
+  Stop,
+};
+
+struct AnimationControl {
+  AnimationOp op;
+  bool loop;
+};
+
+enum class CoreCommandType : uint8_t {
+  NoTone,
+  Tone,
+  RGBLed,
+  LEDBuiltin,
+  Waveform,
+  ClearSchedule,
+  SelectFilter,
+  RawStream,
+  PcmStream,
+  ToneSequence,
+  LedAnimation,
+};
+
+// Fully-typed actuator command handed from core 0 to core 1. Commands are
+// copied by value through the queue, so core 1 never observes a
+// half-written record.
+struct CoreCommand {
+  // execute_at_us of a command that is applied as soon as core 1 picks it
+  // up. Device time 0 is boot, which no host ever schedules for.
+  static constexpr uint64_t IMMEDIATE = 0;
+
+  CoreCommandType type = CoreCommandType::NoTone;
+
+  // Device time (time_us_64) to apply the command at, or IMMEDIATE
+  uint64_t execute_at_us = IMMEDIATE;
+
+  [[no_unique_address]] LatencyStamps trace;
+
+  union {
+    ToneParams tone;
+    RGBColor color;
+    bool led;
+    WaveformType waveform;
+    FilterSelection filter;
+    uint32_t raw_sample_rate_hz;
+    uint32_t pcm_sample_rate_hz;
+    SequenceControl sequence;
+    AnimationControl animation;
+  };
+
+  CoreCommand() : tone{} {}
+
+  static CoreCommand no_tone() { return {}; }
+
+  static CoreCommand play_tone(const ToneParams &params) {
+    CoreCommand command;
+
+    command.type = CoreCommandType::Tone;
+    command.tone = params;
+
+    return command;
+  }
+
+  static CoreCommand set_color(const RGBColor &color) {
+    CoreCommand command;
+
+    command.type = CoreCommandType::RGBLed;
+    command.color = color;
+
+    return command;
+  }
+
+  static CoreCommand set_led_builtin(const bool on) {
+    CoreCommand command;
+
+    command.type = CoreCommandType::LEDBuiltin;
+    command.led = on;
+
+    return command;
+  }
+
+  static CoreCommand set_waveform(const WaveformType waveform) {
+    CoreCommand command;
+
+    command.type = CoreCommandType::Waveform;
+    command.waveform = waveform;
+
+    return command;
+  }
+
+  // Drops every command still waiting for its execute_at_us.
+  static CoreCommand clear_schedule() {
+    CoreCommand command;
+
+    command.type = CoreCommandType::ClearSchedule;
+
+    return command;
+  }
+
+  static CoreCommand select_filter(const FilterSelection &filter) {
+    CoreCommand command;
+
+    command.type = CoreCommandType::SelectFilter;
+    command.filter = filter;
+
+    return command;
+  }
+
+  // A rate of 0 stops raw streaming and returns the ADC to its default rate.
+  static CoreCommand raw_stream(const uint32_t sample_rate_hz) {
+    CoreCommand command;
+
+    command.type = CoreCommandType::RawStream;
+    command.raw_sample_rate_hz = sample_rate_hz;
+
+    return command;
+  }
+
+  // A rate of 0 stops PCM playback and hands the speaker back to tones.
+  static CoreCommand pcm_stream(const uint32_t sample_rate_hz) {
+    CoreCommand command;
+
+    command.type = CoreCommandType::PcmStream;
+    command.pcm_sample_rate_hz = sample_rate_hz;
+
+    return command;
+  }
+
+  static CoreCommand tone_sequence(const SequenceControl &control) {
+    CoreCommand command;
+
+    command.type = CoreCommandType::ToneSequence;
+    command.sequence = control;
+
+    return command;
+  }
+
+  static CoreCommand led_animation(const AnimationControl &control) {
+    CoreCommand command;
+
+    command.type = CoreCommandType::LedAnimation;
+    command.animation = control;
+
+    return command;
+  }
+};
+
+// Core 0 pushes, core 1 pops. A full queue never blocks the producer; the
+// command is dropped and counted instead.
+class CoreCommandQueue {
+public:
+  bool push(CoreCommand command) {
+    latency::stamp(command.trace);
+
+    if (ring.try_push(command))
+      return true;
+
+    // The Cortex-M0+ has no atomic read-modify-write, and fetch_add would
+    // pull in libatomic's lock-based fallback. Only push() writes the count,
+    // so a load and a store are enough.
+    dropped.store(dropped.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+
+    return false;
+  }
+
+  bool pop(CoreCommand &command) { return ring.try_pop(command); }
+
+  [[nodiscard]] uint32_t overflows() const {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] size_t size() const { return ring.size(); }
+
+private:
+  SpscRing<CoreCommand, CORE_COMMAND_QUEUE_SIZE> ring;
+
+  std::atomic<uint32_t> dropped{0};
+};
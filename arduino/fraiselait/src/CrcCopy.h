@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "crc16.h"
+
+// Gathers chunk payload bytes and computes their CRC-16/XMODEM on the way,
+// so the framing path touches every byte once. A chunk is begin(), any
+// number of copy() calls, then finish().
+class ICrcCopy {
+public:
+  virtual ~ICrcCopy() = default;
+
+  virtual void begin() = 0;
+
+  virtual void copy(uint8_t *out, const uint8_t *in, size_t size) = 0;
+
+  [[nodiscard]] virtual uint16_t finish() = 0;
+};
+
+// Table-driven fallback, available everywhere.
+class SoftwareCrcCopy final : public ICrcCopy {
+public:
+  void begin() override { crc = 0x0000; }
+
+  void copy(uint8_t *out, const uint8_t *in, const size_t size) override {
+    std::memcpy(out, in, size);
+
+    crc = crc16::update(crc, in, size);
+  }
+
+  [[nodiscard]] uint16_t finish() override { return crc; }
+
+private:
+  uint16_t crc = 0x0000;
+};
@@ -0,0 +1,73 @@
+#include "DataCommands.h"
+
+namespace {
+
+bool get_n_bit(const uint8_t flags, const size_t n) {
+  return (flags >> n) & 0b1;
+}
+
+} // namespace
+
+std::optional<ReservedErrorCode>
+process_data(const uint8_t flags, pcomm::bytes::Decoder &decoder,
+             CoreCommandQueue &queue) {
+  uint64_t execute_at_us = CoreCommand::IMMEDIATE;
+
+  const auto push = [&](CoreCommand command) {
+    command.execute_at_us = execute_at_us;
+
+    queue.push(command);
+  };
+
+  if (get_n_bit(flags, 0)) {
+    // Scheduled: everything below is applied at this device time (us)
+
+    if (decoder.remaining() < 8)
+      return ReservedErrorCode::MalformedPacket;
+
+    execute_at_us = decoder.pop_number<uint64_t>();
+  }
+
+  if (get_n_bit(flags, 1)) {
+    // Change waveform
+
+    if (decoder.remaining() < 2)
+      return ReservedErrorCode::MalformedPacket;
+
+    push(CoreCommand::set_waveform(
+        static_cast<WaveformType>(decoder.pop_number<uint16_t>())));
+  }
+
+  if (get_n_bit(flags, 2)) {
+    // No tone
+    push(CoreCommand::no_tone());
+  } else if (get_n_bit(flags, 3)) {
+    // Tone
+    ToneData tone_data;
+
+    if (!ToneMessage::decode(decoder, tone_data))
+      return ReservedErrorCode::MalformedPacket;
+
+    push(CoreCommand::play_tone(tone_data.params()));
+  }
+
+  if (get_n_bit(flags, 4)) {
+    // LED Builtin
+    if (decoder.remaining() < 1)
+      return ReservedErrorCode::MalformedPacket;
+
+    push(CoreCommand::set_led_builtin(decoder.pop_bool()));
+  }
+
+  if (get_n_bit(flags, 5)) {
+    // RGB LED
+    RGBColor color{};
+
+    if (!RGBColorMessage::decode(decoder, color))
+      return ReservedErrorCode::MalformedPacket;
+
+    push(CoreCommand::set_color(color));
+  }
+
+  return std::nullopt;
+}
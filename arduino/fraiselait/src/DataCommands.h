@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "CoreCommand.h"
+#include "Message.h"
+#include "SerialCommunicator.h"
+
+struct ToneData {
+  float frequency{};
+  float volume = 1;
+  uint32_t duration{};
+
+  [[nodiscard]] ToneParams params() const {
+    return {frequency, volume, duration};
+  }
+};
+
+// CommandDataSet part for flag bit 3
+using ToneMessage = Message<DataTypes::CommandDataSet, "Tone",
+                            Field<"frequency", &ToneData::frequency>,
+                            Field<"volume", &ToneData::volume>,
+                            Field<"duration", &ToneData::duration>>;
+
+// CommandDataSet part for flag bit 5
+using RGBColorMessage =
+    Message<DataTypes::CommandDataSet, "RGBColor", Field<"r", &RGBColor::r>,
+            Field<"g", &RGBColor::g>, Field<"b", &RGBColor::b>>;
+
+// Decodes a CommandDataSet body following its flags byte and queues the
+// resulting commands for core 1. Commands decoded before a malformed field
+// are still queued.
+std::optional<ReservedErrorCode>
+process_data(uint8_t flags, pcomm::bytes::Decoder &decoder,
+             CoreCommandQueue &queue);
@@ -0,0 +1,86 @@
+#include "DeltaTelemetry.h"
+
+#include <cmath>
+#include <cstdlib>
+
+void DeltaTelemetryCapability::serialize(
+    const pcomm::bytes::Encoder &encoder) const {
+  encoder.push_number(DeltaEncoder::FIELDS_ALL);
+}
+
+bool DeltaTelemetryCapability::deserialize(pcomm::bytes::Decoder &decoder) {
+  keyframe_every = decoder.pop_number<uint16_t>();
+  light_band = decoder.pop_number<int32_t>();
+  temp_band = decoder.pop_number<float>();
+
+  if (keyframe_every == 0 || light_band < 0 || !(temp_band >= 0))
+    return false;
+
+  negotiated = true;
+
+  return true;
+}
+
+void DeltaTelemetryCapability::reset() {
+  negotiated = false;
+  keyframe_every = DEFAULT_KEYFRAME_INTERVAL;
+  light_band = 0;
+  temp_band = 0;
+}
+
+uint8_t DeltaEncoder::next_mask(const DeviceData &sample) {
+  uint8_t mask = 0;
+
+  // Keyframes are keyframe_interval samples apart, counting the keyframe
+  if (samples_since_keyframe + 1 >= config.keyframe_interval()) {
+    mask = KEYFRAME | FIELDS_ALL;
+    samples_since_keyframe = 0;
+  } else {
+    samples_since_keyframe++;
+
+    if (sample.button_pressing != last_sent.button_pressing) {
+      mask |= FIELD_BUTTON;
+    }
+
+    if (std::abs(sample.light_strength_average -
+                 last_sent.light_strength_average) > config.light_deadband()) {
+      mask |= FIELD_LIGHT;
+    }
+
+    if (std::fabs(sample.core_temp_average - last_sent.core_temp_average) >
+        config.temp_deadband()) {
+      mask |= FIELD_TEMP;
+    }
+  }
+
+  if (mask & FIELD_BUTTON) {
+    last_sent.button_pressing = sample.button_pressing;
+  }
+
+  if (mask & FIELD_LIGHT) {
+    last_sent.light_strength_average = sample.light_strength_average;
+  }
+
+  if (mask & FIELD_TEMP) {
+    last_sent.core_temp_average = sample.core_temp_average;
+  }
+
+  return mask;
+}
+
+void DeltaEncoder::serialize(const uint8_t mask, const DeviceData &sample,
+                             const pcomm::bytes::Encoder &encoder) {
+  encoder.push_number(mask);
+
+  if (mask & FIELD_BUTTON) {
+    encoder.push_bool(sample.button_pressing);
+  }
+
+  if (mask & FIELD_LIGHT) {
+    encoder.push_number(sample.light_strength_average);
+  }
+
+  if (mask & FIELD_TEMP) {
+    encoder.push_number(sample.core_temp_average);
+  }
+}
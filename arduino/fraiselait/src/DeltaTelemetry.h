@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+
+#include "DeviceData.h"
+#include "SerialCommunicator.h"
+
+// Negotiates change-only telemetry. The host enables it by sending this
+// capability in HostHello:
+//   keyframe_interval(2) light_deadband(4) temp_deadband(4)
+// The device side advertises the field mask it can encode.
+class DeltaTelemetryCapability final : public ICapability {
+public:
+  static constexpr uint16_t ID = 0x0041;
+
+  static constexpr uint16_t DEFAULT_KEYFRAME_INTERVAL = 64;
+
+  [[nodiscard]] uint16_t id() const override { return ID; }
+
+  [[nodiscard]] uint16_t min_size() const override { return 2 + 4 + 4; }
+
+  void serialize(const pcomm::bytes::Encoder &encoder) const override;
+
+  bool deserialize(pcomm::bytes::Decoder &decoder) override;
+
+  void reset() override;
+
+  [[nodiscard]] bool enabled() const { return negotiated; }
+
+  [[nodiscard]] uint16_t keyframe_interval() const { return keyframe_every; }
+
+  [[nodiscard]] int32_t light_deadband() const { return light_band; }
+
+  [[nodiscard]] float temp_deadband() const { return temp_band; }
+
+private:
+  bool negotiated = false;
+  uint16_t keyframe_every = DEFAULT_KEYFRAME_INTERVAL;
+  int32_t light_band = 0;
+  float temp_band = 0;
+};
+
+// Decides which DeviceData fields are worth sending. A field is only resent
+// once it moves past its deadband relative to the last value sent, so slow
+// drift cannot accumulate unnoticed. Every keyframe_interval samples all
+// fields are sent regardless so the host can resync.
+class DeltaEncoder {
+public:
+  static constexpr uint8_t FIELD_BUTTON = 1 << 0;
+  static constexpr uint8_t FIELD_LIGHT = 1 << 1;
+  static constexpr uint8_t FIELD_TEMP = 1 << 2;
+  static constexpr uint8_t FIELDS_ALL = FIELD_BUTTON | FIELD_LIGHT | FIELD_TEMP;
+  static constexpr uint8_t KEYFRAME = 1 << 7;
+
+  explicit DeltaEncoder(const DeltaTelemetryCapability &config)
+      : config(config) {}
+
+  // Forces the next sample to be a keyframe.
+  void reset() { samples_since_keyframe = UINT16_MAX; }
+
+  // Returns the mask of fields to send for this sample (0 if nothing changed)
+  // and records them as sent.
+  uint8_t next_mask(const DeviceData &sample);
+
+  // mask(1) [button(1)] [light(4)] [temp(4)]
+  static void serialize(uint8_t mask, const DeviceData &sample,
+                        const pcomm::bytes::Encoder &encoder);
+
+private:
+  const DeltaTelemetryCapability &config;
+
+  uint16_t samples_since_keyframe = UINT16_MAX;
+  DeviceData last_sent;
+};
+
+struct DeltaSample final : ISerializable {
+  uint8_t mask = 0;
+  DeviceData data;
+
+  DeltaSample(const uint8_t mask, const DeviceData &data)
+      : mask(mask), data(data) {}
+
+  void serialize(const pcomm::bytes::Encoder &encoder) const override {
+    DeltaEncoder::serialize(mask, data, encoder);
+  }
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Message.h"
+#include "SerialCommunicator.h"
+
+struct DeviceData {
+  bool button_pressing = false;
+  int32_t light_strength_average = 0;
+  float core_temp_average = 0;
+
+  DeviceData() = default;
+
+  DeviceData(const bool button_pressing, const int32_t light_strength_average,
+             const float core_temp_average)
+      : button_pressing(button_pressing),
+        light_strength_average(light_strength_average),
+        core_temp_average(core_temp_average) {}
+};
+
+using DeviceDataMessage = Message<
+    DataTypes::ResponseDataSend, "DeviceData",
+    Field<"button_pressing", &DeviceData::button_pressing>,
+    Field<"light_strength_average", &DeviceData::light_strength_average>,
+    Field<"core_temp_average", &DeviceData::core_temp_average>>;
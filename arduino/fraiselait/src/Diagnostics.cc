@@ -0,0 +1,43 @@
+#include "Diagnostics.h"
+
+#include <Arduino.h>
+
+#include "LatencyTrace.h"
+
+void DiagnosticsReport::serialize(const pcomm::bytes::Encoder &encoder) const {
+  encoder.push_number(static_cast<uint32_t>(F_CPU));
+  encoder.push_number(link.rx_packets);
+  encoder.push_number(link.malformed_packets);
+  encoder.push_number(link.unknown_packets);
+  encoder.push_number(link.fifo_drops);
+  encoder.push_number(link.tx_dropped_frames);
+
+  encoder.push_number(static_cast<uint8_t>(TX_PRIORITIES));
+
+  for (const auto &tx : link.tx_classes) {
+    encoder.push_number(tx.frames);
+    encoder.push_number(tx.queued_frames);
+    encoder.push_number(tx.depth);
+    encoder.push_number(tx.max_depth);
+    encoder.push_number(tx.mean_wait_us());
+    encoder.push_number(tx.max_wait_us);
+  }
+
+  if constexpr (!latency::ENABLED) {
+    encoder.push_number(static_cast<uint8_t>(0));
+
+    return;
+  }
+
+  encoder.push_number(static_cast<uint8_t>(LATENCY_STAGES));
+
+  for (size_t i = 0; i < LATENCY_STAGES; ++i) {
+    const auto summary = latency::summary(static_cast<LatencyStage>(i));
+
+    encoder.push_number(summary.count);
+    encoder.push_number(summary.min);
+    encoder.push_number(summary.mean);
+    encoder.push_number(summary.max);
+    encoder.push_number(summary.p99);
+  }
+}
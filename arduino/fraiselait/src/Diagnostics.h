@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "SerialCommunicator.h"
+
+struct LinkCounters {
+  uint32_t rx_packets = 0;
+  uint32_t malformed_packets = 0;
+  uint32_t unknown_packets = 0;
+  uint32_t fifo_drops = 0;
+  uint32_t tx_dropped_frames = 0;
+  std::array<TxClassStats, TX_PRIORITIES> tx_classes{};
+};
+
+// Body of ResponseDiagnostics:
+//   cpu_hz(4) rx_packets(4) malformed_packets(4) unknown_packets(4)
+//   fifo_drops(4) tx_dropped_frames(4) class_count(1)
+//   class_count * [frames(4) queued_frames(4) depth(2) max_depth(2)
+//                  mean_wait_us(4) max_wait_us(4)]
+//   stage_count(1) stage_count * [count(4) min(4) mean(4) max(4) p99(4)]
+// Classes follow TxPriority order. Stages follow LatencyStage order and are
+// in CPU cycles since boot.
+// stage_count is 0 in builds without FRAISELAIT_LATENCY_TRACE.
+class DiagnosticsReport final : public ISerializable {
+public:
+  explicit DiagnosticsReport(const LinkCounters &link) : link(link) {}
+
+  void serialize(const pcomm::bytes::Encoder &encoder) const override;
+
+private:
+  LinkCounters link;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Dense tables wider than this are most likely a typo in one of the codes.
+constexpr size_t MAX_DISPATCH_TABLE_SPAN = 512;
+
+// Non-owning view over a dense jump table indexed by `code - base`.
+template <typename Handler> struct DispatchView {
+  uint16_t base = 0;
+  uint16_t size = 0;
+  const Handler *handlers = nullptr;
+
+  [[nodiscard]] constexpr Handler find(const uint16_t code) const {
+    const auto index = static_cast<uint16_t>(code - base);
+
+    return index < size ? handlers[index] : nullptr;
+  }
+};
+
+template <auto Code, auto Handler> struct DispatchRoute {
+  static constexpr auto code = static_cast<uint16_t>(Code);
+  static constexpr auto handler = Handler;
+};
+
+// Jump table built at compile time from DispatchRoute entries. Lookup is a
+// subtraction, a bounds check and an indirect call.
+template <typename Handler, typename... Routes> class StaticDispatchTable {
+  static_assert(sizeof...(Routes) > 0, "Dispatch table must not be empty");
+
+  static constexpr uint16_t min_code = std::min({Routes::code...});
+  static constexpr uint16_t max_code = std::max({Routes::code...});
+  static constexpr size_t span = max_code - min_code + 1;
+
+  static_assert(span <= MAX_DISPATCH_TABLE_SPAN,
+                "Codes are too sparse for a dense dispatch table");
+
+  static constexpr bool has_duplicates() {
+    std::array<uint16_t, sizeof...(Routes)> codes{Routes::code...};
+
+    std::ranges::sort(codes);
+
+    return std::ranges::adjacent_find(codes) != codes.end();
+  }
+
+  static_assert(!has_duplicates(), "Duplicate code in dispatch table");
+
+  static constexpr std::array<Handler, span> build() {
+    std::array<Handler, span> table{};
+
+    ((table[Routes::code - min_code] = Routes::handler), ...);
+
+    return table;
+  }
+
+  static constexpr std::array<Handler, span> table = build();
+
+public:
+  static constexpr DispatchView<Handler> view() {
+    return {min_code, static_cast<uint16_t>(span), table.data()};
+  }
+};
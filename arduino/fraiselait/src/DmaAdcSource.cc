@@ -0,0 +1,153 @@
+#include "DmaAdcSource.h"
+
+#include "DmaChain.h"
+
+#include <hardware/adc.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/timer.h>
+
+namespace {
+
+constexpr float ADC_CLOCK_HZ = 48'000'000.f;
+constexpr float MIN_ADC_CLKDIV = 96.f; // One conversion takes 96 cycles
+
+} // namespace
+
+DmaAdcSource *DmaAdcSource::instance = nullptr;
+
+bool DmaAdcSource::start(const uint32_t sample_rate_hz) {
+  if (running || instance || sample_rate_hz == 0)
+    return false;
+
+  instance = this;
+
+  completed.store(0, std::memory_order_relaxed);
+  consumed.store(0, std::memory_order_relaxed);
+
+  adc_init();
+  adc_gpio_init(PIN_LIGHT_SENSOR);
+  adc_set_temp_sensor_enabled(true);
+
+  // Round robin starts at the selected input, so blocks always begin with
+  // the light sensor
+  adc_select_input(ADC_INPUT_LIGHT_SENSOR);
+  adc_set_round_robin((1u << ADC_INPUT_LIGHT_SENSOR) |
+                      (1u << ADC_INPUT_TEMPERATURE));
+  adc_fifo_setup(true, true, 1, false, false);
+
+  const auto clkdiv = ADC_CLOCK_HZ / static_cast<float>(sample_rate_hz) - 1;
+
+  adc_set_clkdiv(clkdiv < MIN_ADC_CLKDIV ? 0 : clkdiv);
+
+  for (auto &channel : dma_channels) {
+    channel = dma_claim_unused_channel(true);
+  }
+
+  for (size_t i = 0; i < dma_channels.size(); ++i) {
+    const auto channel = dma_channels[i];
+
+    auto config = dma_channel_get_default_config(channel);
+
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_dreq(&config, DREQ_ADC);
+    channel_config_set_chain_to(&config, dma_channels[1 - i]);
+
+    dma_channel_configure(channel, &config, blocks[i].data(), &adc_hw->fifo,
+                          ADC_BLOCK_SAMPLES, false);
+
+    dma_channel_set_irq1_enabled(channel, true);
+  }
+
+  irq_add_shared_handler(DMA_IRQ_1, on_dma_irq,
+                         PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+  irq_set_enabled(DMA_IRQ_1, true);
+
+  dma_channel_start(dma_channels[0]);
+  adc_run(true);
+
+  running = true;
+
+  return true;
+}
+
+void DmaAdcSource::stop() {
+  if (!running)
+    return;
+
+  adc_run(false);
+
+  release_chained_channels(dma_channels);
+
+  irq_remove_handler(DMA_IRQ_1, on_dma_irq);
+
+  adc_fifo_drain();
+  adc_set_round_robin(0);
+
+  instance = nullptr;
+  running = false;
+}
+
+AdcBlock DmaAdcSource::acquire() {
+  const auto done = completed.load(std::memory_order_acquire);
+  auto next = consumed.load(std::memory_order_relaxed);
+
+  if (next == done)
+    return {};
+
+  // The channels own blocks done and done + 1; anything older than that
+  // ring distance has been overwritten
+  constexpr uint32_t readable = ADC_RING_BLOCKS - 2;
+
+  if (done - next > readable) {
+    const auto skipped = done - next - readable;
+
+    // Only the consumer writes the count, so no read-modify-write is needed
+    overrun_count.store(overrun_count.load(std::memory_order_relaxed) + skipped,
+                        std::memory_order_relaxed);
+
+    next = done - readable;
+
+    consumed.store(next, std::memory_order_release);
+  }
+
+  const auto index = next % ADC_RING_BLOCKS;
+
+  return {blocks[index].data(), ADC_BLOCK_SAMPLES, completed_at_us[index]};
+}
+
+void DmaAdcSource::release() {
+  const auto next = consumed.load(std::memory_order_relaxed);
+
+  if (next != completed.load(std::memory_order_acquire)) {
+    consumed.store(next + 1, std::memory_order_release);
+  }
+}
+
+void DmaAdcSource::on_dma_irq() {
+  auto *self = instance;
+
+  if (!self)
+    return;
+
+  for (const auto channel : self->dma_channels) {
+    if (!dma_channel_get_irq1_status(channel))
+      continue;
+
+    dma_channel_acknowledge_irq1(channel);
+
+    const auto done = self->completed.load(std::memory_order_relaxed) + 1;
+
+    self->completed_at_us[(done - 1) % ADC_RING_BLOCKS] = time_us_64();
+
+    // The other channel is already filling block `done`; queue this one up
+    // for the block after it. It is re-triggered through the chain.
+    dma_channel_set_write_addr(channel,
+                               self->blocks[(done + 1) % ADC_RING_BLOCKS].data(),
+                               false);
+
+    self->completed.store(done, std::memory_order_release);
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "AdcSource.h"
+#include "constants.h"
+
+// Free-running ADC in round-robin mode, drained by two chained DMA channels
+// into a ring of ADC_RING_BLOCKS blocks. The CPU is only involved once per
+// block, to re-target the channel that just finished.
+class DmaAdcSource final : public IAdcSource {
+public:
+  bool start(uint32_t sample_rate_hz) override;
+
+  void stop() override;
+
+  [[nodiscard]] AdcBlock acquire() override;
+
+  void release() override;
+
+  [[nodiscard]] uint32_t overruns() const override {
+    return overrun_count.load(std::memory_order_relaxed);
+  }
+
+private:
+  static_assert(ADC_BLOCK_SAMPLES % CHANNELS == 0,
+                "Blocks must hold whole round-robin sequences");
+  static_assert(ADC_RING_BLOCKS >= 3,
+                "Two blocks are always owned by the DMA channels");
+
+  // Only one instance can own the DMA IRQ handler
+  static DmaAdcSource *instance;
+
+  std::array<std::array<uint16_t, ADC_BLOCK_SAMPLES>, ADC_RING_BLOCKS>
+      blocks{};
+
+  // Written by the IRQ handler, indexed like blocks
+  std::array<uint64_t, ADC_RING_BLOCKS> completed_at_us{};
+
+  std::array<int, 2> dma_channels{-1, -1};
+  bool running = false;
+
+  // Written by the IRQ handler
+  std::atomic<uint32_t> completed{0};
+  // Written by the consumer
+  std::atomic<uint32_t> consumed{0};
+  std::atomic<uint32_t> overrun_count{0};
+
+  static void on_dma_irq();
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <hardware/dma.h>
+
+// Stops a pair of DMA channels chained to each other and releases them.
+// Aborted one at a time, a channel that completes while its partner is
+// being aborted can trigger the partner again (RP2040-E13), so both are
+// aborted in a single write and waited for together.
+inline void release_chained_channels(std::array<int, 2> &channels) {
+  uint32_t mask = 0;
+
+  for (const auto channel : channels) {
+    dma_channel_set_irq1_enabled(channel, false);
+    mask |= 1u << channel;
+  }
+
+  dma_hw->abort = mask;
+
+  while (dma_hw->abort & mask) {
+    tight_loop_contents();
+  }
+
+  // An abort can still raise the completion interrupt
+  for (auto &channel : channels) {
+    dma_channel_acknowledge_irq1(channel);
+    dma_channel_unclaim(channel);
+
+    channel = -1;
+  }
+}
@@ -0,0 +1,69 @@
+#include "DmaCrcCopy.h"
+
+#include <cstring>
+
+#include <hardware/dma.h>
+
+namespace {
+
+// SNIFF_CTRL.CALC: CRC-16-CCITT, data and result not bit-reversed
+constexpr uint32_t DMA_SNIFF_CRC16 = 0x2;
+
+} // namespace
+
+bool DmaCrcCopy::claim() {
+  if (dma_channel >= 0)
+    return true;
+
+  dma_channel = dma_claim_unused_channel(false);
+
+  if (dma_channel < 0)
+    return false;
+
+  dma_sniffer_enable(dma_channel, DMA_SNIFF_CRC16, true);
+  dma_sniffer_set_output_reverse_enabled(false);
+
+  return true;
+}
+
+void DmaCrcCopy::begin() { dma_sniffer_set_data_accumulator(0x0000); }
+
+void DmaCrcCopy::copy(uint8_t *out, const uint8_t *in, const size_t size) {
+  wait();
+
+  if (size < MIN_DMA_COPY) {
+    const auto crc = static_cast<uint16_t>(dma_sniffer_get_data_accumulator());
+
+    std::memcpy(out, in, size);
+
+    dma_sniffer_set_data_accumulator(crc16::update(crc, in, size));
+
+    return;
+  }
+
+  auto config = dma_channel_get_default_config(dma_channel);
+
+  channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+  channel_config_set_read_increment(&config, true);
+  channel_config_set_write_increment(&config, true);
+  channel_config_set_sniff_enable(&config, true);
+
+  dma_channel_configure(dma_channel, &config, out, in, size, true);
+
+  transferring = true;
+}
+
+uint16_t DmaCrcCopy::finish() {
+  wait();
+
+  return static_cast<uint16_t>(dma_sniffer_get_data_accumulator());
+}
+
+void DmaCrcCopy::wait() {
+  if (!transferring)
+    return;
+
+  dma_channel_wait_for_finish_blocking(dma_channel);
+
+  transferring = false;
+}
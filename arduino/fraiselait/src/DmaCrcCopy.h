@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CrcCopy.h"
+
+// Copies through a DMA channel with the RP2040 sniffer in CRC-16-CCITT mode,
+// which matches crc16::update bit for bit. Pieces too short to be worth a
+// DMA transfer are folded into the sniffer accumulator in software.
+//
+// copy() returns while the transfer runs and the next copy() or finish()
+// waits for it, so the caller's bookkeeping between pieces overlaps the
+// DMA. Little else can: the sniffer has one accumulator, so pieces go one
+// after the other, and the chunk is COBS-encoded only once its CRC is in.
+// The gain over SoftwareCrcCopy is the hardware CRC at one byte per cycle,
+// not freeing the CPU.
+class DmaCrcCopy final : public ICrcCopy {
+public:
+  static constexpr size_t MIN_DMA_COPY = 16;
+
+  // Claims a DMA channel and the sniffer. Returns false if no channel is
+  // free, in which case SoftwareCrcCopy should be used instead.
+  bool claim();
+
+  void begin() override;
+
+  void copy(uint8_t *out, const uint8_t *in, size_t size) override;
+
+  [[nodiscard]] uint16_t finish() override;
+
+private:
+  int dma_channel = -1;
+  bool transferring = false;
+
+  void wait();
+};
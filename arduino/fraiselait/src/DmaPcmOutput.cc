@@ -0,0 +1,123 @@
+#include "DmaPcmOutput.h"
+
+#include "DmaChain.h"
+
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/pwm.h>
+
+DmaPcmOutput *DmaPcmOutput::instance = nullptr;
+
+bool DmaPcmOutput::start(const uint32_t sample_rate_hz) {
+  if (running || instance || sample_rate_hz < PCM_MIN_SAMPLE_RATE_HZ ||
+      sample_rate_hz > PCM_MAX_SAMPLE_RATE_HZ) {
+    return false;
+  }
+
+  dma_timer = dma_claim_unused_timer(false);
+
+  if (dma_timer < 0)
+    return false;
+
+  instance = this;
+
+  const auto slice = pwm_gpio_to_slice_num(PIN_SPEAKER);
+
+  gpio_set_function(PIN_SPEAKER, GPIO_FUNC_PWM);
+
+  auto pwm_config = pwm_get_default_config();
+
+  pwm_config_set_wrap(&pwm_config, PCM_PWM_WRAP);
+  pwm_init(slice, &pwm_config, true);
+
+  // Timer rate is clk_sys * X / Y; with X = 1 the rounding error of Y stays
+  // below 0.03% over the supported sample rates
+  const auto divider = (clock_get_hz(clk_sys) + sample_rate_hz / 2) /
+                       sample_rate_hz;
+
+  dma_timer_set_fraction(dma_timer, 1, static_cast<uint16_t>(divider));
+
+  for (auto &block : blocks) {
+    buffer.read(block.data(), block.size());
+  }
+
+  for (auto &channel : dma_channels) {
+    channel = dma_claim_unused_channel(true);
+  }
+
+  // Halfword writes to an APB register are replicated to both halves, so
+  // channel B of the slice mirrors channel A. Its pin is not in PWM mode.
+  auto *compare = &pwm_hw->slice[slice].cc;
+
+  for (size_t i = 0; i < dma_channels.size(); ++i) {
+    const auto channel = dma_channels[i];
+
+    auto config = dma_channel_get_default_config(channel);
+
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, dma_get_timer_dreq(dma_timer));
+    channel_config_set_chain_to(&config, dma_channels[1 - i]);
+
+    dma_channel_configure(channel, &config, compare, blocks[i].data(),
+                          PCM_BLOCK_SAMPLES, false);
+
+    dma_channel_set_irq1_enabled(channel, true);
+  }
+
+  irq_add_shared_handler(DMA_IRQ_1, on_dma_irq,
+                         PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+  irq_set_enabled(DMA_IRQ_1, true);
+
+  dma_channel_start(dma_channels[0]);
+
+  running = true;
+
+  return true;
+}
+
+void DmaPcmOutput::stop() {
+  if (!running)
+    return;
+
+  release_chained_channels(dma_channels);
+
+  irq_remove_handler(DMA_IRQ_1, on_dma_irq);
+
+  dma_timer_unclaim(dma_timer);
+
+  pwm_set_enabled(pwm_gpio_to_slice_num(PIN_SPEAKER), false);
+  gpio_set_function(PIN_SPEAKER, GPIO_FUNC_SIO);
+  gpio_put(PIN_SPEAKER, false);
+
+  dma_timer = -1;
+  instance = nullptr;
+  running = false;
+}
+
+void DmaPcmOutput::on_dma_irq() {
+  auto *self = instance;
+
+  if (!self)
+    return;
+
+  for (size_t i = 0; i < self->dma_channels.size(); ++i) {
+    const auto channel = self->dma_channels[i];
+
+    if (!dma_channel_get_irq1_status(channel))
+      continue;
+
+    dma_channel_acknowledge_irq1(channel);
+
+    // The other channel is playing its block now; this one restarts from
+    // the chain once that finishes
+    auto &block = self->blocks[i];
+
+    self->buffer.read(block.data(), block.size());
+
+    dma_channel_set_read_addr(channel, block.data(), false);
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "PcmJitterBuffer.h"
+#include "constants.h"
+
+// Plays a PcmJitterBuffer on PIN_SPEAKER as PWM duty cycle. A DMA timer
+// paces two chained DMA channels at the sample rate, each copying one block
+// of levels into the PWM compare register; the DMA IRQ refills the block
+// that just finished from the jitter buffer. Start from the core that
+// should service the refills.
+class DmaPcmOutput {
+public:
+  explicit DmaPcmOutput(PcmJitterBuffer &buffer) : buffer(buffer) {}
+
+  bool start(uint32_t sample_rate_hz);
+
+  // Leaves the pin low. The tone speaker reconfigures it on its next play.
+  void stop();
+
+  [[nodiscard]] bool active() const { return running; }
+
+private:
+  // Only one instance can own the DMA IRQ handler
+  static DmaPcmOutput *instance;
+
+  PcmJitterBuffer &buffer;
+
+  std::array<std::array<uint16_t, PCM_BLOCK_SAMPLES>, 2> blocks{};
+
+  std::array<int, 2> dma_channels{-1, -1};
+  int dma_timer = -1;
+  bool running = false;
+
+  static void on_dma_irq();
+};
@@ -0,0 +1,89 @@
+#include "FlowControl.h"
+
+#include "constants.h"
+
+#include <algorithm>
+
+void FlowControlCapability::serialize(
+    const pcomm::bytes::Encoder &encoder) const {
+  encoder.push_number(FLOW_CONTROL_DEVICE_WINDOW);
+}
+
+bool FlowControlCapability::deserialize(pcomm::bytes::Decoder &decoder) {
+  window = decoder.pop_number<uint16_t>();
+
+  if (window == 0)
+    return false;
+
+  negotiated = true;
+
+  return true;
+}
+
+void FlowControlCapability::reset() {
+  negotiated = false;
+  window = 0;
+}
+
+void FlowControl::begin() {
+  tx_credits = config.host_window();
+  rx_outstanding = FLOW_CONTROL_DEVICE_WINDOW;
+  rx_pending = 0;
+}
+
+bool FlowControl::consume_tx() {
+  if (!enabled())
+    return true;
+
+  if (tx_credits == 0) {
+    flow_stats.tx_blocked++;
+
+    return false;
+  }
+
+  tx_credits--;
+
+  return true;
+}
+
+void FlowControl::on_credit_update(const uint16_t credits) {
+  tx_credits = static_cast<uint16_t>(
+      std::min<uint32_t>(UINT16_MAX, uint32_t{tx_credits} + credits));
+}
+
+void FlowControl::on_rx() {
+  if (!enabled())
+    return;
+
+  if (rx_outstanding == 0) {
+    flow_stats.rx_violations++;
+  } else {
+    rx_outstanding--;
+  }
+
+  rx_pending++;
+}
+
+uint16_t FlowControl::take_rx_credits() {
+  if (!enabled() || rx_pending == 0)
+    return 0;
+
+  if (ready && !ready())
+    return 0;
+
+  // Batch updates until half the window is spent, unless the host is about
+  // to run dry
+  if (rx_pending < FLOW_CONTROL_DEVICE_WINDOW / 2 && rx_outstanding > 1)
+    return 0;
+
+  const auto credits = std::min<uint16_t>(
+      rx_pending, FLOW_CONTROL_DEVICE_WINDOW - rx_outstanding);
+
+  rx_outstanding += credits;
+  rx_pending = 0;
+
+  flow_stats.credits_returned += credits;
+  flow_stats.credit_updates++;
+
+  return credits;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+
+#include "SerialCommunicator.h"
+
+// Negotiates credit-based flow control for Data frames. The host enables it
+// by sending this capability in HostHello:
+//   host_window(2)
+// the number of Data frames the device may send before it has to wait for
+// a CreditUpdate. The device side advertises its own window:
+//   device_window(2)
+// Credits are counted in frames. Each side returns credits with a
+// CreditUpdate packet carrying credits(2) once it has drained the frames
+// they were spent on. Handshake, Error, debug and CreditUpdate packets are
+// never charged, and neither are the ResponsePong and ResponseTimeSync
+// answers to host requests.
+class FlowControlCapability final : public ICapability {
+public:
+  static constexpr uint16_t ID = 0x0042;
+
+  [[nodiscard]] uint16_t id() const override { return ID; }
+
+  [[nodiscard]] uint16_t min_size() const override { return 2; }
+
+  void serialize(const pcomm::bytes::Encoder &encoder) const override;
+
+  bool deserialize(pcomm::bytes::Decoder &decoder) override;
+
+  void reset() override;
+
+  [[nodiscard]] bool enabled() const { return negotiated; }
+
+  [[nodiscard]] uint16_t host_window() const { return window; }
+
+private:
+  bool negotiated = false;
+  uint16_t window = 0;
+};
+
+struct FlowStats {
+  uint32_t tx_blocked = 0;      // Data frames refused for lack of credit
+  uint32_t rx_violations = 0;   // Data frames received beyond the window
+  uint32_t credits_returned = 0;
+  uint32_t credit_updates = 0;
+};
+
+// Credit accounting for one connection. SerialCommunicator drives it; the
+// application only supplies the readiness check that decides when received
+// frames count as drained.
+class FlowControl {
+public:
+  using ReadyCheck = bool (*)();
+
+  explicit FlowControl(const FlowControlCapability &config) : config(config) {}
+
+  // Returning credits is held back while this reports false, which is how
+  // a busy consumer slows the host down.
+  void set_ready_check(const ReadyCheck check) { ready = check; }
+
+  // Called when a handshake completes.
+  void begin();
+
+  [[nodiscard]] bool enabled() const { return config.enabled(); }
+
+  [[nodiscard]] bool can_send() const { return !enabled() || tx_credits > 0; }
+
+  // Charges one credit for an outgoing Data frame; false if none is left.
+  bool consume_tx();
+
+  void on_credit_update(uint16_t credits);
+
+  // Charges one credit for an incoming Data frame.
+  void on_rx();
+
+  // Credits to hand back to the host now, or 0 to keep holding them.
+  uint16_t take_rx_credits();
+
+  [[nodiscard]] const FlowStats &stats() const { return flow_stats; }
+
+private:
+  const FlowControlCapability &config;
+
+  ReadyCheck ready = nullptr;
+
+  uint16_t tx_credits = 0;
+  // Credits the host still holds
+  uint16_t rx_outstanding = 0;
+  // Frames received and drained, not yet returned to the host
+  uint16_t rx_pending = 0;
+
+  FlowStats flow_stats;
+};
@@ -0,0 +1,245 @@
+#include "FrameWriter.h"
+
+#include "little_endian.h"
+
+#include <algorithm>
+#include <cstring>
+
+void FrameWriter::set_chunk_size(const uint16_t size) {
+  chunk_limit = std::clamp(size, DEFAULT_CHUNK_SIZE, MAX_CHUNK_SIZE);
+}
+
+bool FrameWriter::write(const uint16_t type,
+                        const std::initializer_list<TxSegment> segments,
+                        const TxPriority priority) {
+  size_t frame_size = 0;
+
+  for (const auto &segment : segments) {
+    frame_size += segment.size;
+  }
+
+  if (frame_size > MAX_FRAME_SIZE) {
+    tx_stats.dropped_frames++;
+
+    return false;
+  }
+
+  const auto frame_id = next_frame_id;
+
+  next_frame_id = next_frame_id == UINT32_MAX ? 0x80000000 : next_frame_id + 1;
+
+  const auto total_chunks = static_cast<uint16_t>(
+      std::max<size_t>(1, (frame_size + chunk_limit - 1) / chunk_limit));
+
+  TxQueue::Frame frame{frame_id,
+                       now_us(),
+                       type,
+                       total_chunks,
+                       0,
+                       chunk_limit,
+                       static_cast<uint16_t>(frame_size)};
+
+  const auto index = static_cast<size_t>(priority);
+  auto &stats = tx_stats.classes[index];
+
+  stats.frames++;
+
+  auto segment = segments.begin();
+  size_t segment_offset = 0;
+
+  // Gathers the chunk payload from however many segments it spans
+  const auto gather = [&](uint8_t *out, const size_t size) {
+    for (size_t filled = 0; filled < size;) {
+      const auto take =
+          std::min(size - filled, segment->size - segment_offset);
+
+      crc_copy->copy(out, segment->data + segment_offset, take);
+
+      out += take;
+      filled += take;
+      segment_offset += take;
+
+      if (segment_offset == segment->size) {
+        ++segment;
+        segment_offset = 0;
+      }
+    }
+  };
+
+  // Overtaking is only allowed past less urgent frames
+  if (next_queue() > index) {
+    while (frame.next_chunk < frame.total_chunks && has_room(frame)) {
+      write_chunk(frame, gather);
+    }
+
+    if (frame.next_chunk == frame.total_chunks) {
+      finish(frame, stats);
+
+      return true;
+    }
+  }
+
+  auto &queue = queues[index];
+
+  while (!queue.fits(frame.remaining)) {
+    write_queued(next_queue());
+  }
+
+  queue.push(frame);
+
+  for (; segment != segments.end(); ++segment, segment_offset = 0) {
+    queue.append(segment->data + segment_offset,
+                 segment->size - segment_offset);
+  }
+
+  stats.queued_frames++;
+  stats.depth = static_cast<uint16_t>(queue.size());
+  stats.max_depth = std::max(stats.max_depth, stats.depth);
+
+  return true;
+}
+
+void FrameWriter::pump() {
+  for (auto index = next_queue(); index < TX_PRIORITIES;
+       index = next_queue()) {
+    if (!has_room(queues[index].front()))
+      return;
+
+    write_queued(index);
+  }
+}
+
+void FrameWriter::discard() {
+  for (size_t i = 0; i < TX_PRIORITIES; ++i) {
+    tx_stats.dropped_frames += queues[i].size();
+    tx_stats.classes[i].depth = 0;
+
+    queues[i].clear();
+  }
+}
+
+bool FrameWriter::idle() const { return next_queue() == TX_PRIORITIES; }
+
+bool FrameWriter::has_room(const TxQueue::Frame &frame) {
+  if (!room)
+    return true;
+
+  const auto payload_size = std::min(frame.chunk_size, frame.remaining);
+
+  return room() >= cobs::max_encoded_size(CHUNK_HEADER_SIZE + payload_size +
+                                          CHUNK_TRAILER_SIZE);
+}
+
+size_t FrameWriter::next_queue() const {
+  for (size_t i = 0; i < TX_PRIORITIES; ++i) {
+    if (!queues[i].empty())
+      return i;
+  }
+
+  return TX_PRIORITIES;
+}
+
+void FrameWriter::write_queued(const size_t index) {
+  auto &queue = queues[index];
+  auto &frame = queue.front();
+
+  write_chunk(frame, [&](uint8_t *out, const size_t size) {
+    // At most two pieces, split where the ring wraps
+    for (size_t filled = 0; filled < size;) {
+      const auto piece = queue.peek();
+      const auto take = std::min(size - filled, piece.size);
+
+      crc_copy->copy(out, piece.data, take);
+
+      out += take;
+      filled += take;
+
+      queue.consume(take);
+    }
+  });
+
+  if (frame.next_chunk < frame.total_chunks)
+    return;
+
+  auto &stats = tx_stats.classes[index];
+
+  finish(frame, stats);
+
+  queue.pop();
+
+  stats.depth = static_cast<uint16_t>(queue.size());
+}
+
+template <typename Gather>
+void FrameWriter::write_chunk(TxQueue::Frame &frame, Gather &&gather) {
+  const auto payload_size = std::min(frame.chunk_size, frame.remaining);
+
+  uint8_t *out = chunk_buffer.data();
+
+  out = put_le(out, frame.type);
+  out = put_le(out, frame.frame_id);
+  out = put_le(out, frame.total_chunks);
+  out = put_le(out, frame.next_chunk);
+  out = put_le(out, payload_size);
+
+  crc_copy->begin();
+
+  gather(out, payload_size);
+
+  out = put_le(out + payload_size, crc_copy->finish());
+
+  const auto encoded_size = cobs::encode(
+      chunk_buffer.data(), out - chunk_buffer.data(), encoded_buffer.data());
+
+  sink(encoded_buffer.data(), encoded_size);
+
+  frame.next_chunk++;
+  frame.remaining -= payload_size;
+
+  tx_stats.chunks++;
+  tx_stats.bytes += encoded_size;
+}
+
+void FrameWriter::finish(const TxQueue::Frame &frame, TxClassStats &stats) {
+  const auto wait_us = now_us() - frame.written_at_us;
+
+  stats.total_wait_us += wait_us;
+  stats.max_wait_us = std::max(stats.max_wait_us, wait_us);
+
+  tx_stats.frames++;
+}
+
+void TxQueue::push(const Frame &frame) {
+  frames[(head + count) % MAX_FRAMES] = frame;
+  count++;
+}
+
+void TxQueue::append(const uint8_t *data, size_t size) {
+  while (size > 0) {
+    const auto tail = (read + used) % CAPACITY;
+    const auto take = std::min(size, CAPACITY - tail);
+
+    std::memcpy(bytes.data() + tail, data, take);
+
+    data += take;
+    size -= take;
+    used += take;
+  }
+}
+
+void TxQueue::consume(const size_t size) {
+  read = (read + size) % CAPACITY;
+  used -= size;
+}
+
+void TxQueue::pop() {
+  head = (head + 1) % MAX_FRAMES;
+  count--;
+}
+
+void TxQueue::clear() {
+  head = 0;
+  count = 0;
+  read = 0;
+  used = 0;
+}
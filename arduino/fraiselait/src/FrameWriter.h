@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+#include "CrcCopy.h"
+#include "InplaceFunction.h"
+#include "cobs.h"
+
+// One contiguous piece of a frame payload. A frame is sent as the
+// concatenation of its segments without first copying them together.
+struct TxSegment {
+  const uint8_t *data;
+  size_t size;
+};
+
+// Frames of a more urgent class preempt less urgent ones at the next chunk
+// boundary; within a class frames go out in the order they were written.
+enum class TxPriority : uint8_t {
+  Control,     // Errors, credit updates and time-critical replies
+  Interactive, // Replies to host requests
+  Bulk,        // Streams
+};
+
+constexpr size_t TX_PRIORITIES = 3;
+
+// Wait is measured from write() until the frame's last chunk reached the
+// sink, so it includes any time spent behind more urgent frames.
+struct TxClassStats {
+  uint32_t frames = 0;
+  // Frames that had to wait for room in the sink
+  uint32_t queued_frames = 0;
+  uint16_t depth = 0;
+  uint16_t max_depth = 0;
+  uint64_t total_wait_us = 0;
+  uint32_t max_wait_us = 0;
+
+  [[nodiscard]] uint32_t mean_wait_us() const {
+    return frames == 0 ? 0 : static_cast<uint32_t>(total_wait_us / frames);
+  }
+};
+
+struct TxStats {
+  uint32_t frames = 0;
+  uint32_t chunks = 0;
+  uint32_t bytes = 0;
+  uint32_t dropped_frames = 0;
+  uint32_t heap_allocations = 0;
+  std::array<TxClassStats, TX_PRIORITIES> classes{};
+};
+
+// Frames of one priority class waiting for room in the sink. Only the part
+// of a frame that has not been chunked yet is kept; the payloads of all
+// queued frames share one byte ring.
+class TxQueue {
+public:
+  static constexpr size_t MAX_FRAMES = 16;
+  static constexpr size_t CAPACITY = 4096;
+
+  struct Frame {
+    uint32_t frame_id;
+    uint32_t written_at_us;
+    uint16_t type;
+    uint16_t total_chunks;
+    uint16_t next_chunk;
+    uint16_t chunk_size;
+    uint16_t remaining;
+  };
+
+  [[nodiscard]] bool fits(const size_t size) const {
+    return count < MAX_FRAMES && CAPACITY - used >= size;
+  }
+
+  [[nodiscard]] bool empty() const { return count == 0; }
+
+  [[nodiscard]] size_t size() const { return count; }
+
+  // Expects fits(frame.remaining); the payload follows through append().
+  void push(const Frame &frame);
+
+  void append(const uint8_t *data, size_t size);
+
+  [[nodiscard]] Frame &front() { return frames[head]; }
+
+  // Queued payload from the read position up to the end of the ring
+  [[nodiscard]] TxSegment peek() const {
+    return {bytes.data() + read, std::min(used, CAPACITY - read)};
+  }
+
+  void consume(size_t size);
+
+  void pop();
+
+  void clear();
+
+private:
+  std::array<Frame, MAX_FRAMES> frames{};
+  std::array<uint8_t, CAPACITY> bytes{};
+
+  size_t head = 0;
+  size_t count = 0;
+  size_t read = 0;
+  size_t used = 0;
+};
+
+// Splits frames into CRC16-protected, COBS-encoded chunks using fixed
+// buffers only. Wire format per chunk (little endian):
+//   type(2) frame_id(4) total_chunks(2) chunk_index(2) payload_size(2)
+//   payload(payload_size) crc16(2)
+//
+// Chunks are written straight to the sink while it has room and nothing as
+// urgent is waiting. Whatever is left of a frame then waits in the queue of
+// its TxPriority until pump() finds room for it, so the host may see chunks
+// of different frames interleaved.
+class FrameWriter {
+public:
+  static constexpr size_t CHUNK_HEADER_SIZE = 2 + 4 + 2 + 2 + 2;
+  static constexpr size_t CHUNK_TRAILER_SIZE = 2;
+  // Chunk payload size every host accepts
+  static constexpr uint16_t DEFAULT_CHUNK_SIZE = 38;
+  // Largest negotiable chunk payload; keeps an encoded chunk inside
+  // CFG_TUD_CDC_TX_BUFSIZE
+  static constexpr uint16_t MAX_CHUNK_SIZE = 1024;
+  static constexpr size_t MAX_FRAME_SIZE = 2048;
+
+  using Sink = InplaceFunction<void(const uint8_t *data, size_t size)>;
+  // Bytes the sink takes without blocking
+  using Room = InplaceFunction<size_t()>;
+  using Clock = uint32_t (*)();
+
+  explicit FrameWriter(Sink &&sink) : sink(std::move(sink)) {}
+
+  // crc_copy may point at the embedded fallback
+  FrameWriter(const FrameWriter &) = delete;
+  FrameWriter &operator=(const FrameWriter &) = delete;
+
+  // Returns false and counts a dropped frame if the segments exceed
+  // MAX_FRAME_SIZE. A frame that does not fit its queue first drains the
+  // queues into the sink, blocking like an unscheduled write would.
+  bool write(uint16_t type, std::initializer_list<TxSegment> segments,
+             TxPriority priority = TxPriority::Interactive);
+
+  // Writes queued chunks, most urgent class first, until the sink is out of
+  // room or the queues are empty.
+  void pump();
+
+  // Drops every queued frame, counting them as dropped.
+  void discard();
+
+  [[nodiscard]] bool idle() const;
+
+  [[nodiscard]] bool pending(const TxPriority priority) const {
+    return !queues[static_cast<size_t>(priority)].empty();
+  }
+
+  // Without a room check every chunk is written straight away and nothing
+  // is ever queued.
+  void set_room(Room &&fn) { room = std::move(fn); }
+
+  // Wait times stay at zero without a clock.
+  void set_clock(const Clock fn) { clock = fn; }
+
+  // Clamped to [DEFAULT_CHUNK_SIZE, MAX_CHUNK_SIZE]. Only frames written
+  // after the call are affected.
+  void set_chunk_size(uint16_t size);
+
+  [[nodiscard]] uint16_t chunk_size() const { return chunk_limit; }
+
+  // Replaces the built-in SoftwareCrcCopy, e.g. with a DmaCrcCopy.
+  void set_crc_copy(ICrcCopy &engine) { crc_copy = &engine; }
+
+  [[nodiscard]] TxStats &stats() { return tx_stats; }
+
+  [[nodiscard]] const TxStats &stats() const { return tx_stats; }
+
+private:
+  static constexpr size_t MAX_RAW_CHUNK_SIZE =
+      CHUNK_HEADER_SIZE + MAX_CHUNK_SIZE + CHUNK_TRAILER_SIZE;
+
+  Sink sink;
+  Room room;
+  Clock clock = nullptr;
+  TxStats tx_stats;
+
+  std::array<TxQueue, TX_PRIORITIES> queues;
+
+  uint16_t chunk_limit = DEFAULT_CHUNK_SIZE;
+
+  SoftwareCrcCopy software_crc;
+  ICrcCopy *crc_copy = &software_crc;
+
+  // Separate id space from frames sent through pcomm::socket so the two
+  // never share an id while both are in flight on the host.
+  uint32_t next_frame_id = 0x80000000;
+
+  std::array<uint8_t, MAX_RAW_CHUNK_SIZE> chunk_buffer{};
+  std::array<uint8_t, cobs::max_encoded_size(MAX_RAW_CHUNK_SIZE)>
+      encoded_buffer{};
+
+  [[nodiscard]] uint32_t now_us() const { return clock ? clock() : 0; }
+
+  [[nodiscard]] bool has_room(const TxQueue::Frame &frame);
+
+  // Most urgent non-empty queue, or TX_PRIORITIES if all are empty
+  [[nodiscard]] size_t next_queue() const;
+
+  // Writes the next queued chunk of queues[index].
+  void write_queued(size_t index);
+
+  // Writes the next chunk of `frame`, taking its payload from `gather`.
+  template <typename Gather>
+  void write_chunk(TxQueue::Frame &frame, Gather &&gather);
+
+  void finish(const TxQueue::Frame &frame, TxClassStats &stats);
+};
+
+static_assert(TxQueue::CAPACITY >= FrameWriter::MAX_FRAME_SIZE,
+              "an empty queue must hold any frame");
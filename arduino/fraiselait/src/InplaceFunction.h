@@ -0,0 +1,97 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Move-only callable wrapper that stores the target inline and never
+// allocates. Callables that do not fit into Capacity are rejected at compile
+// time instead of spilling to the heap like std::function does.
+template <typename Signature, size_t Capacity = 4 * sizeof(void *)>
+class InplaceFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+public:
+  InplaceFunction() = default;
+
+  InplaceFunction(std::nullptr_t) {}
+
+  template <typename F>
+    requires(!std::same_as<std::remove_cvref_t<F>, InplaceFunction> &&
+             std::invocable<std::decay_t<F> &, Args...>)
+  InplaceFunction(F &&fn) {
+    using Fn = std::decay_t<F>;
+
+    static_assert(sizeof(Fn) <= Capacity,
+                  "Callable does not fit into InplaceFunction storage");
+    static_assert(alignof(Fn) <= alignof(std::max_align_t),
+                  "Callable is over-aligned for InplaceFunction storage");
+
+    ::new (static_cast<void *>(storage)) Fn(std::forward<F>(fn));
+
+    invoke_fn = [](void *target, Args... args) -> R {
+      return (*static_cast<Fn *>(target))(std::forward<Args>(args)...);
+    };
+
+    manage_fn = [](void *dst, void *src) {
+      if (dst) {
+        ::new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+      }
+
+      static_cast<Fn *>(src)->~Fn();
+    };
+  }
+
+  InplaceFunction(InplaceFunction &&other) noexcept { take(other); }
+
+  InplaceFunction &operator=(InplaceFunction &&other) noexcept {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
+
+    return *this;
+  }
+
+  InplaceFunction(const InplaceFunction &) = delete;
+  InplaceFunction &operator=(const InplaceFunction &) = delete;
+
+  ~InplaceFunction() { reset(); }
+
+  explicit operator bool() const { return invoke_fn != nullptr; }
+
+  R operator()(Args... args) {
+    return invoke_fn(storage, std::forward<Args>(args)...);
+  }
+
+  void reset() {
+    if (manage_fn) {
+      manage_fn(nullptr, storage);
+    }
+
+    invoke_fn = nullptr;
+    manage_fn = nullptr;
+  }
+
+private:
+  alignas(std::max_align_t) unsigned char storage[Capacity]{};
+
+  R (*invoke_fn)(void *, Args...) = nullptr;
+  void (*manage_fn)(void *dst, void *src) = nullptr;
+
+  void take(InplaceFunction &other) {
+    if (!other.manage_fn)
+      return;
+
+    other.manage_fn(storage, other.storage);
+
+    invoke_fn = other.invoke_fn;
+    manage_fn = other.manage_fn;
+
+    other.invoke_fn = nullptr;
+    other.manage_fn = nullptr;
+  }
+};
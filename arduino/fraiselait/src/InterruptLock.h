@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+#include <hardware/sync.h>
+
+// Masks interrupts on the calling core for the lifetime of the lock, so an
+// alarm callback on that core never interleaves with thread-context code.
+class InterruptLock {
+public:
+  InterruptLock() : status(save_and_disable_interrupts()) {}
+
+  ~InterruptLock() { restore_interrupts(status); }
+
+  InterruptLock(const InterruptLock &) = delete;
+  InterruptLock &operator=(const InterruptLock &) = delete;
+
+private:
+  uint32_t status;
+};
@@ -0,0 +1,97 @@
+#include "LatencyTrace.h"
+
+#if FRAISELAIT_LATENCY_TRACE
+
+#include <Arduino.h>
+
+namespace {
+
+constexpr uint32_t CYCLES_PER_US = F_CPU / 1'000'000;
+
+std::array<LatencyHistogram, LATENCY_STAGES> histograms;
+
+// Core 0 only
+bool receiving = false;
+uint32_t stage_started_at = 0;
+uint32_t packet_started_at_us = 0;
+
+uint32_t cycles() { return rp2040.getCycleCount(); }
+
+void record(const LatencyStage stage, const uint32_t value) {
+  histograms[static_cast<size_t>(stage)].record(value);
+}
+
+// Ends the stage that started at stage_started_at and starts the next one
+void lap(const LatencyStage stage) {
+  const auto now = cycles();
+
+  record(stage, now - stage_started_at);
+
+  stage_started_at = now;
+}
+
+} // namespace
+
+void latency::begin_receive() {
+  receiving = true;
+  stage_started_at = cycles();
+  packet_started_at_us = time_us_32();
+}
+
+void latency::end_receive() { receiving = false; }
+
+void latency::packet_received() { lap(LatencyStage::Receive); }
+
+// The next packet handed over within the same update() starts here
+void latency::packet_handled() {
+  stage_started_at = cycles();
+  packet_started_at_us = time_us_32();
+}
+
+void latency::handler_entered() { lap(LatencyStage::Dispatch); }
+
+void latency::handler_finished() { lap(LatencyStage::Decode); }
+
+void latency::stamp(LatencyStamps &stamps) {
+  // Commands core 0 queues on its own, e.g. on disconnect, are not traced
+  stamps.traced = receiving;
+  stamps.received_at_us = packet_started_at_us;
+  stamps.queued_at_us = time_us_32();
+}
+
+void latency::dequeued(LatencyStamps &stamps) {
+  stamps.dequeued_at_us = time_us_32();
+
+  if (!stamps.traced)
+    return;
+
+  record(LatencyStage::Queue,
+         (stamps.dequeued_at_us - stamps.queued_at_us) * CYCLES_PER_US);
+}
+
+void latency::applied(const LatencyStamps &stamps, const uint64_t due_at_us) {
+  if (!stamps.traced)
+    return;
+
+  const auto now = time_us_32();
+
+  // How long a timed command waited for its due time; none for immediate
+  // (due at 0) and past-due ones. time_us_32() is the low half of
+  // time_us_64(), so the difference survives a wrap.
+  const auto until_due = static_cast<int32_t>(
+      static_cast<uint32_t>(due_at_us) - stamps.dequeued_at_us);
+  const auto held = due_at_us == 0 || until_due < 0
+                        ? uint32_t{0}
+                        : static_cast<uint32_t>(until_due);
+
+  record(LatencyStage::Apply,
+         (now - stamps.dequeued_at_us - held) * CYCLES_PER_US);
+  record(LatencyStage::Total,
+         (now - stamps.received_at_us - held) * CYCLES_PER_US);
+}
+
+LatencySummary latency::summary(const LatencyStage stage) {
+  return histograms[static_cast<size_t>(stage)].summary();
+}
+
+#endif
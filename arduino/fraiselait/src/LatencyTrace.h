@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Per-stage latency tracing from a host command arriving to core 1 applying
+// it. Off unless built with -DFRAISELAIT_LATENCY_TRACE=1 (see the
+// pico-trace environment); when off, every hook below is an empty inline
+// function and LatencyStamps takes no space in CoreCommand.
+#ifndef FRAISELAIT_LATENCY_TRACE
+#define FRAISELAIT_LATENCY_TRACE 0
+#endif
+
+enum class LatencyStage : uint8_t {
+  Receive,  // comm.update() until on_recv: USB read, COBS, CRC, reassembly
+  Dispatch, // on_recv until the data handler runs
+  Decode,   // Data handler, including process_data and the FIFO push
+  Queue,    // FIFO push on core 0 until core 1 pops the command
+  Apply,    // Core 1 pop, or a timed command's due time, until the actuator
+            // has been written
+  Total,    // comm.update() until the actuator has been written, less the
+            // time a timed command was held on purpose
+};
+
+constexpr size_t LATENCY_STAGES = static_cast<size_t>(LatencyStage::Total) + 1;
+
+struct LatencySummary {
+  uint32_t count = 0;
+  uint32_t min = 0;
+  uint32_t mean = 0;
+  uint32_t max = 0;
+  uint32_t p99 = 0;
+};
+
+// Log-linear histogram of 32-bit values: exact below 2^SUB_BUCKET_BITS, then
+// 2^SUB_BUCKET_BITS buckets per power of two, so a percentile is reported
+// at most 1 / 2^SUB_BUCKET_BITS above the true value.
+//
+// Single writer. summary() may run on the other core; it retries until it
+// has read a state no record() was in the middle of.
+class LatencyHistogram {
+public:
+  static constexpr uint8_t SUB_BUCKET_BITS = 2;
+  static constexpr size_t BUCKETS = (32 - SUB_BUCKET_BITS + 1)
+                                    << SUB_BUCKET_BITS;
+
+  static constexpr size_t bucket_of(const uint32_t value) {
+    if (value < (1u << SUB_BUCKET_BITS))
+      return value;
+
+    const auto exponent = static_cast<uint8_t>(std::bit_width(value) - 1);
+    const auto shift = exponent - SUB_BUCKET_BITS;
+    const auto mantissa = (value >> shift) & ((1u << SUB_BUCKET_BITS) - 1);
+
+    return ((shift + 1) << SUB_BUCKET_BITS) + mantissa;
+  }
+
+  // Largest value that lands in the bucket
+  static constexpr uint32_t upper_bound(const size_t bucket) {
+    if (bucket < (1u << SUB_BUCKET_BITS))
+      return static_cast<uint32_t>(bucket);
+
+    const auto shift = (bucket >> SUB_BUCKET_BITS) - 1;
+    const auto mantissa = bucket & ((1u << SUB_BUCKET_BITS) - 1);
+    const auto lower = static_cast<uint64_t>((1u << SUB_BUCKET_BITS) + mantissa)
+                       << shift;
+
+    return static_cast<uint32_t>(lower + (uint64_t{1} << shift) - 1);
+  }
+
+  void record(const uint32_t value) {
+    const auto sequence = writes.load(std::memory_order_relaxed);
+
+    writes.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    buckets[bucket_of(value)]++;
+    total += value;
+
+    if (count == 0 || value < minimum) {
+      minimum = value;
+    }
+
+    if (value > maximum) {
+      maximum = value;
+    }
+
+    count++;
+
+    writes.store(sequence + 2, std::memory_order_release);
+  }
+
+  [[nodiscard]] LatencySummary summary() const {
+    while (true) {
+      const auto sequence = writes.load(std::memory_order_acquire);
+
+      if (sequence & 1)
+        continue;
+
+      const auto result = read();
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if (writes.load(std::memory_order_relaxed) == sequence)
+        return result;
+    }
+  }
+
+private:
+  std::array<uint32_t, BUCKETS> buckets{};
+  uint64_t total = 0;
+  uint32_t count = 0;
+  uint32_t minimum = 0;
+  uint32_t maximum = 0;
+
+  std::atomic<uint32_t> writes{0};
+
+  [[nodiscard]] LatencySummary read() const {
+    LatencySummary result;
+
+    result.count = count;
+
+    if (count == 0)
+      return result;
+
+    result.min = minimum;
+    result.max = maximum;
+    result.mean = static_cast<uint32_t>(total / count);
+
+    // Rank of the 99th percentile, rounded up
+    const auto rank = count - count / 100;
+    uint32_t seen = 0;
+
+    for (size_t i = 0; i < BUCKETS; ++i) {
+      seen += buckets[i];
+
+      if (seen >= rank) {
+        result.p99 = std::min(upper_bound(i), maximum);
+
+        break;
+      }
+    }
+
+    return result;
+  }
+};
+
+// Times a command picks up on its way to core 1, in time_us_32() since the
+// cores do not share a cycle counter.
+struct LatencyStamps {
+#if FRAISELAIT_LATENCY_TRACE
+  bool traced = false;
+  uint32_t received_at_us = 0;
+  uint32_t queued_at_us = 0;
+  uint32_t dequeued_at_us = 0;
+#endif
+};
+
+// Hooks along the command path. Core 0 stages are measured with the CPU
+// cycle counter; the stages that end on core 1 use the shared microsecond
+// timer and are converted to cycles, so their resolution is 1 us.
+namespace latency {
+
+#if FRAISELAIT_LATENCY_TRACE
+
+constexpr bool ENABLED = true;
+
+// Core 0, around comm.update()
+void begin_receive();
+void end_receive();
+
+// Core 0, SerialCommunicator
+void packet_received();
+void packet_handled();
+
+// Core 0, data handlers
+void handler_entered();
+void handler_finished();
+
+// Core 0, CoreCommandQueue::push
+void stamp(LatencyStamps &stamps);
+
+// Core 1, per command popped from the queue and then per command applied,
+// whether on arrival or by CommandScheduler once it is due. due_at_us is 0
+// for immediate commands.
+void dequeued(LatencyStamps &stamps);
+void applied(const LatencyStamps &stamps, uint64_t due_at_us);
+
+LatencySummary summary(LatencyStage stage);
+
+#else
+
+constexpr bool ENABLED = false;
+
+inline void begin_receive() {}
+inline void end_receive() {}
+inline void packet_received() {}
+inline void packet_handled() {}
+inline void handler_entered() {}
+inline void handler_finished() {}
+inline void stamp(LatencyStamps &) {}
+inline void dequeued(LatencyStamps &) {}
+inline void applied(const LatencyStamps &, uint64_t) {}
+
+inline LatencySummary summary(LatencyStage) { return {}; }
+
+#endif
+
+} // namespace latency
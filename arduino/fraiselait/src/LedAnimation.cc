@@ -0,0 +1,103 @@
+#include "LedAnimation.h"
+
+uint32_t ease(const Easing easing, const uint32_t progress) {
+  const uint64_t t = progress;
+
+  switch (easing) {
+    case Easing::Linear:
+      return progress;
+
+    case Easing::Step:
+      return progress >= LedAnimation::ONE ? LedAnimation::ONE : 0;
+
+    case Easing::EaseIn:
+      return static_cast<uint32_t>(t * t >> 16);
+
+    case Easing::EaseOut: {
+      const auto rest = LedAnimation::ONE - t;
+
+      return static_cast<uint32_t>(LedAnimation::ONE - (rest * rest >> 16));
+    }
+
+    case Easing::EaseInOut:
+      // Smoothstep: t^2 (3 - 2t)
+      return static_cast<uint32_t>(
+          (t * t >> 16) * (3 * LedAnimation::ONE - 2 * t) >> 16);
+  }
+
+  return progress;
+}
+
+uint8_t mix(const uint8_t from, const uint8_t to, const uint32_t weight) {
+  const auto delta = static_cast<int32_t>(to) - from;
+  const auto value = (static_cast<int32_t>(from) << 16) +
+                     delta * static_cast<int32_t>(weight) + (1 << 15);
+
+  return static_cast<uint8_t>(value >> 16);
+}
+
+RGBColor LedAnimation::sample(const uint32_t at_us, size_t &segment) const {
+  if (count == 0)
+    return {0, 0, 0};
+
+  if (segment >= count || keyframes[segment].at_us() > at_us) {
+    segment = 0;
+  }
+
+  while (segment + 1 < count && keyframes[segment + 1].at_us() <= at_us) {
+    segment++;
+  }
+
+  const auto &from = keyframes[segment];
+
+  if (segment + 1 == count || at_us < from.at_us())
+    return from.color;
+
+  const auto &to = keyframes[segment + 1];
+  const auto span_us = to.at_us() - from.at_us();
+  const auto progress = static_cast<uint32_t>(
+      (static_cast<uint64_t>(at_us - from.at_us()) << 16) / span_us);
+  const auto weight = ease(from.easing, progress);
+
+  return {
+      mix(from.color.r, to.color.r, weight),
+      mix(from.color.g, to.color.g, weight),
+      mix(from.color.b, to.color.b, weight),
+  };
+}
+
+bool parse_led_animation(pcomm::bytes::Decoder &decoder,
+                         LedAnimation &animation) {
+  if (decoder.remaining() < 1)
+    return false;
+
+  const auto count = decoder.pop_byte();
+
+  if (count == 0 || count > animation.keyframes.size() ||
+      decoder.remaining() < count * Keyframe::SIZE) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    auto &keyframe = animation.keyframes[i];
+
+    keyframe.at_ms = decoder.pop_number<uint16_t>();
+    keyframe.color.r = decoder.pop_byte();
+    keyframe.color.g = decoder.pop_byte();
+    keyframe.color.b = decoder.pop_byte();
+
+    const auto easing = decoder.pop_byte();
+
+    if (easing > static_cast<uint8_t>(Easing::EaseInOut))
+      return false;
+
+    if (i > 0 && keyframe.at_ms <= animation.keyframes[i - 1].at_ms)
+      return false;
+
+    keyframe.easing = static_cast<Easing>(easing);
+  }
+
+  animation.count = count;
+
+  return true;
+}
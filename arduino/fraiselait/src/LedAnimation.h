@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "CoreCommand.h"
+#include "SerialCommunicator.h"
+#include "constants.h"
+
+// Shape of the segment that starts at a keyframe
+enum class Easing : uint8_t {
+  Linear = 0x00,
+  Step = 0x01, // Holds the color until the next keyframe
+  EaseIn = 0x02,
+  EaseOut = 0x03,
+  EaseInOut = 0x04,
+};
+
+// One keyframe as uploaded by the host (little endian):
+//   at_ms(2) r(1) g(1) b(1) easing(1)
+struct Keyframe {
+  static constexpr size_t SIZE = 2 + 1 + 1 + 1 + 1;
+
+  uint16_t at_ms = 0;
+  RGBColor color{};
+  Easing easing = Easing::Linear;
+
+  [[nodiscard]] uint32_t at_us() const { return at_ms * 1000u; }
+};
+
+// Keyframe times are strictly increasing; the color before the first one is
+// the first keyframe's, and the animation ends (or loops) at the last one.
+struct LedAnimation {
+  // Progress through a segment, 0 to ONE inclusive
+  static constexpr uint32_t ONE = 1u << 16;
+
+  std::array<Keyframe, LED_ANIMATION_CAPACITY> keyframes{};
+  size_t count = 0;
+
+  [[nodiscard]] uint32_t duration_us() const {
+    return count == 0 ? 0 : keyframes[count - 1].at_us();
+  }
+
+  // Color `at_us` into the animation. `segment` caches the keyframe the last
+  // lookup ended on so a sweep forward costs O(1) per frame; reset it to 0
+  // when time goes backwards.
+  [[nodiscard]] RGBColor sample(uint32_t at_us, size_t &segment) const;
+};
+
+// Maps progress through a segment onto the easing curve, both in 0..ONE.
+uint32_t ease(Easing easing, uint32_t progress);
+
+// Blends one color channel, `weight` 0 giving `from` and ONE giving `to`.
+uint8_t mix(uint8_t from, uint8_t to, uint32_t weight);
+
+// Decodes a CommandLedAnimation body following its flags byte:
+//   count(1) count * Keyframe
+bool parse_led_animation(pcomm::bytes::Decoder &decoder,
+                         LedAnimation &animation);
@@ -0,0 +1,89 @@
+#include "LedAnimator.h"
+
+#include "InterruptLock.h"
+
+void LedAnimator::play(const LedAnimation &next, const bool loop) {
+  if (!pool)
+    return;
+
+  InterruptLock lock;
+
+  cancel();
+
+  animation = next;
+  elapsed_us = 0;
+  segment = 0;
+  looping = loop;
+  // The color may have been set directly since the last frame
+  any_shown = false;
+
+  if (!render())
+    return;
+
+  alarm = alarm_pool_add_alarm_in_us(pool, FRAME_US, on_alarm, this, true);
+
+  if (alarm < 0) {
+    alarm = 0;
+  }
+}
+
+void LedAnimator::stop() {
+  InterruptLock lock;
+
+  cancel();
+}
+
+void LedAnimator::cancel() {
+  if (alarm <= 0)
+    return;
+
+  alarm_pool_cancel_alarm(pool, alarm);
+
+  alarm = 0;
+}
+
+void LedAnimator::show(const RGBColor &color) {
+  if (any_shown && color.r == shown.r && color.g == shown.g &&
+      color.b == shown.b) {
+    return;
+  }
+
+  output(color);
+
+  shown = color;
+  any_shown = true;
+}
+
+bool LedAnimator::render() {
+  const auto duration_us = animation.duration_us();
+
+  if (elapsed_us >= duration_us) {
+    if (!looping || duration_us == 0) {
+      // Land exactly on the last keyframe
+      show(animation.sample(duration_us, segment));
+
+      return false;
+    }
+
+    elapsed_us %= duration_us;
+  }
+
+  show(animation.sample(elapsed_us, segment));
+
+  return true;
+}
+
+int64_t LedAnimator::on_alarm(alarm_id_t, void *user_data) {
+  auto &self = *static_cast<LedAnimator *>(user_data);
+
+  self.elapsed_us += FRAME_US;
+
+  if (!self.render()) {
+    self.alarm = 0;
+
+    return 0;
+  }
+
+  // Negative: relative to the time this alarm was scheduled for
+  return -static_cast<int64_t>(FRAME_US);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <pico/time.h>
+
+#include "LedAnimation.h"
+
+// Renders a LedAnimation at LED_ANIMATION_FRAME_HZ from an alarm; call it
+// from the core its alarm pool belongs to. Frames are timed by counting
+// periods rather than reading the clock, so a late callback never stretches
+// the animation. The output only runs when the rendered color changes.
+class LedAnimator {
+public:
+  static constexpr uint32_t FRAME_US = 1'000'000 / LED_ANIMATION_FRAME_HZ;
+
+  using Output = void (*)(const RGBColor &color);
+
+  explicit LedAnimator(const Output output) : output(output) {}
+
+  // Alarms go to `alarm_pool`, whose callbacks run on the core that
+  // created it.
+  void begin(alarm_pool_t *alarm_pool) { pool = alarm_pool; }
+
+  // Replaces any running animation and starts from its first frame.
+  void play(const LedAnimation &next, bool loop);
+
+  // Leaves the LED at whatever color it last showed.
+  void stop();
+
+private:
+  Output output;
+
+  alarm_pool_t *pool = nullptr;
+  alarm_id_t alarm = 0;
+
+  LedAnimation animation;
+  uint32_t elapsed_us = 0;
+  size_t segment = 0;
+  bool looping = false;
+
+  RGBColor shown{};
+  bool any_shown = false;
+
+  // All three expect interrupts to be disabled.
+  void cancel();
+  void show(const RGBColor &color);
+  // Returns false once the animation is over.
+  bool render();
+
+  static int64_t on_alarm(alarm_id_t id, void *user_data);
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+#include <pcomm/pcomm.h>
+
+// Fixed-layout messages described once at compile time:
+//
+//   using ToneMessage = Message<DataTypes::CommandDataSet, "Tone",
+//                               Field<"frequency", &ToneData::frequency>,
+//                               Field<"volume", &ToneData::volume>>;
+//
+// Fields go on the wire back to back in little endian, in the order listed.
+// The total size is a constant, so decoding checks the bounds once per
+// message, and encoding and decoding are plain member copies without
+// virtual calls. schema() describes the layout for the host.
+
+static_assert(std::endian::native == std::endian::little,
+              "Fields are copied as is and must already be little endian");
+
+// Type tags in a schema description
+enum class WireType : uint8_t {
+  Bool = 0x00,
+  U8 = 0x01,
+  I8 = 0x02,
+  U16 = 0x03,
+  I16 = 0x04,
+  U32 = 0x05,
+  I32 = 0x06,
+  U64 = 0x07,
+  I64 = 0x08,
+  F32 = 0x09,
+  F64 = 0x0a,
+};
+
+template <typename T> constexpr WireType wire_type_of() {
+  if constexpr (std::is_enum_v<T>) {
+    return wire_type_of<std::underlying_type_t<T>>();
+  } else if constexpr (std::is_same_v<T, bool>) {
+    return WireType::Bool;
+  } else if constexpr (std::is_same_v<T, float>) {
+    static_assert(sizeof(float) == 4);
+
+    return WireType::F32;
+  } else if constexpr (std::is_same_v<T, double>) {
+    static_assert(sizeof(double) == 8);
+
+    return WireType::F64;
+  } else {
+    static_assert(std::is_integral_v<T> && sizeof(T) <= 8,
+                  "Unsupported field type");
+
+    constexpr auto width = std::bit_width(sizeof(T)) - 1;
+    constexpr auto tag = 1 + 2 * width + (std::is_signed_v<T> ? 1 : 0);
+
+    return static_cast<WireType>(tag);
+  }
+}
+
+// Name of a field or message, usable as a template argument.
+template <size_t N> struct FixedName {
+  std::array<char, N - 1> chars{};
+
+  constexpr FixedName(const char (&name)[N]) {
+    std::copy_n(name, N - 1, chars.begin());
+  }
+
+  static constexpr size_t size() { return N - 1; }
+};
+
+template <typename> struct MemberTraits;
+
+template <typename S, typename T> struct MemberTraits<T S::*> {
+  using Owner = S;
+  using Type = T;
+};
+
+template <FixedName Name, auto Member> struct Field {
+  using Owner = typename MemberTraits<decltype(Member)>::Owner;
+  using Type = typename MemberTraits<decltype(Member)>::Type;
+
+  static constexpr auto NAME = Name;
+  static constexpr WireType WIRE_TYPE = wire_type_of<Type>();
+  static constexpr size_t SIZE = sizeof(Type);
+
+  static uint8_t *write(const Owner &value, uint8_t *out) {
+    std::memcpy(out, &(value.*Member), SIZE);
+
+    return out + SIZE;
+  }
+
+  static const uint8_t *read(Owner &value, const uint8_t *in) {
+    if constexpr (std::is_same_v<Type, bool>) {
+      // Any non-zero byte is true; copying it into a bool could be invalid
+      value.*Member = *in != 0;
+    } else {
+      std::memcpy(&(value.*Member), in, SIZE);
+    }
+
+    return in + SIZE;
+  }
+};
+
+// Code is the DataTypes value of the packet the message travels in.
+template <auto Code, FixedName Name, typename... Fields> struct Message {
+  static_assert(sizeof...(Fields) > 0, "Message must have fields");
+
+  using Owner =
+      typename std::tuple_element_t<0, std::tuple<Fields...>>::Owner;
+
+  static_assert((std::is_same_v<typename Fields::Owner, Owner> && ...),
+                "All fields must be members of the same struct");
+
+  static constexpr auto CODE = static_cast<uint16_t>(Code);
+  static constexpr size_t SIZE = (Fields::SIZE + ...);
+
+  using Bytes = std::array<uint8_t, SIZE>;
+
+  static void encode(const Owner &value, uint8_t *out) {
+    ((out = Fields::write(value, out)), ...);
+  }
+
+  [[nodiscard]] static Bytes encode(const Owner &value) {
+    Bytes bytes;
+
+    encode(value, bytes.data());
+
+    return bytes;
+  }
+
+  static void encode(const Owner &value,
+                     const pcomm::bytes::Encoder &encoder) {
+    const auto bytes = encode(value);
+
+    encoder.push_bytes(bytes.data(), bytes.size());
+  }
+
+  // Leaves `value` untouched if fewer than SIZE bytes are left.
+  static bool decode(pcomm::bytes::Decoder &decoder, Owner &value) {
+    if (decoder.remaining() < SIZE)
+      return false;
+
+    Bytes bytes;
+
+    decoder.pop_bytes(bytes.data(), bytes.size());
+
+    const uint8_t *in = bytes.data();
+
+    ((in = Fields::read(value, in)), ...);
+
+    return true;
+  }
+
+  // code(2) name_length(1) name field_count(1)
+  //   field_count * [type(1) name_length(1) name]
+  static constexpr size_t SCHEMA_SIZE =
+      2 + 1 + Name.size() + 1 + ((1 + 1 + Fields::NAME.size()) + ...);
+
+  static constexpr std::array<uint8_t, SCHEMA_SIZE> schema() {
+    std::array<uint8_t, SCHEMA_SIZE> out{};
+    size_t at = 0;
+
+    const auto put_name = [&](const auto &name) {
+      out[at++] = static_cast<uint8_t>(name.size());
+
+      for (const auto c : name.chars) {
+        out[at++] = static_cast<uint8_t>(c);
+      }
+    };
+
+    out[at++] = static_cast<uint8_t>(CODE);
+    out[at++] = static_cast<uint8_t>(CODE >> 8);
+
+    put_name(Name);
+
+    out[at++] = static_cast<uint8_t>(sizeof...(Fields));
+
+    ((out[at++] = static_cast<uint8_t>(Fields::WIRE_TYPE),
+      put_name(Fields::NAME)),
+     ...);
+
+    return out;
+  }
+};
+
+// Schemas of several messages behind their count:
+//   count(1) count * Message::schema()
+template <typename... Messages> constexpr auto message_schema() {
+  static_assert(sizeof...(Messages) < 256);
+
+  std::array<uint8_t, 1 + (Messages::SCHEMA_SIZE + ...)> out{};
+  size_t at = 0;
+
+  out[at++] = static_cast<uint8_t>(sizeof...(Messages));
+
+  (
+      [&] {
+        for (const auto byte : Messages::schema()) {
+          out[at++] = byte;
+        }
+      }(),
+      ...);
+
+  return out;
+}
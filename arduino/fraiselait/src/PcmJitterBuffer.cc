@@ -0,0 +1,128 @@
+#include "PcmJitterBuffer.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint8_t LEVEL_BITS = std::bit_width(PCM_PWM_WRAP);
+
+uint16_t level_of_u8(const uint8_t sample) {
+  return static_cast<uint16_t>((sample << 8 | sample) >> (16 - LEVEL_BITS));
+}
+
+uint16_t level_of_s16(const uint8_t *sample) {
+  const auto value = static_cast<uint16_t>(sample[0] | sample[1] << 8);
+
+  // Flipping the sign bit turns signed into offset binary
+  return static_cast<uint16_t>((value ^ 0x8000) >> (16 - LEVEL_BITS));
+}
+
+} // namespace
+
+static_assert(PCM_PWM_WRAP + 1 == 1u << LEVEL_BITS,
+              "PCM_PWM_WRAP must be a power of two minus one");
+
+void PcmJitterBuffer::set_prebuffer(const size_t samples) {
+  prebuffer.store(static_cast<uint32_t>(std::min(samples, PCM_BUFFER_SAMPLES)),
+                  std::memory_order_relaxed);
+}
+
+void PcmJitterBuffer::restart() {
+  restart_at.store(head.load(std::memory_order_relaxed),
+                   std::memory_order_relaxed);
+  restarts_requested.store(
+      restarts_requested.load(std::memory_order_relaxed) + 1,
+      std::memory_order_release);
+}
+
+size_t PcmJitterBuffer::write(const uint8_t *data, const size_t size) {
+  const auto bytes_per_sample = format == PcmFormat::S16 ? 2 : 1;
+  const auto count = size / bytes_per_sample;
+
+  // Until the consumer applies a restart, the samples it drops count as
+  // free already
+  const auto write_index = head.load(std::memory_order_relaxed);
+  const auto restarting = restarts_requested.load(std::memory_order_relaxed) !=
+                          restarts_applied.load(std::memory_order_acquire);
+  const auto read_index = restarting
+                              ? restart_at.load(std::memory_order_relaxed)
+                              : tail.load(std::memory_order_acquire);
+  const auto free = PCM_BUFFER_SAMPLES - (write_index - read_index);
+  const auto accepted = std::min(count, free);
+
+  for (size_t i = 0; i < accepted; ++i) {
+    levels[(write_index + i) & (PCM_BUFFER_SAMPLES - 1)] =
+        format == PcmFormat::S16 ? level_of_s16(data + i * 2)
+                                 : level_of_u8(data[i]);
+  }
+
+  head.store(write_index + accepted, std::memory_order_release);
+
+  if (accepted < count) {
+    overruns.store(overruns.load(std::memory_order_relaxed) + count - accepted,
+                   std::memory_order_relaxed);
+  }
+
+  return accepted;
+}
+
+void PcmJitterBuffer::read(uint16_t *out, const size_t count) {
+  const auto requested = restarts_requested.load(std::memory_order_acquire);
+
+  if (requested != restarts_applied.load(std::memory_order_relaxed)) {
+    const auto at = restart_at.load(std::memory_order_relaxed);
+
+    // A read racing the restart may already be past it; never go back
+    if (static_cast<int32_t>(at - tail.load(std::memory_order_relaxed)) > 0) {
+      tail.store(at, std::memory_order_release);
+    }
+
+    restarts_applied.store(requested, std::memory_order_release);
+
+    playing = false;
+  }
+
+  const auto read_index = tail.load(std::memory_order_relaxed);
+  const auto available = head.load(std::memory_order_acquire) - read_index;
+
+  if (!playing) {
+    if (available < prebuffer.load(std::memory_order_relaxed) ||
+        available == 0) {
+      std::fill_n(out, count, SILENCE);
+
+      return;
+    }
+
+    playing = true;
+  }
+
+  const auto taken = std::min<size_t>(count, available);
+
+  for (size_t i = 0; i < taken; ++i) {
+    out[i] = levels[(read_index + i) & (PCM_BUFFER_SAMPLES - 1)];
+  }
+
+  tail.store(read_index + taken, std::memory_order_release);
+
+  played.store(played.load(std::memory_order_relaxed) + taken,
+               std::memory_order_relaxed);
+
+  if (taken == count)
+    return;
+
+  // Ran dry: fill with silence and wait for a full prebuffer again
+  std::fill_n(out + taken, count - taken, SILENCE);
+
+  underruns.store(underruns.load(std::memory_order_relaxed) + count - taken,
+                  std::memory_order_relaxed);
+
+  playing = false;
+}
+
+PcmStats PcmJitterBuffer::stats() const {
+  return {head.load(std::memory_order_acquire) -
+              tail.load(std::memory_order_acquire),
+          underruns.load(std::memory_order_relaxed),
+          overruns.load(std::memory_order_relaxed),
+          played.load(std::memory_order_relaxed)};
+}
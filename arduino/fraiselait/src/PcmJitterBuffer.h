@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "constants.h"
+
+enum class PcmFormat : uint8_t {
+  U8 = 0x00,  // Unsigned, 128 is silence
+  S16 = 0x01, // Signed little endian, 0 is silence
+};
+
+struct PcmStats {
+  uint32_t buffered_samples = 0;
+  // Silence played because the host did not keep up
+  uint32_t underrun_samples = 0;
+  // Host samples dropped because the buffer was full
+  uint32_t overrun_samples = 0;
+  uint32_t played_samples = 0;
+};
+
+// Holds host PCM, already converted to PWM levels, between the USB handler
+// on core 0 and the DMA refill on core 1. Playback waits until `prebuffer`
+// samples are queued, and again after every underrun, so bursty USB
+// delivery does not turn into clicks.
+class PcmJitterBuffer {
+  static_assert(std::has_single_bit(PCM_BUFFER_SAMPLES),
+                "PCM_BUFFER_SAMPLES must be a power of two");
+
+public:
+  static constexpr uint16_t SILENCE = (PCM_PWM_WRAP + 1) / 2;
+
+  static constexpr bool is_valid(const uint8_t format) {
+    return format <= static_cast<uint8_t>(PcmFormat::S16);
+  }
+
+  // Producer side (core 0)
+
+  void set_format(const PcmFormat value) { format = value; }
+
+  // Clamped to the buffer size.
+  void set_prebuffer(size_t samples);
+
+  // Drops everything queued so far and waits for a full prebuffer again.
+  // Samples written after the call are kept, even if the consumer has not
+  // caught up yet.
+  void restart();
+
+  // Converts and queues as many whole samples as fit; returns how many
+  // were queued.
+  size_t write(const uint8_t *data, size_t size);
+
+  // Consumer side (core 1)
+
+  // Fills `out` completely, with silence where no samples are available.
+  void read(uint16_t *out, size_t count);
+
+  [[nodiscard]] PcmStats stats() const;
+
+private:
+  std::array<uint16_t, PCM_BUFFER_SAMPLES> levels{};
+
+  std::atomic<uint32_t> head{0};
+  std::atomic<uint32_t> tail{0};
+
+  PcmFormat format = PcmFormat::U8;
+  std::atomic<uint32_t> prebuffer{PCM_DEFAULT_PREBUFFER};
+
+  // Written by the consumer
+  bool playing = false;
+  std::atomic<uint32_t> underruns{0};
+  std::atomic<uint32_t> played{0};
+  std::atomic<uint32_t> restarts_applied{0};
+
+  // Written by the producer. A restart is pending while restarts_requested
+  // is ahead of restarts_applied; each counter has a single writer, so no
+  // read-modify-write is needed (see CoreCommandQueue).
+  std::atomic<uint32_t> overruns{0};
+  std::atomic<uint32_t> restarts_requested{0};
+  std::atomic<uint32_t> restart_at{0};
+};
@@ -0,0 +1,94 @@
+#include "RawSampleStream.h"
+
+#include "little_endian.h"
+
+namespace {
+
+// Offsets into RawSampleBlock::bytes
+constexpr size_t SEQUENCE_OFFSET = 0;
+constexpr size_t DROPPED_OFFSET = 4;
+constexpr size_t OVERRUNS_OFFSET = 8;
+constexpr size_t TIMESTAMP_OFFSET = 12;
+constexpr size_t RATE_OFFSET = 20;
+constexpr size_t COUNT_OFFSET = 24;
+
+} // namespace
+
+void RawSampleStream::begin(const uint32_t sample_rate_hz) {
+  this->sample_rate_hz = sample_rate_hz;
+
+  current = nullptr;
+  filled = 0;
+  sequence = 0;
+  dropped_blocks = 0;
+}
+
+void RawSampleStream::end() {
+  // A partial block is never sent
+  sample_rate_hz = 0;
+  current = nullptr;
+  filled = 0;
+}
+
+void RawSampleStream::push(const uint16_t *samples, const size_t count,
+                           const uint64_t completed_at_us,
+                           const uint32_t adc_overruns) {
+  if (!active())
+    return;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (!current) {
+      const auto samples_after = static_cast<uint64_t>(count - 1 - i);
+
+      open_block(completed_at_us -
+                 samples_after * 1'000'000 / sample_rate_hz);
+    }
+
+    uint8_t *const out =
+        current->bytes.data() + RawSampleBlock::HEADER_SIZE + filled / 2 * 3;
+    const uint16_t sample = samples[i] & 0x0fff;
+
+    if (filled % 2 == 0) {
+      out[0] = static_cast<uint8_t>(sample);
+      out[1] = static_cast<uint8_t>(sample >> 8);
+    } else {
+      out[1] |= static_cast<uint8_t>(sample << 4);
+      out[2] = static_cast<uint8_t>(sample >> 4);
+    }
+
+    if (++filled == RAW_BLOCK_SAMPLES) {
+      close_block(adc_overruns);
+    }
+  }
+}
+
+void RawSampleStream::open_block(const uint64_t start_timestamp_us) {
+  current = blocks.try_reserve();
+
+  if (!current) {
+    current = &overflow;
+  }
+
+  filled = 0;
+
+  put_le(current->bytes.data() + TIMESTAMP_OFFSET, start_timestamp_us);
+}
+
+void RawSampleStream::close_block(const uint32_t adc_overruns) {
+  auto &bytes = current->bytes;
+
+  put_le(bytes.data() + SEQUENCE_OFFSET, sequence++);
+  put_le(bytes.data() + DROPPED_OFFSET, dropped_blocks);
+  put_le(bytes.data() + OVERRUNS_OFFSET, adc_overruns);
+  put_le(bytes.data() + RATE_OFFSET, sample_rate_hz);
+  put_le(bytes.data() + COUNT_OFFSET, static_cast<uint16_t>(filled));
+
+  if (current == &overflow) {
+    dropped_blocks++;
+  } else {
+    blocks.publish();
+  }
+
+  current = nullptr;
+  filled = 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "FrameWriter.h"
+#include "SpscRing.h"
+#include "constants.h"
+
+// One frame of ResponseRawStream, laid out exactly as it goes on the wire:
+//   sequence(4) dropped_blocks(4) adc_overruns(4) start_timestamp_us(8)
+//   sample_rate_hz(4) count(2) samples(count * 12 bits)
+// Samples are packed two per three bytes, low bits first:
+//   s0[7:0] | s1[3:0] s0[11:8] | s1[11:4]
+// sequence counts every block, including dropped ones, so a gap in it
+// together with dropped_blocks tells the host what it missed. adc_overruns
+// is cumulative and covers samples lost before they reached the stream.
+struct RawSampleBlock {
+  static constexpr size_t HEADER_SIZE = 4 + 4 + 4 + 8 + 4 + 2;
+  static constexpr size_t PAYLOAD_SIZE = RAW_BLOCK_SAMPLES / 2 * 3;
+  static constexpr size_t SIZE = HEADER_SIZE + PAYLOAD_SIZE;
+
+  static_assert(RAW_BLOCK_SAMPLES % 2 == 0,
+                "Samples are packed in pairs");
+  static_assert(SIZE + 2 <= FrameWriter::MAX_FRAME_SIZE,
+                "Raw blocks must fit in one frame with the data code");
+
+  std::array<uint8_t, SIZE> bytes{};
+};
+
+// Packs raw light sensor conversions into RawSampleBlocks on core 1 and
+// hands complete blocks to core 0. When core 0 falls behind, new blocks are
+// dropped and counted instead of blocking the ADC path.
+class RawSampleStream {
+public:
+  // Producer side (core 1)
+
+  void begin(uint32_t sample_rate_hz);
+
+  void end();
+
+  [[nodiscard]] bool active() const { return sample_rate_hz != 0; }
+
+  void push(const uint16_t *samples, size_t count, uint64_t completed_at_us,
+            uint32_t adc_overruns);
+
+  // Consumer side (core 0)
+
+  // Oldest complete block, or nullptr. Valid until pop().
+  [[nodiscard]] const RawSampleBlock *front() const { return blocks.front(); }
+
+  void pop() { blocks.pop(); }
+
+private:
+  SpscRing<RawSampleBlock, RAW_RING_BLOCKS> blocks;
+
+  // Written into while the ring is full; its contents are discarded
+  RawSampleBlock overflow;
+
+  RawSampleBlock *current = nullptr;
+  size_t filled = 0;
+
+  uint32_t sample_rate_hz = 0;
+  uint32_t sequence = 0;
+  uint32_t dropped_blocks = 0;
+
+  void open_block(uint64_t start_timestamp_us);
+
+  void close_block(uint32_t adc_overruns);
+};
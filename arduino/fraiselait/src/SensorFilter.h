@@ -0,0 +1,324 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+
+#include "constants.h"
+
+// Integer-only smoothing stages. Every stage consumes one sample and either
+// produces an output (returns true) or swallows the input, which is how the
+// decimating stages lower the rate of everything after them.
+namespace filters {
+
+// Moving average over the last N samples.
+template <size_t N> class Boxcar {
+  static_assert(N > 0);
+
+public:
+  bool process(const int32_t in, int32_t &out) {
+    total += in - readings[index];
+    readings[index] = in;
+
+    if (++index >= N) {
+      index = 0;
+    }
+
+    out = total / static_cast<int32_t>(N);
+
+    return true;
+  }
+
+  void reset() { *this = {}; }
+
+private:
+  std::array<int32_t, N> readings{};
+  int32_t total = 0;
+  size_t index = 0;
+};
+
+// Exponential moving average with alpha = 1 / 2^Shift. The state keeps
+// FRACTION_BITS below the input so small steps are not lost to rounding.
+template <uint8_t Shift> class Ema {
+  static constexpr uint8_t FRACTION_BITS = 16;
+
+  static_assert(Shift > 0 && Shift < FRACTION_BITS);
+
+public:
+  bool process(const int32_t in, int32_t &out) {
+    if (!primed) {
+      state = in << FRACTION_BITS;
+      primed = true;
+    } else {
+      state += ((in << FRACTION_BITS) - state) >> Shift;
+    }
+
+    out = (state + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS;
+
+    return true;
+  }
+
+  void reset() { *this = {}; }
+
+private:
+  int32_t state = 0;
+  bool primed = false;
+};
+
+// Median of the last N samples. The window is kept sorted, so each sample
+// costs one removal and one insertion instead of a full sort.
+template <size_t N> class Median {
+  static_assert(N % 2 == 1, "Median window must be odd");
+
+public:
+  bool process(const int32_t in, int32_t &out) {
+    if (count < N) {
+      insert(in, count);
+
+      history[count++] = in;
+    } else {
+      const auto oldest = history[index];
+
+      history[index] = in;
+
+      if (++index >= N) {
+        index = 0;
+      }
+
+      // Remove the oldest value, then insert the new one
+      const auto position = static_cast<size_t>(
+          std::lower_bound(sorted.begin(), sorted.end(), oldest) -
+          sorted.begin());
+
+      std::copy(sorted.begin() + position + 1, sorted.end(),
+                sorted.begin() + position);
+
+      insert(in, N - 1);
+    }
+
+    out = sorted[(count - 1) / 2];
+
+    return true;
+  }
+
+  void reset() { *this = {}; }
+
+private:
+  std::array<int32_t, N> history{};
+  std::array<int32_t, N> sorted{};
+  size_t count = 0;
+  size_t index = 0;
+
+  // Inserts into the first `size` sorted entries
+  void insert(const int32_t value, size_t size) {
+    while (size > 0 && sorted[size - 1] > value) {
+      sorted[size] = sorted[size - 1];
+      --size;
+    }
+
+    sorted[size] = value;
+  }
+};
+
+// Order-stage cascaded integrator-comb decimator with a differential delay
+// of one. Emits one sample every Decimation inputs, normalized back to the
+// input scale. Integrators wrap in unsigned arithmetic; the comb section
+// undoes the wrap as long as the output fits in MAX_INPUT_BITS + growth.
+template <uint32_t Decimation, uint8_t Order> class Cic {
+  static constexpr uint8_t MAX_INPUT_BITS = 13; // 12-bit ADC counts, signed
+
+  static constexpr uint64_t gain() {
+    uint64_t value = 1;
+
+    for (uint8_t i = 0; i < Order; ++i) {
+      value *= Decimation;
+    }
+
+    return value;
+  }
+
+  static constexpr uint8_t growth_bits() {
+    uint8_t bits = 0;
+
+    while ((uint64_t{1} << bits) < gain()) {
+      ++bits;
+    }
+
+    return bits;
+  }
+
+  static_assert(Decimation > 1 && Order > 0);
+  static_assert(MAX_INPUT_BITS + growth_bits() <= 32,
+                "CIC register growth does not fit in 32 bits");
+
+public:
+  bool process(const int32_t in, int32_t &out) {
+    uint32_t value = static_cast<uint32_t>(in);
+
+    for (auto &integrator : integrators) {
+      integrator += value;
+      value = integrator;
+    }
+
+    if (++phase < Decimation)
+      return false;
+
+    phase = 0;
+
+    for (auto &delay : comb_delays) {
+      const auto previous = delay;
+
+      delay = value;
+      value -= previous;
+    }
+
+    out = static_cast<int32_t>(value) / static_cast<int32_t>(gain());
+
+    return true;
+  }
+
+  void reset() { *this = {}; }
+
+private:
+  std::array<uint32_t, Order> integrators{};
+  std::array<uint32_t, Order> comb_delays{};
+  uint32_t phase = 0;
+};
+
+// Stages applied left to right; stops as soon as one swallows the sample.
+template <typename... Stages> class Chain {
+public:
+  bool process(const int32_t in, int32_t &out) {
+    return process_from<0>(in, out);
+  }
+
+  void reset() {
+    std::apply([](auto &...stage) { (stage.reset(), ...); }, stages);
+  }
+
+private:
+  std::tuple<Stages...> stages;
+
+  template <size_t I> bool process_from(const int32_t in, int32_t &out) {
+    if constexpr (I == sizeof...(Stages)) {
+      out = in;
+
+      return true;
+    } else {
+      int32_t next;
+
+      if (!std::get<I>(stages).process(in, next))
+        return false;
+
+      return process_from<I + 1>(next, out);
+    }
+  }
+};
+
+} // namespace filters
+
+enum class SensorChannel : uint8_t {
+  LightSensor = 0x00,
+  CoreTemperature = 0x01,
+};
+
+enum class FilterPreset : uint8_t {
+  Raw = 0x00,
+  Boxcar = 0x01,
+  Ema = 0x02,
+  Median = 0x03,
+  MedianEma = 0x04,
+  Cic = 0x05,
+};
+
+// One sensor's smoothing, switchable between the presets at runtime. Every
+// preset chain is kept resident so switching never allocates; the newly
+// selected chain starts from a clean state.
+class SensorFilter {
+public:
+  using BoxcarChain = filters::Chain<filters::Boxcar<ANALOG_READINGS>>;
+  using EmaChain = filters::Chain<filters::Ema<FILTER_EMA_SHIFT>>;
+  using MedianChain = filters::Chain<filters::Median<FILTER_MEDIAN_WINDOW>>;
+  using MedianEmaChain = filters::Chain<filters::Median<FILTER_MEDIAN_WINDOW>,
+                                        filters::Ema<FILTER_EMA_SHIFT>>;
+  using CicChain = filters::Chain<
+      filters::Cic<FILTER_CIC_DECIMATION, FILTER_CIC_ORDER>>;
+
+  static bool is_valid(const uint8_t preset) {
+    return preset <= static_cast<uint8_t>(FilterPreset::Cic);
+  }
+
+  [[nodiscard]] FilterPreset preset() const { return selected; }
+
+  void select(const FilterPreset preset) {
+    selected = preset;
+
+    switch (preset) {
+      case FilterPreset::Raw:
+        break;
+
+      case FilterPreset::Boxcar:
+        boxcar.reset();
+
+        break;
+
+      case FilterPreset::Ema:
+        ema.reset();
+
+        break;
+
+      case FilterPreset::Median:
+        median.reset();
+
+        break;
+
+      case FilterPreset::MedianEma:
+        median_ema.reset();
+
+        break;
+
+      case FilterPreset::Cic:
+        cic.reset();
+
+        break;
+    }
+  }
+
+  // Returns true when `out` holds a new filtered value.
+  bool process(const int32_t in, int32_t &out) {
+    switch (selected) {
+      case FilterPreset::Raw:
+        out = in;
+
+        return true;
+
+      case FilterPreset::Boxcar:
+        return boxcar.process(in, out);
+
+      case FilterPreset::Ema:
+        return ema.process(in, out);
+
+      case FilterPreset::Median:
+        return median.process(in, out);
+
+      case FilterPreset::MedianEma:
+        return median_ema.process(in, out);
+
+      case FilterPreset::Cic:
+        return cic.process(in, out);
+    }
+
+    return false;
+  }
+
+private:
+  FilterPreset selected = FilterPreset::Boxcar;
+
+  BoxcarChain boxcar;
+  EmaChain ema;
+  MedianChain median;
+  MedianEmaChain median_ema;
+  CicChain cic;
+};
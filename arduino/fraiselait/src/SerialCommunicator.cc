@@ -1,48 +1,87 @@
 #include "SerialCommunicator.h"
 
+#include "ChunkMtu.h"
+#include "Compression.h"
+#include "FlowControl.h"
+#include "LatencyTrace.h"
+#include "SessionResume.h"
 #include "constants.h"
 #include "device_id.h"
+#include "little_endian.h"
 
 #include <algorithm>
+#include <array>
+
+SerialCommunicator::SerialCommunicator()
+    : writer([](const uint8_t *data, const size_t size) {
+        Serial.write(data, size);
+      }) {
+  writer.set_room([] {
+    const auto available = static_cast<size_t>(Serial.availableForWrite());
+
+    return available + USB_TX_BACKLOG >= USB_TX_BUFFER_SIZE ? available : 0;
+  });
+  writer.set_clock(time_us_32);
+
+  tx_body.reserve(FrameWriter::MAX_FRAME_SIZE);
+}
 
 void SerialCommunicator::on_unavailable() {
+  if (session_resume && is_connected()) {
+    session_resume->suspend(time_us_64());
+  }
+
   current_handshake_stage = HandshakeStage::None;
 
+  // The host drops half-received frames with the link
+  writer.discard();
+  writer.set_chunk_size(FrameWriter::DEFAULT_CHUNK_SIZE);
+
   if constexpr (SOFTWARE_RESET_ON_DISCONNECT) {
     watchdog_reboot(0, SRAM_END, 10);
   }
 
+  if (!session_resume || !session_resume->suspended()) {
+    end_session();
+  }
+
   if (disconnect_callback) {
     disconnect_callback();
   }
 }
 
-void SerialCommunicator::on_recv(const pcomm::packets::Packet packet) {
-  const auto type = static_cast<PacketType>(packet.type);
+void SerialCommunicator::poll_session() {
+  if (session_resume && session_resume->expire(time_us_64())) {
+    end_session();
+  }
+}
 
-  if (type == PacketType::Error) {
-    const auto &payload = packet.payload;
+void SerialCommunicator::end_session() {
+  if (session_end_callback) {
+    session_end_callback();
+  }
+}
 
-    if (payload.size() < 2) {
-      // Malformed error packet
-      return;
-    }
+void SerialCommunicator::on_recv(const pcomm::packets::Packet packet) {
+  // Earliest point the device sees a packet; used as the time sync receive
+  // timestamp
+  const auto received_at_us = time_us_64();
 
-    pcomm::bytes::Decoder decoder{payload.data(), payload.size()};
+  latency::packet_received();
 
-    const auto error_code = decoder.pop_number<uint16_t>();
-    const auto it = find_data_callback(error_code, error_callbacks);
+  receive(packet, received_at_us);
 
-    if (it == error_callbacks.end()) {
-      // No callback registered for this error code
-      return;
-    }
+  latency::packet_handled();
+}
 
-    std::vector<uint8_t> data(decoder.remaining());
+void SerialCommunicator::receive(const pcomm::packets::Packet &packet,
+                                 const uint64_t received_at_us) {
+  receive_stats.packets++;
 
-    decoder.pop_bytes(data.data(), data.size());
+  const auto type = static_cast<PacketType>(packet.type);
 
-    it->second(std::move(data));
+  if (type == PacketType::Error) {
+    dispatch_data_callback(packet, error_callbacks);
 
     return;
   }
@@ -53,39 +92,28 @@ void SerialCommunicator::on_recv(const pcomm::packets::Packet packet) {
           static_cast<uint16_t>(ReservedErrorCode::HandshakeNotCompleted));
     }
 
-    // Set handshake status led
-    if (current_handshake_stage == HandshakeStage::Completed) {
-      digitalWrite(LED_BUILTIN, LOW);
-    } else if (current_handshake_stage != HandshakeStage::None) {
-      digitalWrite(LED_BUILTIN, HIGH);
-    }
-
     return;
   }
 
   if (type == PacketType::Data) {
-    const auto &payload = packet.payload;
-
-    if (payload.size() < 2) {
-      // Malformed error packet
-      return;
+    if (flow_control) {
+      flow_control->on_rx();
     }
 
-    pcomm::bytes::Decoder decoder{payload.data(), payload.size()};
-
-    const auto data_code = decoder.pop_number<uint16_t>();
-    const auto it = find_data_callback(data_code, data_callbacks);
-
-    if (it == data_callbacks.end()) {
-      // No callback registered for this error code
-      return;
+    if (!answer_fast_path(packet, received_at_us)) {
+      dispatch_data_callback(packet, data_callbacks, static_data_handlers);
     }
 
-    std::vector<uint8_t> data(decoder.remaining());
+    return_credits();
 
-    decoder.pop_bytes(data.data(), data.size());
+    return;
+  }
 
-    it->second(std::move(data));
+  if (type == PacketType::CreditUpdate) {
+    if (flow_control && packet.payload.size() >= 2) {
+      flow_control->on_credit_update(
+          packet.payload[0] | static_cast<uint16_t>(packet.payload[1] << 8));
+    }
 
     return;
   }
@@ -96,61 +124,227 @@ void SerialCommunicator::on_recv(const pcomm::packets::Packet packet) {
   send_error(static_cast<uint16_t>(ReservedErrorCode::UnknownPacketType));
 }
 
-void SerialCommunicator::send_data(const uint16_t code,
-                                   const std::vector<uint8_t> &data_payload) {
-  if (!is_connected())
+bool SerialCommunicator::answer_fast_path(const pcomm::packets::Packet &packet,
+                                          const uint64_t received_at_us) {
+  const auto &payload = packet.payload;
+
+  if (payload.size() < 2)
+    return false;
+
+  const auto code = static_cast<DataTypes>(payload[0] | payload[1] << 8);
+
+  switch (code) {
+    case DataTypes::CommandPing:
+      // Echoes whatever the host put after the code. Not charged, like time
+      // sync: a pong held back for credit would only measure the wait
+      send_frame(PacketType::Data,
+                 static_cast<uint16_t>(DataTypes::ResponsePong),
+                 payload.data() + 2, payload.size() - 2,
+                 {CompressionCodec::None}, TxPriority::Control);
+
+      return true;
+
+    case DataTypes::CommandTimeSync:
+      send_time_sync(packet, received_at_us);
+
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// host_time(8) -> host_time(8) device_rx_us(8) device_tx_us(8)
+void SerialCommunicator::send_time_sync(const pcomm::packets::Packet &packet,
+                                        const uint64_t received_at_us) {
+  const auto &payload = packet.payload;
+
+  if (payload.size() < 2 + 8) {
+    send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+
     return;
+  }
 
-  std::vector<uint8_t> payload;
+  // Not charged: the host paid for it with its request, and a reply held
+  // back until credit returns would only be a sample too slow to trust
+  std::array<uint8_t, 8 + 8 + 8> body{};
 
-  const pcomm::bytes::Encoder encoder{payload};
+  std::copy_n(payload.begin() + 2, 8, body.begin());
 
-  encoder.push_number(code);
-  encoder.push_bytes(data_payload.data(), data_payload.size());
+  auto out = put_le(body.data() + 8, received_at_us);
 
-  send(pcomm::packets::Packet(static_cast<uint16_t>(PacketType::Data),
-                              std::move(payload)));
+  // Taken last so only chunking and the USB write remain after it
+  put_le(out, time_us_64());
+
+  send_frame(PacketType::Data,
+             static_cast<uint16_t>(DataTypes::ResponseTimeSync), body.data(),
+             body.size(), {CompressionCodec::None}, TxPriority::Control);
+}
+
+bool SerialCommunicator::can_send() const {
+  return !flow_control || flow_control->can_send();
+}
+
+void SerialCommunicator::return_credits() {
+  if (!flow_control || !is_connected())
+    return;
+
+  const auto credits = flow_control->take_rx_credits();
+
+  if (credits == 0)
+    return;
+
+  const std::array payload{static_cast<uint8_t>(credits),
+                           static_cast<uint8_t>(credits >> 8)};
+
+  writer.write(static_cast<uint16_t>(PacketType::CreditUpdate),
+               {{payload.data(), payload.size()}}, TxPriority::Control);
+}
+
+bool SerialCommunicator::take_tx_credit() {
+  return !flow_control || flow_control->consume_tx();
 }
 
 void SerialCommunicator::send_data(const uint16_t code,
-                                   const ISerializable &data) {
-  if (!is_connected())
+                                   const std::vector<uint8_t> &data_payload) {
+  if (!is_connected() || !take_tx_credit())
     return;
 
-  std::vector<uint8_t> payload;
+  send_frame(PacketType::Data, code, data_payload.data(), data_payload.size());
+}
 
-  const pcomm::bytes::Encoder encoder{payload};
+void SerialCommunicator::send_data(const uint16_t code,
+                                   const ISerializable &data,
+                                   const CompressionHint hint,
+                                   const TxPriority priority) {
+  if (!is_connected() || !take_tx_credit())
+    return;
 
-  encoder.push_number(code);
-  data.serialize(encoder);
+  send_frame(PacketType::Data, code, data, hint, priority);
+}
 
-  send(pcomm::packets::Packet(static_cast<uint16_t>(PacketType::Data),
-                              std::move(payload)));
+void SerialCommunicator::send_data(const uint16_t code, const TxSegment body,
+                                   const CompressionHint hint,
+                                   const TxPriority priority) {
+  if (!is_connected() || !take_tx_credit())
+    return;
+
+  send_frame(PacketType::Data, code, body.data, body.size, hint, priority);
 }
+
 void SerialCommunicator::send_error(const uint16_t code,
                                     const std::vector<uint8_t> &error_payload) {
-  std::vector<uint8_t> payload;
-
-  const pcomm::bytes::Encoder encoder{payload};
+  count_error(code);
 
-  encoder.push_number(code);
-  encoder.push_bytes(error_payload.data(), error_payload.size());
-
-  send(pcomm::packets::Packet(static_cast<uint16_t>(PacketType::Error),
-                              std::move(payload)));
+  send_frame(PacketType::Error, code, error_payload.data(),
+             error_payload.size(), {CompressionCodec::None},
+             TxPriority::Control);
 }
 
 void SerialCommunicator::send_error(const uint16_t code,
                                     const ISerializable &data) {
-  std::vector<uint8_t> payload;
+  count_error(code);
 
-  const pcomm::bytes::Encoder encoder{payload};
+  send_frame(PacketType::Error, code, data, {CompressionCodec::None},
+             TxPriority::Control);
+}
 
-  encoder.push_number(code);
-  data.serialize(encoder);
+void SerialCommunicator::count_error(const uint16_t code) {
+  switch (static_cast<ReservedErrorCode>(code)) {
+    case ReservedErrorCode::MalformedPacket:
+      receive_stats.malformed_packets++;
 
-  send(pcomm::packets::Packet(static_cast<uint16_t>(PacketType::Error),
-                              std::move(payload)));
+      break;
+
+    case ReservedErrorCode::UnknownPacketType:
+      receive_stats.unknown_packets++;
+
+      break;
+
+    default:
+      break;
+  }
+}
+
+void SerialCommunicator::send_frame(const PacketType type, const uint16_t code,
+                                    const uint8_t *body, const size_t size,
+                                    const CompressionHint hint,
+                                    const TxPriority priority) {
+  const std::array header{static_cast<uint8_t>(code),
+                          static_cast<uint8_t>(code >> 8)};
+
+  if (compressor && type == PacketType::Data) {
+    if (const auto compressed_size = compressor->compress(body, size, hint)) {
+      writer.write(static_cast<uint16_t>(PacketType::CompressedData),
+                   {{header.data(), header.size()},
+                    {compressor->data(), compressed_size}},
+                   priority);
+
+      return;
+    }
+  }
+
+  writer.write(static_cast<uint16_t>(type),
+               {{header.data(), header.size()}, {body, size}}, priority);
+}
+
+void SerialCommunicator::send_frame(const PacketType type, const uint16_t code,
+                                    const ISerializable &body,
+                                    const CompressionHint hint,
+                                    const TxPriority priority) {
+  const auto capacity = tx_body.capacity();
+
+  tx_body.clear();
+
+  const pcomm::bytes::Encoder encoder{tx_body};
+
+  body.serialize(encoder);
+
+  if (tx_body.capacity() != capacity) {
+    // Body outgrew the preallocated buffer
+    writer.stats().heap_allocations++;
+  }
+
+  send_frame(type, code, tx_body.data(), tx_body.size(), hint, priority);
+}
+
+bool CapabilityRegistry::add(ICapability &capability) {
+  const auto id = capability.id();
+
+  if (find(id))
+    return false;
+
+  if (slots.empty()) {
+    base = id;
+    slots.assign(1, &capability);
+
+    return true;
+  }
+
+  const auto low = std::min(id, base);
+  const auto high = std::max<size_t>(id, base + slots.size() - 1);
+
+  if (high - low + 1 > MAX_DISPATCH_TABLE_SPAN)
+    return false;
+
+  if (low < base) {
+    slots.insert(slots.begin(), base - low, nullptr);
+
+    base = low;
+  }
+
+  slots.resize(std::max<size_t>(slots.size(), id - base + 1), nullptr);
+  slots[id - base] = &capability;
+
+  return true;
+}
+
+void CapabilityRegistry::reset_all() const {
+  for (const auto capability : slots) {
+    if (capability) {
+      capability->reset();
+    }
+  }
 }
 
 data_callbacks_t::iterator
@@ -167,25 +361,75 @@ SerialCommunicator::find_data_callback(const uint16_t type,
 }
 
 void SerialCommunicator::add_data_callback(const uint16_t type,
-                                           DataCallback &&callback,
+                                           DataViewCallback &&callback,
                                            data_callbacks_t &callbacks) {
   const auto it = find_data_callback(type, callbacks);
 
   if (it != callbacks.end()) {
     // Replace existing
-    it->second = callback;
+    it->second = std::move(callback);
 
     return;
   }
 
-  callbacks.emplace_back(type, std::move(callback));
+  callbacks.emplace(std::ranges::upper_bound(callbacks, type, {},
+                                             &data_callback_pair_t::first),
+                    type, std::move(callback));
+}
+
+DataViewCallback SerialCommunicator::into_owning(DataCallback &&callback) {
+  return [callback = std::move(callback)](pcomm::bytes::Decoder &decoder) {
+    std::vector<uint8_t> data(decoder.remaining());
 
-  std::ranges::sort(callbacks, {}, &data_callback_pair_t::first);
+    decoder.pop_bytes(data.data(), data.size());
+
+    callback(std::move(data));
+  };
+}
+
+void SerialCommunicator::dispatch_data_callback(
+    const pcomm::packets::Packet &packet, data_callbacks_t &callbacks,
+    const DataHandlerTable static_handlers) {
+  const auto &payload = packet.payload;
+
+  if (payload.size() < 2) {
+    // Malformed packet
+    return;
+  }
+
+  pcomm::bytes::Decoder decoder{payload.data(), payload.size()};
+
+  const auto code = decoder.pop_number<uint16_t>();
+
+  if (const auto handler = static_handlers.find(code)) {
+    latency::handler_entered();
+
+    handler(decoder);
+
+    latency::handler_finished();
+
+    return;
+  }
+
+  const auto it = find_data_callback(code, callbacks);
+
+  if (it == callbacks.end()) {
+    // No callback registered for this code
+    return;
+  }
+
+  latency::handler_entered();
+
+  it->second(decoder);
+
+  latency::handler_finished();
 }
 
 std::optional<ReservedErrorCode> SerialCommunicator::process_host_hello(
     const pcomm::packets::Packet &packet) const {
-  auto &payload = packet.payload;
+  host_capabilities.reset_all();
+
+  const auto &payload = packet.payload;
 
   if (payload.size() < 3) {
     return ReservedErrorCode::MalformedPacket;
@@ -201,43 +445,43 @@ std::optional<ReservedErrorCode> SerialCommunicator::process_host_hello(
 
   const uint8_t capabilities_count = decoder.pop_byte();
 
-  if (payload.size() < capabilities_count * (2 + 2)) {
-    return ReservedErrorCode::MalformedPacket;
-  }
+  // Each capability gets a decoder over its own slice of the payload, so
+  // nothing is copied and no capability can read into the next one
+  size_t offset = 2 + 1;
 
   for (size_t i = 0; i < capabilities_count; ++i) {
-    const auto cap_id = decoder.pop_number<uint16_t>();
-    const auto cap_size = decoder.pop_number<uint16_t>();
-
-    if (payload.size() < cap_size) {
+    if (payload.size() - offset < 2 + 2) {
       return ReservedErrorCode::MalformedPacket;
     }
 
-    std::vector<uint8_t> cap_data(cap_size);
+    pcomm::bytes::Decoder header(payload.data() + offset, 2 + 2);
 
-    decoder.pop_bytes(cap_data.data(), cap_size);
+    const auto cap_id = header.pop_number<uint16_t>();
+    const auto cap_size = header.pop_number<uint16_t>();
 
-    const auto cap_it = std::ranges::find_if(
-        host_capabilities,
-        [=](const std::reference_wrapper<ICapability> &cap) {
-          return cap.get().id() == cap_id;
-        });
+    offset += 2 + 2;
 
-    if (cap_it == host_capabilities.cend()) {
-      return ReservedErrorCode::MissingCapabilities;
+    if (payload.size() - offset < cap_size) {
+      return ReservedErrorCode::MalformedPacket;
     }
 
-    auto &cap = cap_it->get();
+    const auto cap = host_capabilities.find(cap_id);
 
-    if (cap.min_size() > cap_size) {
+    if (!cap) {
+      return ReservedErrorCode::MissingCapabilities;
+    }
+
+    if (cap->min_size() > cap_size) {
       return ReservedErrorCode::MalformedPacket;
     }
 
-    pcomm::bytes::Decoder cap_decoder(cap_data.data(), cap_size);
+    pcomm::bytes::Decoder cap_decoder(payload.data() + offset, cap_size);
 
-    if (!cap.deserialize(cap_decoder)) {
+    if (!cap->deserialize(cap_decoder)) {
       return ReservedErrorCode::MalformedPacket;
     }
+
+    offset += cap_size;
   }
 
   return std::nullopt;
@@ -246,6 +490,8 @@ std::optional<ReservedErrorCode> SerialCommunicator::process_host_hello(
 void SerialCommunicator::send_device_hello() {
   std::vector<uint8_t> payload;
 
+  payload.reserve(device_hello_size);
+
   const pcomm::bytes::Encoder encoder(payload);
 
   const auto device_id = device_id::get();
@@ -256,17 +502,23 @@ void SerialCommunicator::send_device_hello() {
   for (const auto device_capability : device_capabilities) {
     const auto &cap = device_capability.get();
 
-    std::vector<uint8_t> cap_payload;
+    encoder.push_number(cap.id());
 
-    const pcomm::bytes::Encoder cap_encoder(cap_payload);
+    // Serialized in place behind a size placeholder that is patched after
+    const auto size_at = payload.size();
 
-    cap.serialize(cap_encoder);
+    encoder.push_number(static_cast<uint16_t>(0));
 
-    encoder.push_number(cap.id());
-    encoder.push_number(static_cast<uint16_t>(cap_payload.size()));
-    encoder.push_bytes(cap_payload.data(), cap_payload.size());
+    cap.serialize(encoder);
+
+    const auto size = static_cast<uint16_t>(payload.size() - size_at - 2);
+
+    payload[size_at] = static_cast<uint8_t>(size);
+    payload[size_at + 1] = static_cast<uint8_t>(size >> 8);
   }
 
+  device_hello_size = payload.size();
+
   send(pcomm::packets::Packet(static_cast<uint16_t>(PacketType::DeviceHello),
                               std::move(payload)));
 }
@@ -274,11 +526,24 @@ void SerialCommunicator::send_device_hello() {
 bool SerialCommunicator::process_handshake(
     const PacketType type, const pcomm::packets::Packet &packet) {
   if (current_handshake_stage == HandshakeStage::None) {
+    if (type == PacketType::SessionResume)
+      return process_session_resume(packet);
+
     if (type != PacketType::HostHello)
       return true; // Ignore non-handshake packets while not connected
 
     send_debug("Host hello received");
 
+    // A new session replaces the one kept for resuming
+    if (session_resume && session_resume->suspended()) {
+      session_resume->discard();
+
+      end_session();
+    }
+
+    // Whatever the previous host negotiated, this one may not accept it
+    writer.set_chunk_size(FrameWriter::DEFAULT_CHUNK_SIZE);
+
     if (const auto error = process_host_hello(packet)) {
       send_error(static_cast<uint16_t>(error.value()));
 
@@ -308,8 +573,61 @@ bool SerialCommunicator::process_handshake(
 
     current_handshake_stage = HandshakeStage::Completed;
 
+    begin_session();
+
     return true;
   }
 
   return true;
 }
+
+// version(2) token(8) -> token(8)
+bool SerialCommunicator::process_session_resume(
+    const pcomm::packets::Packet &packet) {
+  const auto &payload = packet.payload;
+
+  if (payload.size() < 2 + 8) {
+    send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+
+    return false;
+  }
+
+  pcomm::bytes::Decoder decoder(payload.data(), payload.size());
+
+  if (decoder.pop_number<uint16_t>() != VERSION) {
+    send_error(
+        static_cast<uint16_t>(ReservedErrorCode::UnsupportedProtocolVersion));
+
+    return false;
+  }
+
+  const auto token = decoder.pop_number<uint64_t>();
+
+  if (!session_resume || !session_resume->resume(token, time_us_64())) {
+    // Not a handshake failure; the host falls back to HostHello
+    send_error(static_cast<uint16_t>(ReservedErrorCode::SessionExpired));
+
+    return true;
+  }
+
+  send_debug("Session resumed");
+
+  current_handshake_stage = HandshakeStage::Completed;
+
+  begin_session();
+
+  send(pcomm::packets::Packet(static_cast<uint16_t>(PacketType::SessionResumed),
+                              {payload.begin() + 2, payload.begin() + 10}));
+
+  return true;
+}
+
+void SerialCommunicator::begin_session() {
+  if (flow_control) {
+    flow_control->begin();
+  }
+
+  if (chunk_mtu) {
+    writer.set_chunk_size(chunk_mtu->chunk_size());
+  }
+}
@@ -1,16 +1,43 @@
 #pragma once
 
 #include <functional>
+#include <optional>
 
 #include <pcomm/pcomm.h>
 
+#include "DispatchTable.h"
+#include "FrameWriter.h"
+#include "InplaceFunction.h"
+
 enum class DataTypes : uint16_t {
   CommandDataGetImmediate = 0x0090,
   CommandDataGetLoopOff = 0x0092,
   CommandDataGetLoopOn = 0x0093,
+  CommandDataStreamOn = 0x0094,
+  CommandFilterSelect = 0x0095,
+  CommandRawStream = 0x0096,
+  CommandDiagnostics = 0x0097,
+  CommandPing = 0x0098,
+  CommandTimeSync = 0x0099,
+  CommandPcmStream = 0x009a,
+  CommandPcmData = 0x009b,
+  CommandPcmStatus = 0x009c,
+  CommandToneSequence = 0x009d,
+  CommandToneSequenceControl = 0x009e,
+  CommandLedAnimation = 0x009f,
+  CommandSchema = 0x00a0,
   CommandDataSet = 0x00e0,
 
   ResponseDataSend = 0x00f0,
+  ResponseDataStream = 0x00f1,
+  ResponseDataDelta = 0x00f2,
+  ResponseDataStreamDelta = 0x00f3,
+  ResponseRawStream = 0x00f4,
+  ResponseDiagnostics = 0x00f5,
+  ResponsePong = 0x00f6,
+  ResponseTimeSync = 0x00f7,
+  ResponsePcmStatus = 0x00f8,
+  ResponseSchema = 0x00f9,
 };
 
 enum class PacketType : uint16_t {
@@ -19,6 +46,24 @@ enum class PacketType : uint16_t {
   HostAck = 0x0003,
   Data = 0x0004,
   Error = 0x0005,
+  // 0x0006 is the host's DebugEcho
+  CompressedData = 0x0007,
+  SessionResume = 0x0008,
+  SessionResumed = 0x0009,
+  CreditUpdate = 0x000A,
+};
+
+enum class CompressionCodec : uint8_t {
+  None = 0x00,
+  Lz = 0x01,
+  Adc12Delta = 0x02,
+};
+
+// How a Data body should be compressed if the host negotiated compression.
+// verbatim_prefix is only used by Adc12Delta.
+struct CompressionHint {
+  CompressionCodec codec = CompressionCodec::Lz;
+  uint16_t verbatim_prefix = 0;
 };
 
 enum class ReservedErrorCode : uint16_t {
@@ -27,9 +72,23 @@ enum class ReservedErrorCode : uint16_t {
   UnsupportedProtocolVersion = 0x0003,
   MissingCapabilities = 0x0004,
   HandshakeNotCompleted = 0x0005,
+  SessionExpired = 0x0006,
   InternalError = 0x00FF,
 };
 
+// Counters for received packets. Malformed and unknown packets are counted
+// as the matching error goes back to the host, whoever sends it.
+struct RxStats {
+  uint32_t packets = 0;
+  uint32_t malformed_packets = 0;
+  uint32_t unknown_packets = 0;
+};
+
+class ChunkMtuCapability;
+class Compressor;
+class FlowControl;
+class SessionResume;
+
 class ISerializable {
 public:
   virtual ~ISerializable() = default;
@@ -42,11 +101,6 @@ public:
   virtual ~IDeserializable() = default;
 
   virtual bool deserialize(pcomm::bytes::Decoder &decoder) = 0;
-
-  virtual bool deserialize(pcomm::bytes::Decoder &decoder) volatile {
-    // Default implementation for volatile objects
-    return const_cast<IDeserializable *>(this)->deserialize(decoder);
-  }
 };
 
 class ICapability : public ISerializable, public IDeserializable {
@@ -54,17 +108,54 @@ public:
   [[nodiscard]] virtual uint16_t id() const = 0;
 
   [[nodiscard]] virtual uint16_t min_size() const = 0;
+
+  // Called for every host capability before a HostHello is parsed, so state
+  // negotiated in a previous session does not leak into the next one.
+  virtual void reset() {}
 };
 
+// Host capabilities in a table indexed by `id - base`, the runtime
+// counterpart of DispatchView: finding the capability a HostHello entry
+// names costs the same however many are registered.
+class CapabilityRegistry {
+public:
+  // Fails for an id that is already taken or would stretch the table past
+  // MAX_DISPATCH_TABLE_SPAN.
+  [[nodiscard]] bool add(ICapability &capability);
+
+  [[nodiscard]] ICapability *find(const uint16_t id) const {
+    const auto index = static_cast<uint16_t>(id - base);
+
+    return index < slots.size() ? slots[index] : nullptr;
+  }
+
+  void reset_all() const;
+
+private:
+  uint16_t base = 0;
+  std::vector<ICapability *> slots;
+};
+
+// Receives a decoder positioned right after the data/error code. The decoder
+// views the packet buffer and is only valid for the duration of the call.
+using DataViewCallback = InplaceFunction<void(pcomm::bytes::Decoder &decoder)>;
+
+// Receives an owned copy of the payload following the data/error code.
 using DataCallback = std::function<void(std::vector<uint8_t> data)>;
 
-using data_callback_pair_t = std::pair<uint16_t, DataCallback>;
+using data_callback_pair_t = std::pair<uint16_t, DataViewCallback>;
 using data_callbacks_t = std::vector<data_callback_pair_t>;
 
+// Handler for codes known at compile time, see StaticDispatchTable.
+using DataHandler = void (*)(pcomm::bytes::Decoder &decoder);
+using DataHandlerTable = DispatchView<DataHandler>;
+
 class SerialCommunicator final : public pcomm::socket::SerialUSBSocket {
 public:
   static constexpr uint16_t VERSION = 410;
 
+  SerialCommunicator();
+
   [[nodiscard]] bool is_connected() const {
     return current_handshake_stage == HandshakeStage::Completed;
   }
@@ -75,21 +166,78 @@ public:
 
   // Handshake
 
-  void add_capability(ICapability &host_cap, const ICapability &device_cap) {
-    host_capabilities.push_back(std::ref(host_cap));
+  // Fails, registering neither, if the host capability's id cannot be
+  // added, see CapabilityRegistry::add.
+  [[nodiscard]] bool add_capability(ICapability &host_cap,
+                                    const ICapability &device_cap) {
+    if (!host_capabilities.add(host_cap))
+      return false;
+
     device_capabilities.push_back(std::cref(device_cap));
+
+    return true;
   }
 
+  // Called whenever the link drops, whether or not the session survives.
   void on_disconnect(std::function<void()> &&fn) {
     disconnect_callback = std::move(fn);
   }
 
+  // Called once a session is over for good: when the link drops without a
+  // resumable session, when a kept session runs out of grace, or when a
+  // host starts a new one with HostHello instead.
+  void on_session_end(std::function<void()> &&fn) {
+    session_end_callback = std::move(fn);
+  }
+
+  // Sessions can only be resumed once this is set and the host negotiated
+  // its capability.
+  void set_session_resume(SessionResume &session) {
+    session_resume = &session;
+  }
+
+  // Ends a dropped session whose grace window has passed; call it while
+  // not connected.
+  void poll_session();
+
+  // Flow control only takes effect once its capability is negotiated.
+  void set_flow_control(FlowControl &control) { flow_control = &control; }
+
+  // Frames sent after the handshake use the negotiated chunk size.
+  void set_chunk_mtu(const ChunkMtuCapability &capability) {
+    chunk_mtu = &capability;
+  }
+
+  // Chunk checksums are computed by SoftwareCrcCopy unless replaced here.
+  void set_crc_copy(ICrcCopy &engine) { writer.set_crc_copy(engine); }
+
+  // Large Data bodies are sent as CompressedData once the host negotiated
+  // compression.
+  void set_compressor(Compressor &instance) { compressor = &instance; }
+
+  // Whether a Data frame sent now would go out rather than be refused for
+  // lack of credit.
+  [[nodiscard]] bool can_send() const;
+
+  // Hands drained receive credits back to the host; call once per loop.
+  void return_credits();
+
   // Receiving
 
-  void subscribe_data(const uint16_t code, DataCallback &&callback) {
+  // Codes in the static table are looked up before any runtime subscription
+  // and cannot be unsubscribed.
+  void set_static_data_handlers(const DataHandlerTable table) {
+    static_data_handlers = table;
+  }
+
+  void subscribe_data_view(const uint16_t code, DataViewCallback &&callback) {
     add_data_callback(code, std::move(callback), data_callbacks);
   }
 
+  void subscribe_data(const uint16_t code, DataCallback &&callback) {
+    subscribe_data_view(code, into_owning(std::move(callback)));
+  }
+
   void unsubscribe_data(const uint16_t code) {
     const auto it = find_data_callback(code, data_callbacks);
 
@@ -98,10 +246,15 @@ public:
     }
   }
 
-  void subscribe_error(const uint16_t code, DataCallback &&callback) {
+  void subscribe_error_view(const uint16_t code,
+                            DataViewCallback &&callback) {
     add_data_callback(code, std::move(callback), error_callbacks);
   }
 
+  void subscribe_error(const uint16_t code, DataCallback &&callback) {
+    subscribe_error_view(code, into_owning(std::move(callback)));
+  }
+
   void unsubscribe_error(const uint16_t code) {
     const auto it = find_data_callback(code, error_callbacks);
 
@@ -114,13 +267,46 @@ public:
 
   void send_data(uint16_t code, const std::vector<uint8_t> &data_payload = {});
 
-  void send_data(uint16_t code, const ISerializable &data);
+  void send_data(uint16_t code, const ISerializable &data,
+                 CompressionHint hint = {},
+                 TxPriority priority = TxPriority::Interactive);
+
+  // Sends an already encoded body as is, without copying it into the frame
+  // buffer first.
+  void send_data(uint16_t code, TxSegment body, CompressionHint hint = {},
+                 TxPriority priority = TxPriority::Interactive);
+
+  // Encodes a Message on the stack and sends it without a virtual call or a
+  // copy into the frame buffer.
+  template <typename M>
+  void send_message(const typename M::Owner &value,
+                    const CompressionHint hint = {},
+                    const TxPriority priority = TxPriority::Interactive) {
+    const auto bytes = M::encode(value);
+
+    send_data(M::CODE, TxSegment{bytes.data(), bytes.size()}, hint, priority);
+  }
 
   void send_error(uint16_t code,
                   const std::vector<uint8_t> &error_payload = {});
 
   void send_error(uint16_t code, const ISerializable &data);
 
+  // Writes the queued chunks the USB buffer has room for; call once per
+  // loop. Errors and credit updates are sent as TxPriority::Control.
+  void pump_tx() { writer.pump(); }
+
+  // Whether frames of this class are still waiting for the USB buffer
+  [[nodiscard]] bool tx_pending(const TxPriority priority) const {
+    return writer.pending(priority);
+  }
+
+  // Counters for the data/error TX path. heap_allocations stays at zero as
+  // long as every body fits into the preallocated frame buffer.
+  [[nodiscard]] const TxStats &tx_stats() const { return writer.stats(); }
+
+  [[nodiscard]] const RxStats &rx_stats() const { return receive_stats; }
+
 private:
   enum class HandshakeStage {
     None,
@@ -130,24 +316,75 @@ private:
   };
 
   HandshakeStage current_handshake_stage = HandshakeStage::None;
-  std::vector<std::reference_wrapper<ICapability>> host_capabilities;
+  RxStats receive_stats;
+  CapabilityRegistry host_capabilities;
   std::vector<std::reference_wrapper<const ICapability>> device_capabilities;
+  // Size of the last DeviceHello, reserved up front for the next one
+  size_t device_hello_size = 0;
 
   std::function<void()> disconnect_callback;
+  std::function<void()> session_end_callback;
+
+  FlowControl *flow_control = nullptr;
+  const ChunkMtuCapability *chunk_mtu = nullptr;
+  Compressor *compressor = nullptr;
+  SessionResume *session_resume = nullptr;
+
+  FrameWriter writer;
+  std::vector<uint8_t> tx_body;
 
+  DataHandlerTable static_data_handlers;
   data_callbacks_t data_callbacks;
   data_callbacks_t error_callbacks;
 
   static data_callbacks_t::iterator
   find_data_callback(uint16_t type, data_callbacks_t &callbacks);
 
-  static void add_data_callback(uint16_t type, DataCallback &&callback,
+  static void add_data_callback(uint16_t type, DataViewCallback &&callback,
                                 data_callbacks_t &callbacks);
 
+  static DataViewCallback into_owning(DataCallback &&callback);
+
+  static void
+  dispatch_data_callback(const pcomm::packets::Packet &packet,
+                         data_callbacks_t &callbacks,
+                         DataHandlerTable static_handlers = {});
+
+  void receive(const pcomm::packets::Packet &packet, uint64_t received_at_us);
+
+  // Ping and time sync are answered straight from on_recv so their replies
+  // never wait behind a data handler. Returns false for every other code.
+  bool answer_fast_path(const pcomm::packets::Packet &packet,
+                        uint64_t received_at_us);
+
+  void send_time_sync(const pcomm::packets::Packet &packet,
+                      uint64_t received_at_us);
+
+  void count_error(uint16_t code);
+
+  // Charges a flow control credit for a Data frame.
+  bool take_tx_credit();
+
+  void send_frame(PacketType type, uint16_t code, const uint8_t *body,
+                  size_t size,
+                  CompressionHint hint = {CompressionCodec::None},
+                  TxPriority priority = TxPriority::Interactive);
+
+  void send_frame(PacketType type, uint16_t code, const ISerializable &body,
+                  CompressionHint hint = {CompressionCodec::None},
+                  TxPriority priority = TxPriority::Interactive);
+
   [[nodiscard]] std::optional<ReservedErrorCode>
   process_host_hello(const pcomm::packets::Packet &packet) const;
 
   void send_device_hello();
 
+  bool process_session_resume(const pcomm::packets::Packet &packet);
+
+  // Starts the negotiated features, after HostAck or a resume.
+  void begin_session();
+
+  void end_session();
+
   bool process_handshake(PacketType type, const pcomm::packets::Packet &packet);
 };
@@ -0,0 +1,57 @@
+#include "SessionResume.h"
+
+#include "constants.h"
+
+#include <pico/rand.h>
+
+namespace {
+
+constexpr uint64_t US_PER_MS = 1000;
+
+} // namespace
+
+void SessionResumeCapability::serialize(
+    const pcomm::bytes::Encoder &encoder) const {
+  encoder.push_number(issued_token);
+  encoder.push_number(SESSION_GRACE_MS);
+}
+
+bool SessionResumeCapability::deserialize(pcomm::bytes::Decoder &) {
+  // 0 is never issued, so a host can always tell "no token" apart
+  do {
+    issued_token = get_rand_64();
+  } while (issued_token == 0);
+
+  negotiated = true;
+
+  return true;
+}
+
+void SessionResumeCapability::reset() {
+  negotiated = false;
+  issued_token = 0;
+}
+
+void SessionResume::suspend(const uint64_t now_us) {
+  kept = config.enabled();
+  token = config.token();
+  deadline_us = now_us + SESSION_GRACE_MS * US_PER_MS;
+}
+
+bool SessionResume::resume(const uint64_t candidate, const uint64_t now_us) {
+  if (!kept || candidate != token || now_us >= deadline_us)
+    return false;
+
+  kept = false;
+
+  return true;
+}
+
+bool SessionResume::expire(const uint64_t now_us) {
+  if (!kept || now_us < deadline_us)
+    return false;
+
+  kept = false;
+
+  return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+#include "SerialCommunicator.h"
+
+// Lets a host pick a session back up after the USB link drops, without a new
+// HostHello and without the device resetting its streaming modes and
+// actuators. The host opts in by sending this capability, with an empty
+// body, in HostHello. The device answers with the session's token and how
+// long it keeps a dropped session:
+//   token(8) grace_ms(4)
+// To resume, the host sends a SessionResume packet instead of HostHello:
+//   version(2) token(8)
+// and gets SessionResumed with the same token back, or a SessionExpired
+// error after which it starts over with HostHello. Everything negotiated in
+// the original HostHello stays in effect; flow control credits start over
+// as they do after HostAck.
+class SessionResumeCapability final : public ICapability {
+public:
+  static constexpr uint16_t ID = 0x0045;
+
+  [[nodiscard]] uint16_t id() const override { return ID; }
+
+  [[nodiscard]] uint16_t min_size() const override { return 0; }
+
+  void serialize(const pcomm::bytes::Encoder &encoder) const override;
+
+  bool deserialize(pcomm::bytes::Decoder &decoder) override;
+
+  void reset() override;
+
+  [[nodiscard]] bool enabled() const { return negotiated; }
+
+  [[nodiscard]] uint64_t token() const { return issued_token; }
+
+private:
+  bool negotiated = false;
+  uint64_t issued_token = 0;
+};
+
+// Keeps a dropped session for SESSION_GRACE_MS. SerialCommunicator drives
+// it; the application learns that a session is really over through
+// SerialCommunicator::on_session_end.
+class SessionResume {
+public:
+  explicit SessionResume(const SessionResumeCapability &config)
+      : config(config) {}
+
+  // The link dropped with a session up; keeps it if the host opted in.
+  void suspend(uint64_t now_us);
+
+  // Whether `token` names the kept session and it is still within its
+  // grace window. The session is no longer kept either way if it matched.
+  bool resume(uint64_t token, uint64_t now_us);
+
+  // Whether the kept session just ran out of grace; it is dropped.
+  bool expire(uint64_t now_us);
+
+  void discard() { kept = false; }
+
+  [[nodiscard]] bool suspended() const { return kept; }
+
+private:
+  const SessionResumeCapability &config;
+
+  bool kept = false;
+  uint64_t token = 0;
+  uint64_t deadline_us = 0;
+};
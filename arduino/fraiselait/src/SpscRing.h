@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded single-producer/single-consumer queue. The producer only writes
+// `head` and the consumer only writes `tail`, so no compare-and-swap is
+// needed and it is safe between an interrupt and thread context as well as
+// between the two cores.
+template <typename T, size_t Capacity> class SpscRing {
+  static_assert(std::has_single_bit(Capacity),
+                "Capacity must be a power of two");
+
+public:
+  // Producer side
+  bool try_push(const T &value) {
+    const auto head = head_index.load(std::memory_order_relaxed);
+
+    if (head - tail_index.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+
+    slots[head & (Capacity - 1)] = value;
+
+    head_index.store(head + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // Producer side; in-place alternative to try_push for large elements.
+  // Returns the next free slot, which becomes visible on publish().
+  T *try_reserve() {
+    const auto head = head_index.load(std::memory_order_relaxed);
+
+    if (head - tail_index.load(std::memory_order_acquire) == Capacity) {
+      return nullptr;
+    }
+
+    return &slots[head & (Capacity - 1)];
+  }
+
+  void publish() {
+    head_index.store(head_index.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+  }
+
+  // Consumer side; in-place alternative to try_pop. The element stays valid
+  // until pop().
+  const T *front() const {
+    const auto tail = tail_index.load(std::memory_order_relaxed);
+
+    if (tail == head_index.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+
+    return &slots[tail & (Capacity - 1)];
+  }
+
+  void pop() {
+    tail_index.store(tail_index.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+  }
+
+  // Consumer side
+  bool try_pop(T &out) {
+    const auto tail = tail_index.load(std::memory_order_relaxed);
+
+    if (tail == head_index.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    out = slots[tail & (Capacity - 1)];
+
+    tail_index.store(tail + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // Consumer side; drops everything currently queued.
+  void clear() {
+    tail_index.store(head_index.load(std::memory_order_acquire),
+                     std::memory_order_release);
+  }
+
+  [[nodiscard]] size_t size() const {
+    return head_index.load(std::memory_order_acquire) -
+           tail_index.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+private:
+  std::array<T, Capacity> slots{};
+
+  std::atomic<uint32_t> head_index{0};
+  std::atomic<uint32_t> tail_index{0};
+};
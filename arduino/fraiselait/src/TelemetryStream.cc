@@ -0,0 +1,96 @@
+#include "TelemetryStream.h"
+
+#include <Arduino.h>
+
+void TelemetryBlock::serialize(const pcomm::bytes::Encoder &encoder) const {
+  const auto base_timestamp_us = count > 0 ? samples[0].timestamp_us : 0;
+
+  encoder.push_number(sequence);
+  encoder.push_number(dropped_samples);
+  encoder.push_number(base_timestamp_us);
+  encoder.push_number(count);
+
+  for (uint8_t i = 0; i < count; ++i) {
+    encoder.push_number(
+        static_cast<uint32_t>(samples[i].timestamp_us - base_timestamp_us));
+
+    if (delta) {
+      DeltaEncoder::serialize(masks[i], samples[i].data, encoder);
+    } else {
+      DeviceDataMessage::encode(samples[i].data, encoder);
+    }
+  }
+}
+
+bool TelemetryStream::start(const uint32_t period_us,
+                            const uint8_t batch_size) {
+  if (period_us < MIN_STREAM_PERIOD_US || batch_size == 0 ||
+      batch_size > MAX_STREAM_BATCH) {
+    return false;
+  }
+
+  stop();
+
+  this->batch_size = batch_size;
+  sequence = 0;
+  dropped_samples = 0;
+
+  samples.clear();
+
+  // Negative delay: the period is measured between callback starts, so the
+  // cadence does not drift with the callback's own run time
+  running = add_repeating_timer_us(-static_cast<int64_t>(period_us), on_timer,
+                                   this, &timer);
+
+  return running;
+}
+
+void TelemetryStream::stop() {
+  if (!running)
+    return;
+
+  cancel_repeating_timer(&timer);
+
+  running = false;
+}
+
+bool TelemetryStream::take_batch(TelemetryBlock &block, DeltaEncoder *delta) {
+  if (!batch_ready())
+    return false;
+
+  block.dropped_samples = dropped_samples;
+  block.delta = delta != nullptr;
+  block.count = 0;
+
+  TimestampedSample sample;
+
+  for (uint8_t taken = 0; taken < batch_size && samples.try_pop(sample);
+       ++taken) {
+    const auto mask =
+        delta ? delta->next_mask(sample.data) : DeltaEncoder::FIELDS_ALL;
+
+    if (mask == 0)
+      continue;
+
+    block.samples[block.count] = sample;
+    block.masks[block.count] = mask;
+    block.count++;
+  }
+
+  if (block.count == 0)
+    return false;
+
+  block.sequence = sequence++;
+
+  return true;
+}
+
+bool TelemetryStream::on_timer(repeating_timer_t *rt) {
+  auto &self = *static_cast<TelemetryStream *>(rt->user_data);
+
+  if (!self.samples.try_push({time_us_64(), self.sampler()})) {
+    self.dropped_samples = self.dropped_samples + 1;
+  }
+
+  return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <pico/time.h>
+
+#include "DeltaTelemetry.h"
+#include "DeviceData.h"
+#include "SpscRing.h"
+#include "constants.h"
+
+struct TimestampedSample {
+  uint64_t timestamp_us = 0;
+  DeviceData data;
+};
+
+// Payload of ResponseDataStream:
+//   sequence(4) dropped_samples(4) base_timestamp_us(8) count(1)
+//   count * [offset_us(4) DeviceData]
+// offset_us is relative to base_timestamp_us (the first sample).
+// ResponseDataStreamDelta uses the same layout with each DeviceData replaced
+// by its DeltaEncoder form; samples with nothing to send are left out.
+struct TelemetryBlock final : ISerializable {
+  uint32_t sequence = 0;
+  uint32_t dropped_samples = 0;
+  bool delta = false;
+  uint8_t count = 0;
+  std::array<TimestampedSample, MAX_STREAM_BATCH> samples{};
+  std::array<uint8_t, MAX_STREAM_BATCH> masks{};
+
+  void serialize(const pcomm::bytes::Encoder &encoder) const override;
+};
+
+// Samples DeviceData from a hardware-timer interrupt at a fixed period and
+// hands it to the main loop in batches.
+class TelemetryStream {
+public:
+  using Sampler = DeviceData (*)();
+
+  explicit TelemetryStream(const Sampler sampler) : sampler(sampler) {}
+
+  bool start(uint32_t period_us, uint8_t batch_size);
+
+  void stop();
+
+  [[nodiscard]] bool active() const { return running; }
+
+  [[nodiscard]] bool batch_ready() const {
+    return running && samples.size() >= batch_size;
+  }
+
+  // Moves the next batch_size samples into block. With a delta encoder,
+  // unchanged samples are skipped and false is returned if none is left.
+  bool take_batch(TelemetryBlock &block, DeltaEncoder *delta = nullptr);
+
+private:
+  Sampler sampler;
+
+  repeating_timer_t timer{};
+  bool running = false;
+  uint8_t batch_size = 1;
+
+  uint32_t sequence = 0;
+  volatile uint32_t dropped_samples = 0;
+
+  SpscRing<TimestampedSample, STREAM_BUFFER_SAMPLES> samples;
+
+  static bool on_timer(repeating_timer_t *rt);
+};
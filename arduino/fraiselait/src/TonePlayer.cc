@@ -0,0 +1,106 @@
+#include "TonePlayer.h"
+
+#include "InterruptLock.h"
+
+namespace {
+
+constexpr int64_t US_PER_MS = 1000;
+
+} // namespace
+
+void TonePlayer::load(const ToneSequence &next) {
+  InterruptLock lock;
+
+  cancel();
+
+  sequence = next;
+}
+
+void TonePlayer::play(const bool loop) {
+  if (!pool)
+    return;
+
+  InterruptLock lock;
+
+  cancel();
+
+  if (sequence.count == 0)
+    return;
+
+  index = 0;
+  phase = Phase::NoteOn;
+  looping = loop;
+
+  // The first note starts here; every later boundary is relative to it
+  alarm = alarm_pool_add_alarm_in_us(pool, advance(), on_alarm, this, true);
+
+  if (alarm < 0) {
+    alarm = 0;
+  }
+}
+
+void TonePlayer::stop() {
+  InterruptLock lock;
+
+  cancel();
+}
+
+void TonePlayer::cancel() {
+  if (alarm <= 0)
+    return;
+
+  alarm_pool_cancel_alarm(pool, alarm);
+
+  alarm = 0;
+
+  output(nullptr);
+}
+
+// Applies the current boundary and returns the time to the next one in
+// microseconds, or 0 once the sequence is over.
+int64_t TonePlayer::advance() {
+  const auto &step = sequence.steps[index];
+
+  if (phase == Phase::NoteOn) {
+    output(step.frequency_dhz == 0 ? nullptr : &step);
+
+    phase = Phase::NoteOff;
+
+    return step.duration_ms * US_PER_MS;
+  }
+
+  phase = Phase::NoteOn;
+
+  const auto last = index + 1 == sequence.count;
+
+  if (last && !looping) {
+    output(nullptr);
+
+    return 0;
+  }
+
+  index = last ? 0 : index + 1;
+
+  // Without a gap the next note starts on this very boundary
+  if (step.gap_ms == 0)
+    return advance();
+
+  output(nullptr);
+
+  return step.gap_ms * US_PER_MS;
+}
+
+int64_t TonePlayer::on_alarm(alarm_id_t, void *user_data) {
+  auto &self = *static_cast<TonePlayer *>(user_data);
+
+  const auto delay = self.advance();
+
+  if (delay == 0) {
+    self.alarm = 0;
+
+    return 0;
+  }
+
+  // Negative: relative to the time this alarm was scheduled for
+  return -delay;
+}
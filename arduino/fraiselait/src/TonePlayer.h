@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <pico/time.h>
+
+#include "ToneSequence.h"
+
+// Plays a ToneSequence from an alarm; call it from the core its alarm pool
+// belongs to. Every note boundary is scheduled relative to the previous
+// boundary's target time rather than to when the callback actually ran, so
+// callback latency never accumulates over a song or across loops.
+class TonePlayer {
+public:
+  // Starts a step, or silences the speaker for nullptr.
+  using Output = void (*)(const ToneStep *step);
+
+  explicit TonePlayer(const Output output) : output(output) {}
+
+  // Alarms go to `alarm_pool`, whose callbacks run on the core that
+  // created it.
+  void begin(alarm_pool_t *alarm_pool) { pool = alarm_pool; }
+
+  // Replaces the sequence, stopping playback.
+  void load(const ToneSequence &next);
+
+  // Plays the loaded sequence from its first step.
+  void play(bool loop);
+
+  void stop();
+
+private:
+  enum class Phase : uint8_t {
+    NoteOn,
+    NoteOff,
+  };
+
+  Output output;
+
+  alarm_pool_t *pool = nullptr;
+  alarm_id_t alarm = 0;
+
+  ToneSequence sequence;
+  size_t index = 0;
+  Phase phase = Phase::NoteOn;
+  bool looping = false;
+
+  // Both expect interrupts to be disabled.
+  void cancel();
+  int64_t advance();
+
+  static int64_t on_alarm(alarm_id_t id, void *user_data);
+};
@@ -0,0 +1,33 @@
+#include "ToneSequence.h"
+
+bool parse_tone_sequence(pcomm::bytes::Decoder &decoder,
+                         ToneSequence &sequence) {
+  if (decoder.remaining() < 1)
+    return false;
+
+  const auto count = decoder.pop_byte();
+
+  if (count == 0 || count > sequence.steps.size() ||
+      decoder.remaining() < count * ToneStep::SIZE) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    auto &step = sequence.steps[i];
+
+    step.frequency_dhz = decoder.pop_number<uint16_t>();
+    step.duration_ms = decoder.pop_number<uint16_t>();
+    step.gap_ms = decoder.pop_number<uint16_t>();
+    step.volume = decoder.pop_byte();
+    step.waveform = decoder.pop_byte();
+
+    if (step.duration_ms == 0 ||
+        step.waveform > static_cast<uint8_t>(WaveformType::Noise)) {
+      return false;
+    }
+  }
+
+  sequence.count = count;
+
+  return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "CoreCommand.h"
+#include "SerialCommunicator.h"
+#include "constants.h"
+
+// One note as uploaded by the host, kept in its wire form (little endian):
+//   frequency_dhz(2) duration_ms(2) gap_ms(2) volume(1) waveform(1)
+// A frequency of 0 is a rest. waveform is a WaveformType, 0 keeps the
+// current one.
+struct ToneStep {
+  static constexpr size_t SIZE = 2 + 2 + 2 + 1 + 1;
+
+  uint16_t frequency_dhz = 0;
+  uint16_t duration_ms = 0;
+  uint16_t gap_ms = 0;
+  uint8_t volume = 0;
+  uint8_t waveform = 0;
+
+  [[nodiscard]] float frequency() const { return frequency_dhz / 10.f; }
+
+  [[nodiscard]] float volume_level() const { return volume / 255.f; }
+};
+
+struct ToneSequence {
+  std::array<ToneStep, TONE_SEQUENCE_CAPACITY> steps{};
+  size_t count = 0;
+};
+
+// Decodes a CommandToneSequence body following its flags byte:
+//   count(1) count * ToneStep
+// Steps must have a non-zero duration and a known waveform.
+bool parse_tone_sequence(pcomm::bytes::Decoder &decoder,
+                         ToneSequence &sequence);
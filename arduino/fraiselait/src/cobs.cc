@@ -0,0 +1,31 @@
+#include "cobs.h"
+
+size_t cobs::encode(const uint8_t *data, const size_t size, uint8_t *out) {
+  size_t write_index = 1;
+  size_t code_index = 0;
+  uint8_t code = 1;
+
+  for (size_t read_index = 0; read_index < size; ++read_index) {
+    if (data[read_index] == 0) {
+      out[code_index] = code;
+      code_index = write_index++;
+      code = 1;
+
+      continue;
+    }
+
+    out[write_index++] = data[read_index];
+    code++;
+
+    if (code == 0xFF) {
+      out[code_index] = code;
+      code_index = write_index++;
+      code = 1;
+    }
+  }
+
+  out[code_index] = code;
+  out[write_index++] = 0;
+
+  return write_index;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cobs {
+
+// Worst-case size of an encoded block including the trailing delimiter.
+constexpr size_t max_encoded_size(const size_t size) {
+  return size + size / 254 + 2;
+}
+
+// Encodes `size` bytes into `out` and appends the 0x00 frame delimiter.
+// `out` must hold at least max_encoded_size(size) bytes. Returns the number
+// of bytes written.
+size_t encode(const uint8_t *data, size_t size, uint8_t *out);
+
+} // namespace cobs
@@ -0,0 +1,193 @@
+#include "codecs.h"
+
+#include "FrameWriter.h"
+
+#include <cstring>
+
+namespace compression {
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+
+uint32_t read32(const uint8_t *in) {
+  uint32_t value;
+
+  std::memcpy(&value, in, sizeof(value));
+
+  return value;
+}
+
+uint32_t hash(const uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Bounds-checked output cursor; `ok` turns false on the first overflow
+struct Output {
+  uint8_t *data;
+  size_t capacity;
+  size_t size = 0;
+  bool ok = true;
+
+  void put(const uint8_t byte) {
+    if (size >= capacity) {
+      ok = false;
+
+      return;
+    }
+
+    data[size++] = byte;
+  }
+
+  void put(const uint8_t *bytes, const size_t count) {
+    if (count > capacity - size) {
+      ok = false;
+
+      return;
+    }
+
+    std::memcpy(data + size, bytes, count);
+    size += count;
+  }
+
+  void put_length(size_t length) {
+    for (; length >= 255; length -= 255) {
+      put(255);
+    }
+
+    put(static_cast<uint8_t>(length));
+  }
+
+  void put_varint(uint32_t value) {
+    for (; value >= 0x80; value >>= 7) {
+      put(static_cast<uint8_t>(value | 0x80));
+    }
+
+    put(static_cast<uint8_t>(value));
+  }
+};
+
+void put_sequence(Output &out, const uint8_t *literals,
+                  const size_t literal_length, const size_t offset,
+                  const size_t match_length) {
+  const auto match_extra = match_length - MIN_MATCH;
+
+  out.put(static_cast<uint8_t>(
+      (literal_length < 15 ? literal_length : 15) << 4 |
+      (match_extra < 15 ? match_extra : 15)));
+
+  if (literal_length >= 15) {
+    out.put_length(literal_length - 15);
+  }
+
+  out.put(literals, literal_length);
+
+  out.put(static_cast<uint8_t>(offset));
+  out.put(static_cast<uint8_t>(offset >> 8));
+
+  if (match_extra >= 15) {
+    out.put_length(match_extra - 15);
+  }
+}
+
+void put_last_literals(Output &out, const uint8_t *literals,
+                       const size_t literal_length) {
+  out.put(static_cast<uint8_t>((literal_length < 15 ? literal_length : 15)
+                               << 4));
+
+  if (literal_length >= 15) {
+    out.put_length(literal_length - 15);
+  }
+
+  out.put(literals, literal_length);
+}
+
+uint32_t zigzag(const int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^
+         static_cast<uint32_t>(value >> 31);
+}
+
+} // namespace
+
+size_t lz_compress(const uint8_t *in, const size_t size, uint8_t *out,
+                   const size_t capacity, LzTable &table) {
+  static_assert(FrameWriter::MAX_FRAME_SIZE < UINT16_MAX,
+                "Positions are stored in 16 bits");
+
+  // Last position + 1 each hash was seen at, 0 for none
+  table.fill(0);
+
+  Output output{out, capacity};
+  size_t anchor = 0;
+  size_t position = 0;
+
+  while (position + MIN_MATCH <= size) {
+    const auto sequence = read32(in + position);
+    auto &slot = table[hash(sequence)];
+    const size_t candidate = slot;
+
+    slot = static_cast<uint16_t>(position + 1);
+
+    if (candidate == 0 || read32(in + candidate - 1) != sequence) {
+      position++;
+
+      continue;
+    }
+
+    const auto match = candidate - 1;
+    auto length = MIN_MATCH;
+
+    while (position + length < size &&
+           in[match + length] == in[position + length]) {
+      length++;
+    }
+
+    put_sequence(output, in + anchor, position - anchor, position - match,
+                 length);
+
+    position += length;
+    anchor = position;
+
+    if (!output.ok)
+      return 0;
+  }
+
+  put_last_literals(output, in + anchor, size - anchor);
+
+  return output.ok ? output.size : 0;
+}
+
+size_t adc12_delta_compress(const uint8_t *in, const size_t size,
+                            const size_t prefix, uint8_t *out,
+                            const size_t capacity) {
+  if (prefix > size)
+    return 0;
+
+  Output output{out, capacity};
+
+  output.put(in, prefix);
+
+  const auto pairs = (size - prefix) / 3;
+  int32_t previous = 0;
+
+  for (size_t i = 0; i < pairs; ++i) {
+    const uint8_t *pair = in + prefix + i * 3;
+
+    const int32_t first = pair[0] | (pair[1] & 0x0f) << 8;
+    const int32_t second = pair[1] >> 4 | pair[2] << 4;
+
+    output.put_varint(zigzag(first - previous));
+    output.put_varint(zigzag(second - first));
+
+    previous = second;
+
+    if (!output.ok)
+      return 0;
+  }
+
+  output.put(in + prefix + pairs * 3, size - prefix - pairs * 3);
+
+  return output.ok ? output.size : 0;
+}
+
+} // namespace compression
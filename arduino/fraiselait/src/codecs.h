@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Encoders for CompressedData frames. Both run over fixed buffers only.
+namespace compression {
+
+constexpr uint8_t LZ_HASH_BITS = 10;
+
+// Match finder state; kept by the caller so it stays off the stack
+using LzTable = std::array<uint16_t, 1u << LZ_HASH_BITS>;
+
+// LZ77 in the LZ4 block layout: sequences of
+//   token(1) [literal_length+] literals [offset(2) [match_length+]]
+// token holds literal_length (high nibble) and match_length - 4 (low
+// nibble); a nibble of 15 continues in 255-saturated extension bytes. The
+// last sequence carries literals only. Returns 0 if the output would not
+// fit into capacity.
+size_t lz_compress(const uint8_t *in, size_t size, uint8_t *out,
+                   size_t capacity, LzTable &table);
+
+// The first `prefix` bytes verbatim, then every packed 12-bit sample pair
+// (see RawSampleBlock) as two zigzag varints of the difference to the
+// previous sample, then any leftover bytes verbatim. Returns 0 if the output
+// would not fit into capacity.
+size_t adc12_delta_compress(const uint8_t *in, size_t size, size_t prefix,
+                            uint8_t *out, size_t capacity);
+
+} // namespace compression
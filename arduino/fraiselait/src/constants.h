@@ -6,6 +6,39 @@
 constexpr uint32_t CUSTOM_DEVICE_ID = 0;
 constexpr bool     SOFTWARE_RESET_ON_DISCONNECT = false;
 
+/* CONNECTION */
+
+// How often Serial is checked while no host has the port open. The check
+// runs the USB stack, so it is not free.
+constexpr uint32_t CONNECTION_POLL_INTERVAL_MS = 10;
+constexpr uint32_t STATUS_LED_BLINK_MS = 150;
+
+/* SESSION RESUME */
+
+// How long a dropped session stays resumable before its state is reset
+constexpr uint32_t SESSION_GRACE_MS = 10'000;
+
+/* FLOW CONTROL */
+
+// Host Data frames in flight. Host frames are a single chunk in practice,
+// so this stays well inside CFG_TUD_CDC_RX_BUFSIZE.
+constexpr uint16_t FLOW_CONTROL_DEVICE_WINDOW = 16;
+
+/* COMPRESSION */
+
+// Smaller Data bodies are always sent as is
+constexpr size_t COMPRESSION_MIN_SIZE = 64;
+
+/* TX SCHEDULING */
+
+// Must match CFG_TUD_CDC_TX_BUFSIZE
+constexpr size_t USB_TX_BUFFER_SIZE = 2048;
+
+// Chunks only go into the USB buffer while it holds less than this. Frames
+// still queued in the FrameWriter can be overtaken by more urgent ones,
+// buffered bytes cannot; 256 B is about 0.2 ms of full-speed USB.
+constexpr size_t USB_TX_BACKLOG = 256;
+
 /* PINS */
 
 constexpr uint8_t PIN_SPEAKER = 8;
@@ -15,14 +48,49 @@ constexpr uint8_t PIN_LED_BLUE = 11;
 constexpr uint8_t PIN_LED_RED = 10;
 constexpr uint8_t PIN_LIGHT_SENSOR = 28;
 
-/* FIFO COMMANDS */
+/* INTER-CORE COMMANDS */
 
-constexpr uint32_t FIFO_NO_TONE = 0xcafe0000;
-constexpr uint32_t FIFO_TONE = 0xcafe000a;
-constexpr uint32_t FIFO_RGB_LED = 0xcafe000b;
-constexpr uint32_t FIFO_LED_BUILTIN = 0xcafe000c;
-constexpr uint32_t FIFO_WAVEFORM = 0xcafe000d;
+constexpr size_t CORE_COMMAND_QUEUE_SIZE = 32;
+constexpr size_t SCHEDULED_COMMAND_CAPACITY = 64;
+
+// One upload has to fit into a single host frame
+constexpr size_t TONE_SEQUENCE_CAPACITY = 128;
+constexpr size_t LED_ANIMATION_CAPACITY = 64;
+
+/* LED ANIMATION */
+
+constexpr uint32_t LED_ANIMATION_FRAME_HZ = 200;
 
 /* SENSORS */
 
-constexpr size_t ANALOG_READINGS = 24;
+constexpr size_t ANALOG_READINGS = 24; // Boxcar window
+
+constexpr uint8_t  FILTER_EMA_SHIFT = 4; // alpha = 1/16
+constexpr size_t   FILTER_MEDIAN_WINDOW = 5;
+constexpr uint32_t FILTER_CIC_DECIMATION = 16;
+constexpr uint8_t  FILTER_CIC_ORDER = 3;
+
+constexpr uint8_t  ADC_INPUT_LIGHT_SENSOR = PIN_LIGHT_SENSOR - 26;
+constexpr uint8_t  ADC_INPUT_TEMPERATURE = 4;
+constexpr uint32_t ADC_SAMPLE_RATE_HZ = 2000; // Across both inputs
+constexpr size_t   ADC_BLOCK_SAMPLES = 64;    // Interleaved, must be even
+constexpr size_t   ADC_RING_BLOCKS = 8;
+
+/* STREAMING */
+
+constexpr uint32_t MIN_STREAM_PERIOD_US = 500;
+constexpr uint8_t  MAX_STREAM_BATCH = 32;
+constexpr size_t   STREAM_BUFFER_SAMPLES = 64;
+
+constexpr uint32_t MAX_RAW_SAMPLE_RATE_HZ = 50'000; // Light sensor only
+constexpr size_t   RAW_BLOCK_SAMPLES = 1024;
+constexpr size_t   RAW_RING_BLOCKS = 4;
+
+/* PCM AUDIO */
+
+constexpr uint32_t PCM_MIN_SAMPLE_RATE_HZ = 4000;
+constexpr uint32_t PCM_MAX_SAMPLE_RATE_HZ = 48'000;
+constexpr uint16_t PCM_PWM_WRAP = 1023;          // 10-bit, ~195 kHz carrier
+constexpr size_t   PCM_BUFFER_SAMPLES = 8192;    // Jitter buffer, power of two
+constexpr size_t   PCM_DEFAULT_PREBUFFER = 1024; // Samples held before playing
+constexpr size_t   PCM_BLOCK_SAMPLES = 256;      // Per DMA block
@@ -0,0 +1,36 @@
+#include "crc16.h"
+
+#include <array>
+
+namespace {
+
+constexpr uint16_t POLYNOMIAL = 0x1021;
+
+constexpr std::array<uint16_t, 256> make_table() {
+  std::array<uint16_t, 256> table{};
+
+  for (size_t i = 0; i < table.size(); ++i) {
+    auto crc = static_cast<uint16_t>(i << 8);
+
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ POLYNOMIAL)
+                           : static_cast<uint16_t>(crc << 1);
+    }
+
+    table[i] = crc;
+  }
+
+  return table;
+}
+
+constexpr auto TABLE = make_table();
+
+} // namespace
+
+uint16_t crc16::update(uint16_t crc, const uint8_t *data, const size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    crc = static_cast<uint16_t>((crc << 8) ^ TABLE[(crc >> 8) ^ data[i]]);
+  }
+
+  return crc;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace crc16 {
+
+// CRC-16/CCITT (XMODEM variant: poly 0x1021, init 0x0000, no reflection) as
+// used by the chunk framing on both ends of the link.
+uint16_t update(uint16_t crc, const uint8_t *data, size_t size);
+
+inline uint16_t compute(const uint8_t *data, const size_t size) {
+  return update(0x0000, data, size);
+}
+
+} // namespace crc16
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Writes `value` to `out` least significant byte first, as every multi-byte
+// field on the wire is laid out. Returns the byte after it.
+template <typename T> uint8_t *put_le(uint8_t *out, const T value) {
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    *out++ = static_cast<uint8_t>(value >> (8 * i));
+  }
+
+  return out;
+}
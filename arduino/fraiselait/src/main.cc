@@ -1,197 +1,454 @@
 #include <Arduino.h>
 
+#include <algorithm>
 #include <array>
 #include <functional>
 
 #define PCOMM_ENABLE_DEBUG_LOG false
 
+#include "AdcEngine.h"
+#include "ChunkMtu.h"
+#include "Compression.h"
+#include "CommandScheduler.h"
+#include "ConnectionManager.h"
+#include "CoreCommand.h"
+#include "DataCommands.h"
+#include "DeltaTelemetry.h"
+#include "DeviceData.h"
+#include "Diagnostics.h"
+#include "DmaCrcCopy.h"
+#include "DmaAdcSource.h"
+#include "DmaPcmOutput.h"
+#include "FlowControl.h"
+#include "InterruptLock.h"
+#include "LatencyTrace.h"
+#include "LedAnimation.h"
+#include "LedAnimator.h"
+#include "PcmJitterBuffer.h"
+#include "RawSampleStream.h"
+#include "SensorFilter.h"
 #include "SerialCommunicator.h"
+#include "SessionResume.h"
+#include "TelemetryStream.h"
+#include "TonePlayer.h"
+#include "ToneSequence.h"
 #include "constants.h"
 #include "xxh32.h"
 
 #include <ToneDynamic/Speaker.h>
 
 SerialCommunicator comm;
+ConnectionManager connection{[] { return static_cast<bool>(Serial); },
+                             CONNECTION_POLL_INTERVAL_MS};
 
-struct DeviceData final : ISerializable {
-  bool button_pressing = false;
-  int32_t light_strength_average = 0;
-  float core_temp_average = 0;
+volatile bool button_pressing = false;
+volatile int32_t light_strength_average = 0;
+volatile float core_temp_average = 0;
 
-  DeviceData() = default;
+bool send_data_forever = false;
+bool raw_streaming = false;
+bool pcm_streaming = false;
 
-  DeviceData(const bool button_pressing, const int32_t light_strength_average,
-             const float core_temp_average)
-      : button_pressing(button_pressing),
-        light_strength_average(light_strength_average),
-        core_temp_average(core_temp_average) {}
+DeviceData sample_device_data() {
+  return {button_pressing, light_strength_average, core_temp_average};
+}
 
-  void serialize(const pcomm::bytes::Encoder &encoder) const override {
-    encoder.push_bool(button_pressing);
-    encoder.push_number(light_strength_average);
-    encoder.push_number(core_temp_average);
+TelemetryStream telemetry_stream{sample_device_data};
+
+DmaCrcCopy dma_crc_copy;
+
+ChunkMtuCapability chunkMtuCap;
+SessionResumeCapability sessionResumeCap;
+SessionResume session_resume{sessionResumeCap};
+CompressionCapability compressionCap;
+Compressor compressor{compressionCap};
+FlowControlCapability flowControlCap;
+FlowControl flow_control{flowControlCap};
+
+DeltaTelemetryCapability deltaTelemetryCap;
+DeltaEncoder delta_encoder{deltaTelemetryCap};
+
+DeltaEncoder *active_delta_encoder() {
+  return deltaTelemetryCap.enabled() ? &delta_encoder : nullptr;
+}
+
+void send_data(const TxPriority priority = TxPriority::Interactive) {
+  comm.send_message<DeviceDataMessage>(sample_device_data(), {}, priority);
+}
+
+void send_streamed_data() {
+  const auto delta = active_delta_encoder();
+
+  if (!delta) {
+    send_data(TxPriority::Bulk);
+
+    return;
   }
-};
 
-struct ToneData final : IDeserializable {
-  float frequency{};
-  float volume = 1;
-  uint32_t duration{};
+  const auto sample = sample_device_data();
 
-  ToneData() = default;
+  if (const auto mask = delta->next_mask(sample)) {
+    comm.send_data(static_cast<uint16_t>(DataTypes::ResponseDataDelta),
+                   DeltaSample{mask, sample}, {}, TxPriority::Bulk);
+  }
+}
 
-  explicit ToneData(const float frequency, const float volume = 1,
-       const uint32_t duration = 0)
-      : frequency(frequency), volume(volume), duration(duration) {}
+RawSampleStream raw_stream;
 
-  bool deserialize(pcomm::bytes::Decoder &decoder) override {
-    if (decoder.remaining() < (4 + 4 + 4))
-      return false;
+void send_raw_block() {
+  const auto block = raw_stream.front();
 
-    frequency = decoder.pop_number<float>();
-    volume = decoder.pop_number<float>();
-    duration = decoder.pop_number<uint32_t>();
+  if (!block)
+    return;
 
-    return true;
+  if (raw_streaming && (!comm.can_send() || comm.tx_pending(TxPriority::Bulk)))
+    return;
+
+  // Blocks still in flight from a stream that was stopped are discarded
+  if (raw_streaming) {
+    comm.send_data(static_cast<uint16_t>(DataTypes::ResponseRawStream),
+                   {block->bytes.data(), block->bytes.size()},
+                   {CompressionCodec::Adc12Delta, RawSampleBlock::HEADER_SIZE},
+                   TxPriority::Bulk);
   }
 
-  bool deserialize(pcomm::bytes::Decoder &decoder) volatile override {
-    return const_cast<ToneData *>(this)->deserialize(decoder);
+  raw_stream.pop();
+}
+
+void send_telemetry_block() {
+  static TelemetryBlock block;
+
+  const auto delta = active_delta_encoder();
+
+  if (!telemetry_stream.take_batch(block, delta))
+    return;
+
+  const auto code = delta ? DataTypes::ResponseDataStreamDelta
+                          : DataTypes::ResponseDataStream;
+
+  comm.send_data(static_cast<uint16_t>(code), block, {}, TxPriority::Bulk);
+}
+
+CoreCommandQueue core_commands;
+
+void handle_data_get_immediate(pcomm::bytes::Decoder &) { send_data(); }
+
+void set_raw_streaming(const uint32_t sample_rate_hz) {
+  raw_streaming = sample_rate_hz != 0;
+
+  core_commands.push(CoreCommand::raw_stream(sample_rate_hz));
+}
+
+void handle_data_get_loop_off(pcomm::bytes::Decoder &) {
+  send_data_forever = false;
+
+  telemetry_stream.stop();
+
+  if (raw_streaming) {
+    set_raw_streaming(0);
   }
-};
+}
+
+void handle_data_get_loop_on(pcomm::bytes::Decoder &) {
+  telemetry_stream.stop();
+  delta_encoder.reset();
+
+  send_data_forever = true;
+}
 
-struct RGBColorData final : IDeserializable {
-  uint8_t r = 0;
-  uint8_t g = 0;
-  uint8_t b = 0;
+void handle_data_stream_on(pcomm::bytes::Decoder &decoder) {
+  // period_us(4) [batch_size(1)]
+  if (decoder.remaining() < 4) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
 
-  RGBColorData() = default;
+    return;
+  }
 
-  bool deserialize(pcomm::bytes::Decoder &decoder) override {
-    if (decoder.remaining() < (1 + 1 + 1))
-      return false;
+  const auto period_us = decoder.pop_number<uint32_t>();
+  const uint8_t batch_size = decoder.remaining() >= 1 ? decoder.pop_byte() : 1;
 
-    r = decoder.pop_number<uint8_t>();
-    g = decoder.pop_number<uint8_t>();
-    b = decoder.pop_number<uint8_t>();
+  send_data_forever = false;
 
-    return true;
+  delta_encoder.reset();
+
+  if (!telemetry_stream.start(period_us, batch_size)) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
   }
+}
 
-  bool deserialize(pcomm::bytes::Decoder &decoder) volatile override {
-    return const_cast<RGBColorData *>(this)->deserialize(decoder);
+void handle_raw_stream(pcomm::bytes::Decoder &decoder) {
+  // sample_rate_hz(4), 0 stops the stream
+  if (decoder.remaining() < 4) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+
+    return;
   }
-};
 
-enum class WaveformType : uint16_t {
-  Square = 0x0001,
-  Square25 = 0x0002,
-  Square12 = 0x0003,
-  Triangle = 0x0004,
-  Saw = 0x0005,
-  Sine = 0x0006,
-  Noise = 0x0007,
-};
+  const auto sample_rate_hz = decoder.pop_number<uint32_t>();
 
-volatile bool button_pressing = false;
-volatile int32_t light_strength_average = 0;
-volatile float core_temp_average = 0;
+  if (sample_rate_hz > MAX_RAW_SAMPLE_RATE_HZ) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
 
-bool send_data_forever = false;
+    return;
+  }
 
-void wait_for_serial() {
-  bool led_state = false;
+  set_raw_streaming(sample_rate_hz);
+}
 
-  while (!Serial) {
-    delay(150);
+void handle_filter_select(pcomm::bytes::Decoder &decoder) {
+  // sensor(1) preset(1)
+  if (decoder.remaining() < 2) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
 
-    led_state = !led_state;
+    return;
+  }
+
+  const auto sensor = decoder.pop_byte();
+  const auto preset = decoder.pop_byte();
+
+  if (sensor > static_cast<uint8_t>(SensorChannel::CoreTemperature) ||
+      !SensorFilter::is_valid(preset)) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
 
-    digitalWrite(LED_BUILTIN, led_state ? HIGH : LOW);
+    return;
   }
 
-  digitalWrite(LED_BUILTIN, LOW);
+  core_commands.push(
+      CoreCommand::select_filter({static_cast<SensorChannel>(sensor),
+                                  static_cast<FilterPreset>(preset)}));
 }
 
-void send_data() {
-  const DeviceData device_data{button_pressing, light_strength_average,
-                               core_temp_average};
+PcmJitterBuffer pcm_buffer;
+
+// buffered_samples(4) underrun_samples(4) overrun_samples(4)
+// played_samples(4)
+class PcmStatus final : public ISerializable {
+public:
+  explicit PcmStatus(const PcmStats &stats) : stats(stats) {}
 
-  comm.send_data(static_cast<uint16_t>(DataTypes::ResponseDataSend),
-                 device_data);
+  void serialize(const pcomm::bytes::Encoder &encoder) const override {
+    encoder.push_number(stats.buffered_samples);
+    encoder.push_number(stats.underrun_samples);
+    encoder.push_number(stats.overrun_samples);
+    encoder.push_number(stats.played_samples);
+  }
+
+private:
+  PcmStats stats;
+};
+
+void handle_pcm_stream(pcomm::bytes::Decoder &decoder) {
+  // sample_rate_hz(4) format(1) [prebuffer_samples(2)], 0 Hz stops
+  if (decoder.remaining() < 4 + 1) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+
+    return;
+  }
+
+  const auto sample_rate_hz = decoder.pop_number<uint32_t>();
+  const auto format = decoder.pop_byte();
+  const auto prebuffer = decoder.remaining() >= 2
+                             ? decoder.pop_number<uint16_t>()
+                             : PCM_DEFAULT_PREBUFFER;
+
+  if (!PcmJitterBuffer::is_valid(format) ||
+      (sample_rate_hz != 0 && (sample_rate_hz < PCM_MIN_SAMPLE_RATE_HZ ||
+                               sample_rate_hz > PCM_MAX_SAMPLE_RATE_HZ))) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+
+    return;
+  }
+
+  pcm_buffer.set_format(static_cast<PcmFormat>(format));
+  pcm_buffer.set_prebuffer(prebuffer);
+
+  // Dropped here rather than when core 1 stops the old stream, which may
+  // be after this stream's first samples have arrived
+  pcm_buffer.restart();
+
+  pcm_streaming = sample_rate_hz != 0;
+
+  core_commands.push(CoreCommand::pcm_stream(sample_rate_hz));
 }
 
-bool get_n_bit(const uint8_t flags, const size_t n) {
-  return (flags >> n) & 0b1;
+void handle_pcm_data(pcomm::bytes::Decoder &decoder) {
+  // Samples for a stream that was stopped are dropped
+  if (!pcm_streaming)
+    return;
+
+  // Even, so 16-bit samples never straddle two reads
+  std::array<uint8_t, 256> chunk;
+
+  while (decoder.remaining() > 0) {
+    const auto size = std::min(decoder.remaining(), chunk.size());
+
+    decoder.pop_bytes(chunk.data(), size);
+
+    pcm_buffer.write(chunk.data(), size);
+  }
 }
 
-static volatile auto waveform_data = WaveformType::Square;
-static volatile ToneData tone_data;
-static volatile bool led_data = false;
-static volatile RGBColorData color_data;
+void handle_pcm_status(pcomm::bytes::Decoder &) {
+  comm.send_data(static_cast<uint16_t>(DataTypes::ResponsePcmStatus),
+                 PcmStatus{pcm_buffer.stats()});
+}
 
-void process_data(const uint8_t flags, pcomm::bytes::Decoder &decoder) {
-  // 0 bit are currently unused
+// Uploads waiting for core 1; it only ever plays the newest
+SpscRing<ToneSequence, 2> uploaded_sequences;
 
-  if (get_n_bit(flags, 1)) {
-    // Change waveform
+constexpr uint8_t SEQUENCE_FLAG_LOOP = 1 << 0;
+constexpr uint8_t SEQUENCE_FLAG_PLAY = 1 << 1;
 
-    if (decoder.remaining() < 2) {
-      comm.send_error(
-          static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+void handle_tone_sequence(pcomm::bytes::Decoder &decoder) {
+  // flags(1) count(1) count * step, see ToneSequence.h
+  if (decoder.remaining() < 1) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
 
-      return;
-    }
+    return;
+  }
+
+  const auto flags = decoder.pop_byte();
 
-    waveform_data = static_cast<WaveformType>(decoder.pop_number<uint16_t>());
+  auto *sequence = uploaded_sequences.try_reserve();
 
-    rp2040.fifo.push_nb(FIFO_WAVEFORM);
+  if (!sequence) {
+    // Core 1 has not taken the previous uploads yet
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::InternalError));
+
+    return;
+  }
+
+  if (!parse_tone_sequence(decoder, *sequence)) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+
+    return;
   }
 
-  if (get_n_bit(flags, 2)) {
-    // No tone
-    rp2040.fifo.push_nb(FIFO_NO_TONE);
-  } else if (get_n_bit(flags, 3)) {
-    // Tone
+  uploaded_sequences.publish();
 
-    if (!tone_data.deserialize(decoder)) {
-      comm.send_error(
-          static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+  core_commands.push(CoreCommand::tone_sequence(
+      {SequenceOp::Load, (flags & SEQUENCE_FLAG_LOOP) != 0,
+       (flags & SEQUENCE_FLAG_PLAY) != 0}));
+}
 
-      return;
-    }
+void handle_tone_sequence_control(pcomm::bytes::Decoder &decoder) {
+  // op(1): 0 stops, 1 plays once, 2 plays in a loop
+  if (decoder.remaining() < 1) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
 
-    rp2040.fifo.push_nb(FIFO_TONE);
+    return;
   }
 
-  if (get_n_bit(flags, 4)) {
-    // LED Builtin
-    if (decoder.remaining() < 1) {
-      comm.send_error(
-          static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+  const auto op = decoder.pop_byte();
 
-      return;
-    }
+  if (op > 2) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+
+    return;
+  }
+
+  core_commands.push(CoreCommand::tone_sequence(
+      {op == 0 ? SequenceOp::Stop : SequenceOp::Play, op == 2, false}));
+}
+
+// Uploads waiting for core 1; it only ever plays the newest
+SpscRing<LedAnimation, 2> uploaded_animations;
+
+constexpr uint8_t ANIMATION_FLAG_LOOP = 1 << 0;
+constexpr uint8_t ANIMATION_FLAG_STOP = 1 << 1;
 
-    led_data = decoder.pop_bool();
+void handle_led_animation(pcomm::bytes::Decoder &decoder) {
+  // flags(1) count(1) count * keyframe, see LedAnimation.h. With the stop
+  // flag set, nothing follows the flags.
+  if (decoder.remaining() < 1) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
 
-    rp2040.fifo.push_nb(FIFO_LED_BUILTIN);
+    return;
   }
 
-  if (get_n_bit(flags, 5)) {
-    // RGB LED
+  const auto flags = decoder.pop_byte();
 
-    if (!color_data.deserialize(decoder)) {
-      comm.send_error(
-          static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+  if (flags & ANIMATION_FLAG_STOP) {
+    core_commands.push(CoreCommand::led_animation({AnimationOp::Stop, false}));
 
-      return;
-    }
+    return;
+  }
+
+  auto *animation = uploaded_animations.try_reserve();
+
+  if (!animation) {
+    // Core 1 has not taken the previous uploads yet
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::InternalError));
+
+    return;
+  }
+
+  if (!parse_led_animation(decoder, *animation)) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+
+    return;
+  }
+
+  uploaded_animations.publish();
+
+  core_commands.push(CoreCommand::led_animation(
+      {AnimationOp::Play, (flags & ANIMATION_FLAG_LOOP) != 0}));
+}
+
+void handle_schema(pcomm::bytes::Decoder &) {
+  static constexpr auto schema =
+      message_schema<DeviceDataMessage, ToneMessage, RGBColorMessage>();
+
+  comm.send_data(static_cast<uint16_t>(DataTypes::ResponseSchema),
+                 TxSegment{schema.data(), schema.size()},
+                 {CompressionCodec::None});
+}
+
+void handle_diagnostics(pcomm::bytes::Decoder &) {
+  const auto &rx = comm.rx_stats();
+  const auto &tx = comm.tx_stats();
+
+  const LinkCounters link{rx.packets, rx.malformed_packets, rx.unknown_packets,
+                          core_commands.overflows(), tx.dropped_frames,
+                          tx.classes};
+
+  comm.send_data(static_cast<uint16_t>(DataTypes::ResponseDiagnostics),
+                 DiagnosticsReport{link});
+}
+
+void handle_data_set(pcomm::bytes::Decoder &decoder) {
+  if (decoder.remaining() < 1) {
+    comm.send_error(static_cast<uint16_t>(ReservedErrorCode::MalformedPacket));
+
+    return;
+  }
+
+  const auto flags = decoder.pop_number<uint8_t>();
 
-    rp2040.fifo.push_nb(FIFO_RGB_LED);
+  if (const auto error = process_data(flags, decoder, core_commands)) {
+    comm.send_error(static_cast<uint16_t>(error.value()));
   }
 }
 
+using StaticDataHandlers = StaticDispatchTable<
+    DataHandler,
+    DispatchRoute<DataTypes::CommandDataGetImmediate, handle_data_get_immediate>,
+    DispatchRoute<DataTypes::CommandDataGetLoopOff, handle_data_get_loop_off>,
+    DispatchRoute<DataTypes::CommandDataGetLoopOn, handle_data_get_loop_on>,
+    DispatchRoute<DataTypes::CommandDataStreamOn, handle_data_stream_on>,
+    DispatchRoute<DataTypes::CommandFilterSelect, handle_filter_select>,
+    DispatchRoute<DataTypes::CommandRawStream, handle_raw_stream>,
+    DispatchRoute<DataTypes::CommandDiagnostics, handle_diagnostics>,
+    DispatchRoute<DataTypes::CommandPcmStream, handle_pcm_stream>,
+    DispatchRoute<DataTypes::CommandPcmData, handle_pcm_data>,
+    DispatchRoute<DataTypes::CommandPcmStatus, handle_pcm_status>,
+    DispatchRoute<DataTypes::CommandToneSequence, handle_tone_sequence>,
+    DispatchRoute<DataTypes::CommandToneSequenceControl,
+                  handle_tone_sequence_control>,
+    DispatchRoute<DataTypes::CommandLedAnimation, handle_led_animation>,
+    DispatchRoute<DataTypes::CommandSchema, handle_schema>,
+    DispatchRoute<DataTypes::CommandDataSet, handle_data_set>>;
+
 class FraiselaitDeviceCapability final : public ICapability {
 public:
   FraiselaitDeviceCapability() = default;
@@ -211,135 +468,248 @@ public:
 FraiselaitDeviceCapability fraiselaitDeviceCap;
 
 void reset_state() {
-  waveform_data = WaveformType::Square;
+  send_data_forever = false;
+  raw_streaming = false;
+  pcm_streaming = false;
+
+  telemetry_stream.stop();
+  connection.reset_host_led();
+
+  core_commands.push(CoreCommand::clear_schedule());
+  core_commands.push(CoreCommand::raw_stream(0));
+  core_commands.push(CoreCommand::pcm_stream(0));
+  core_commands.push(
+      CoreCommand::tone_sequence({SequenceOp::Stop, false, false}));
+  core_commands.push(CoreCommand::no_tone());
+  core_commands.push(CoreCommand::set_color({0, 0, 0}));
+  core_commands.push(CoreCommand::set_waveform(WaveformType::Square));
+  core_commands.push(CoreCommand::select_filter(
+      {SensorChannel::LightSensor, FilterPreset::Boxcar}));
+  core_commands.push(CoreCommand::select_filter(
+      {SensorChannel::CoreTemperature, FilterPreset::Boxcar}));
+}
 
-  tone_data.frequency = 0;
-  tone_data.volume = 1;
-  tone_data.duration = 0;
+void setup() {
+  Serial.begin(115200);
 
-  color_data.r = 0;
-  color_data.g = 0;
-  color_data.b = 0;
+  connection.begin();
 
-  led_data = false;
+  const bool registered =
+      comm.add_capability(fraiselaitDeviceCap, fraiselaitDeviceCap) &&
+      comm.add_capability(deltaTelemetryCap, deltaTelemetryCap) &&
+      comm.add_capability(flowControlCap, flowControlCap) &&
+      comm.add_capability(chunkMtuCap, chunkMtuCap) &&
+      comm.add_capability(compressionCap, compressionCap) &&
+      comm.add_capability(sessionResumeCap, sessionResumeCap);
 
-  send_data_forever = false;
+  // Ids are fixed at build time, so this only trips on a clashing or
+  // out-of-range id added during development
+  if (!registered)
+    panic("capability ids clash or span too far");
+
+  // Host commands count as drained once core 1 has room for more of them
+  flow_control.set_ready_check([] {
+    return core_commands.size() <= CORE_COMMAND_QUEUE_SIZE / 2;
+  });
+  comm.set_flow_control(flow_control);
+  comm.set_chunk_mtu(chunkMtuCap);
+  comm.set_compressor(compressor);
+  comm.set_session_resume(session_resume);
+
+  // Falls back to the table-driven CRC if every DMA channel is taken
+  if (dma_crc_copy.claim()) {
+    comm.set_crc_copy(dma_crc_copy);
+  }
+
+  comm.set_static_data_handlers(StaticDataHandlers::view());
 
-  rp2040.fifo.push_nb(FIFO_NO_TONE);
-  rp2040.fifo.push_nb(FIFO_RGB_LED);
-  rp2040.fifo.push_nb(FIFO_WAVEFORM);
+  // State survives a dropped link until the session is over for good, so a
+  // host that resumes finds its streams and actuators as it left them
+  comm.on_session_end(reset_state);
+  // Runs inside comm.update(); loop() handles the rest
+  comm.on_disconnect([] { connection.link_lost(); });
 }
 
-void setup() {
-  Serial.begin(115200);
+void loop() {
+  if (!connection.poll(comm.is_connected())) {
+    // A dropped session that is not resumed in time still gets reset
+    comm.poll_session();
+
+    return;
+  }
 
-  wait_for_serial();
+  latency::begin_receive();
 
-  comm.add_capability(fraiselaitDeviceCap, fraiselaitDeviceCap);
+  comm.update();
 
-  comm.subscribe_data(
-    static_cast<uint16_t>(DataTypes::CommandDataGetImmediate),
-    [](const auto &) { send_data(); }
-  );
+  latency::end_receive();
 
-  comm.subscribe_data(
-    static_cast<uint16_t>(DataTypes::CommandDataGetLoopOff),
-    [](const auto &) { send_data_forever = false; }
-  );
+  if (!comm.is_connected()) {
+    comm.poll_session();
 
-  comm.subscribe_data(
-    static_cast<uint16_t>(DataTypes::CommandDataGetLoopOn),
-    [](const auto &) { send_data_forever = true; }
-  );
+    return;
+  }
 
-  comm.subscribe_data(
-    static_cast<uint16_t>(DataTypes::CommandDataSet),
-    [](std::vector<uint8_t> payload) {
-      if (payload.empty()) {
-        comm.send_error(static_cast<uint16_t>(
-            ReservedErrorCode::MalformedPacket));
+  comm.return_credits();
 
-        return;
-      }
+  // Without credit, streamed data stays queued (and is counted as dropped
+  // once its buffer fills) instead of overrunning the host. Blocks also wait
+  // for the previous one to leave the TX queue so they never pile up there.
+  if (send_data_forever && comm.can_send())
+    send_streamed_data();
 
-      pcomm::bytes::Decoder decoder{payload.data(), payload.size()};
-      const auto flags = decoder.pop_number<uint8_t>();
+  if (telemetry_stream.batch_ready() && comm.can_send() &&
+      !comm.tx_pending(TxPriority::Bulk))
+    send_telemetry_block();
 
-      process_data(flags, decoder);
-    }
-  );
+  send_raw_block();
 
-  comm.on_disconnect([] {
-    reset_state();
-    wait_for_serial();
-  });
+  comm.pump_tx();
 }
 
-void loop() {
-  comm.update();
+// ADC counts are 12-bit; analogRead() reports 10-bit, which the host expects
+int32_t light_sensor_value(const int32_t raw) { return raw >> 2; }
 
-  if (!comm.is_connected())
-    return;
+// Same conversion as analogReadTemp()
+float core_temperature(const int32_t raw) {
+  const float voltage = raw * 3.3f / 4096.f;
 
-  if (send_data_forever)
-    send_data();
+  return 27.f - (voltage - 0.706f) / 0.001721f;
 }
 
-void smooth_analog_values() {
-  static size_t light_strength_read_index = 0;
-  static int32_t light_strength_total = 0;
-  static std::array<int32_t, ANALOG_READINGS> light_strength_readings{};
-  static std::array<float, ANALOG_READINGS> core_temp_readings{};
+// Both sensors are filtered in raw ADC counts and only converted to their
+// reporting units when a new value comes out of the chain.
+DmaAdcSource adc_source;
 
-  light_strength_total -= light_strength_readings[light_strength_read_index];
-  light_strength_readings[light_strength_read_index] =
-      analogRead(PIN_LIGHT_SENSOR);
-  light_strength_total += light_strength_readings[light_strength_read_index];
-  light_strength_read_index++;
+SensorFilter light_filter;
+SensorFilter temperature_filter;
 
-  if (light_strength_read_index >= light_strength_readings.size()) {
-    light_strength_read_index = 0;
+void consume_analog_block(const uint16_t *light, const uint16_t *temperature,
+                          const size_t count, const uint64_t completed_at_us) {
+  raw_stream.push(light, count, completed_at_us, adc_source.overruns());
+
+  int32_t filtered;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (light_filter.process(light[i], filtered)) {
+      light_strength_average = light_sensor_value(filtered);
+    }
+
+    if (temperature_filter.process(temperature[i], filtered)) {
+      core_temp_average = core_temperature(filtered);
+    }
   }
+}
 
-  light_strength_average =
-      light_strength_total / light_strength_readings.size();
+void command_select_filter(const FilterSelection &selection) {
+  switch (selection.sensor) {
+    case SensorChannel::LightSensor:
+      light_filter.select(selection.preset);
 
-  static size_t core_temp_read_index = 0;
-  static float core_temp_total = 0;
+      break;
 
-  core_temp_total -= core_temp_readings[core_temp_read_index];
-  core_temp_readings[core_temp_read_index] = analogReadTemp();
-  core_temp_total += core_temp_readings[core_temp_read_index];
-  core_temp_read_index++;
+    case SensorChannel::CoreTemperature:
+      temperature_filter.select(selection.preset);
 
-  if (core_temp_read_index >= core_temp_readings.size()) {
-    core_temp_read_index = 0;
+      break;
   }
+}
 
-  core_temp_average = core_temp_total / core_temp_readings.size();
+AdcEngine adc_engine{adc_source, consume_analog_block};
+
+void command_raw_stream(const uint32_t sample_rate_hz) {
+  adc_engine.stop();
+
+  if (sample_rate_hz == 0) {
+    raw_stream.end();
+    adc_engine.start(ADC_SAMPLE_RATE_HZ);
+
+    return;
+  }
+
+  // The light sensor gets every other conversion
+  raw_stream.begin(sample_rate_hz);
+  adc_engine.start(sample_rate_hz * IAdcSource::CHANNELS);
 }
 
 static tone_dynamic::Speaker sp{PIN_SPEAKER, true};
 
-void command_no_tone() { sp.stop(); }
+DmaPcmOutput pcm_output{pcm_buffer};
+
+// The speaker pin belongs to PCM playback while it runs; tones are ignored
+// until the host stops the stream.
+void command_pcm_stream(const uint32_t sample_rate_hz) {
+  pcm_output.stop();
+
+  if (sample_rate_hz == 0)
+    return;
+
+  InterruptLock lock;
+
+  sp.stop();
+  pcm_output.start(sample_rate_hz);
+}
+
+// tone_player drives sp from an alarm on this core, so every other use of sp
+// masks interrupts while it runs
+void command_no_tone() {
+  InterruptLock lock;
+
+  if (pcm_output.active())
+    return;
+
+  sp.stop();
+}
+
+void command_tone(const ToneParams &data) {
+  InterruptLock lock;
+
+  if (pcm_output.active())
+    return;
 
-void command_tone(const volatile ToneData &data) {
   sp.set_frequency(data.frequency);
   sp.set_volume(data.volume);
   sp.play(data.duration);
 }
 
-void command_change_color(const volatile RGBColorData &data) {
-  analogWrite(PIN_LED_RED, data.r);
-  analogWrite(PIN_LED_GREEN, data.g);
-  analogWrite(PIN_LED_BLUE, data.b);
+void write_color(const RGBColor &color) {
+  analogWrite(PIN_LED_RED, color.r);
+  analogWrite(PIN_LED_GREEN, color.g);
+  analogWrite(PIN_LED_BLUE, color.b);
+}
+
+LedAnimator led_animator{write_color};
+
+// A color set directly wins over any running animation
+void command_change_color(const RGBColor &data) {
+  led_animator.stop();
+  write_color(data);
 }
 
-void command_change_led_builtin(const volatile bool &data) {
+void command_led_animation(const AnimationControl &control) {
+  if (control.op == AnimationOp::Stop) {
+    led_animator.stop();
+
+    return;
+  }
+
+  while (uploaded_animations.size() > 1) {
+    uploaded_animations.pop();
+  }
+
+  if (const auto animation = uploaded_animations.front()) {
+    led_animator.play(*animation, control.loop);
+    uploaded_animations.pop();
+  }
+}
+
+void command_change_led_builtin(const bool data) {
   digitalWrite(LED_BUILTIN, data);
 }
 
-void command_change_waveform(const volatile WaveformType &type) {
+void command_change_waveform(const WaveformType type) {
+  InterruptLock lock;
+
   switch (type) {
     case WaveformType::Square:
       sp.set_waveform(tone_dynamic::SQUARE_WAVEFORM);
@@ -381,6 +751,126 @@ void command_change_waveform(const volatile WaveformType &type) {
   }
 }
 
+// Runs from the player's alarm; InterruptLock nests, so it may call
+// command_change_waveform
+void play_tone_step(const ToneStep *step) {
+  if (pcm_output.active())
+    return;
+
+  if (!step) {
+    sp.stop();
+
+    return;
+  }
+
+  if (step->waveform != 0) {
+    command_change_waveform(static_cast<WaveformType>(step->waveform));
+  }
+
+  sp.set_frequency(step->frequency());
+  sp.set_volume(step->volume_level());
+  sp.play(0);
+}
+
+TonePlayer tone_player{play_tone_step};
+
+void command_tone_sequence(const SequenceControl &control) {
+  switch (control.op) {
+    case SequenceOp::Load:
+      while (uploaded_sequences.size() > 1) {
+        uploaded_sequences.pop();
+      }
+
+      if (const auto sequence = uploaded_sequences.front()) {
+        tone_player.load(*sequence);
+        uploaded_sequences.pop();
+      }
+
+      if (control.play) {
+        tone_player.play(control.loop);
+      }
+
+      break;
+
+    case SequenceOp::Play:
+      tone_player.play(control.loop);
+
+      break;
+
+    case SequenceOp::Stop:
+      tone_player.stop();
+
+      break;
+  }
+}
+
+void apply_core_command(const CoreCommand &command) {
+  switch (command.type) {
+    case CoreCommandType::NoTone:
+      command_no_tone();
+
+      break;
+
+    case CoreCommandType::Tone:
+      command_tone(command.tone);
+
+      break;
+
+    case CoreCommandType::RGBLed:
+      command_change_color(command.color);
+
+      break;
+
+    case CoreCommandType::LEDBuiltin:
+      command_change_led_builtin(command.led);
+
+      break;
+
+    case CoreCommandType::Waveform:
+      command_change_waveform(command.waveform);
+
+      break;
+
+    case CoreCommandType::ClearSchedule:
+      // Handled by CommandScheduler
+      break;
+
+    case CoreCommandType::SelectFilter:
+      command_select_filter(command.filter);
+
+      break;
+
+    case CoreCommandType::RawStream:
+      command_raw_stream(command.raw_sample_rate_hz);
+
+      break;
+
+    case CoreCommandType::PcmStream:
+      command_pcm_stream(command.pcm_sample_rate_hz);
+
+      break;
+
+    case CoreCommandType::ToneSequence:
+      command_tone_sequence(command.sequence);
+
+      break;
+
+    case CoreCommandType::LedAnimation:
+      command_led_animation(command.animation);
+
+      break;
+  }
+}
+
+// Every command reaches its actuator through here, immediate ones on submit
+// and timed ones from poll() once they are due
+void apply_traced_command(const CoreCommand &command) {
+  apply_core_command(command);
+  latency::applied(command.trace, command.execute_at_us);
+}
+
+CommandScheduler command_scheduler{apply_traced_command};
+
 void setup1() {
   pinMode(LED_BUILTIN, OUTPUT);
   pinMode(PIN_SPEAKER, OUTPUT);
@@ -389,23 +879,28 @@ void setup1() {
   pinMode(PIN_LED_BLUE, OUTPUT);
   pinMode(PIN_LED_RED, OUTPUT);
   pinMode(PIN_LIGHT_SENSOR, INPUT);
+
+  // One hardware alarm for both effects; core 0's default pool holds
+  // another
+  if (auto *effects_pool = alarm_pool_create_with_unused_hardware_alarm(2)) {
+    tone_player.begin(effects_pool);
+    led_animator.begin(effects_pool);
+  }
+
+  // Started from core 1 so the DMA IRQ is serviced here, not on the
+  // communication core
+  adc_engine.start(ADC_SAMPLE_RATE_HZ);
 }
 
 void loop1() {
-  if (uint32_t cmd; rp2040.fifo.pop_nb(&cmd)) {
-    if (cmd == FIFO_NO_TONE) {
-      command_no_tone();
-    } else if (cmd == FIFO_TONE) {
-      command_tone(tone_data);
-    } else if (cmd == FIFO_LED_BUILTIN) {
-      command_change_led_builtin(led_data);
-    } else if (cmd == FIFO_RGB_LED) {
-      command_change_color(color_data);
-    } else if (cmd == FIFO_WAVEFORM) {
-      command_change_waveform(waveform_data);
-    }
+  for (CoreCommand command; core_commands.pop(command);) {
+    latency::dequeued(command.trace);
+
+    command_scheduler.submit(command, time_us_64());
   }
 
-  smooth_analog_values();
+  command_scheduler.poll(time_us_64());
+
+  adc_engine.poll();
   button_pressing = digitalRead(PIN_TACT_SWITCH) == LOW;
 }
@@ -25,6 +25,7 @@ internal abstract class BaseSerialDevice(
     private const val TYPE_DEBUG_ECHO: UShort = 0xFFFFu
 
     private const val MAX_CHUNK_SIZE: UShort = 38u // 64 - 5 (cobs) - 14 (header+crc) - 1 (delimiter) - 6 (additional)
+    private const val MAX_RX_CHUNK_SIZE: UShort = 1024u // Largest size the device may negotiate
     private const val MAX_FRAME_SIZE = 2048
     private val RX_FRAME_TIMEOUT = Duration.ofMillis(2000)
 
@@ -158,7 +159,7 @@ internal abstract class BaseSerialDevice(
         return
       }
 
-      if (payloadSize > MAX_CHUNK_SIZE) {
+      if (payloadSize > MAX_RX_CHUNK_SIZE) {
         debugLog("Payload size too large: $payloadSize")
 
         return
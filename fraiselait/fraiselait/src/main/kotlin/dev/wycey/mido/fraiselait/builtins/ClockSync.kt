@@ -0,0 +1,158 @@
+package dev.wycey.mido.fraiselait.builtins
+
+import kotlin.math.abs
+
+/**
+ * Estimates how the device clock (`time_us_64()`, microseconds since boot) relates to the host's
+ * [System.nanoTime] from NTP-style exchanges.
+ *
+ * Each exchange gives an offset measurement whose error is at most half its round trip. Only the
+ * exchanges with the shortest round trips in the recent [window] are trusted. A line is fitted
+ * through them so the device's crystal drift is tracked as well as its offset.
+ */
+public class ClockSync
+  @JvmOverloads
+  constructor(
+    private val window: Int = 64
+  ) {
+    private data class Sample(
+      val hostMidUs: Double,
+      val offsetUs: Double,
+      val roundTripUs: Double
+    )
+
+    // offset(host) = referenceOffsetUs + drift * (host - referenceHostUs), replaced as a whole on every fit so readers
+    // never see half of one fit and half of the next
+    private data class Fit(
+      val referenceHostUs: Double = 0.0,
+      val referenceOffsetUs: Double = 0.0,
+      val drift: Double = 0.0,
+      val offsetUs: Double = 0.0,
+      val errorBoundUs: Double = Double.POSITIVE_INFINITY
+    )
+
+    private val samples = ArrayDeque<Sample>()
+
+    @Volatile
+    private var current = Fit()
+
+    /** Device clock minus host clock, in microseconds, at the time of the last fit. */
+    public val offsetMicros: Double
+      get() = current.offsetUs
+
+    /** How much faster the device clock runs than the host's, in parts per million. */
+    public val driftPpm: Double
+      get() = current.drift * 1e6
+
+    /** Bound on the error of [toHostNanos], in microseconds; infinite until the first exchange. */
+    public val errorBoundMicros: Double
+      get() = current.errorBoundUs
+
+    /** Round trip of the last exchange, in microseconds. */
+    @Volatile
+    public var lastRoundTripMicros: Double = Double.NaN
+      private set
+
+    public val isSynchronized: Boolean
+      get() = errorBoundMicros.isFinite()
+
+    /**
+     * Adds one exchange: [hostSentNanos] and [hostReceivedNanos] from [System.nanoTime],
+     * [deviceReceivedMicros] and [deviceSentMicros] from the device's reply.
+     */
+    @Synchronized
+    public fun addSample(
+      hostSentNanos: Long,
+      deviceReceivedMicros: Long,
+      deviceSentMicros: Long,
+      hostReceivedNanos: Long
+    ) {
+      val hostSentUs = hostSentNanos / 1000.0
+      val hostReceivedUs = hostReceivedNanos / 1000.0
+      val deviceTurnaroundUs = (deviceSentMicros - deviceReceivedMicros).toDouble()
+      val roundTripUs = (hostReceivedUs - hostSentUs) - deviceTurnaroundUs
+
+      if (roundTripUs < 0) return
+
+      val offsetUs =
+        ((deviceReceivedMicros - hostSentUs) + (deviceSentMicros - hostReceivedUs)) / 2
+
+      lastRoundTripMicros = roundTripUs
+
+      samples.addLast(Sample((hostSentUs + hostReceivedUs) / 2, offsetUs, roundTripUs))
+
+      while (samples.size > window) {
+        samples.removeFirst()
+      }
+
+      fit()
+    }
+
+    /** Maps a device timestamp in microseconds onto the [System.nanoTime] timeline. */
+    public fun toHostNanos(deviceMicros: Long): Long {
+      val fit = current
+
+      // device = host + offset(host)
+      val hostUs = (deviceMicros - fit.referenceOffsetUs + fit.drift * fit.referenceHostUs) / (1 + fit.drift)
+
+      return (hostUs * 1000).toLong()
+    }
+
+    /** Maps a [System.nanoTime] value onto the device clock, e.g. for scheduled commands. */
+    public fun toDeviceMicros(hostNanos: Long): Long {
+      val fit = current
+      val hostUs = hostNanos / 1000.0
+
+      return (hostUs + fit.referenceOffsetUs + fit.drift * (hostUs - fit.referenceHostUs)).toLong()
+    }
+
+    @Synchronized
+    public fun reset() {
+      samples.clear()
+
+      current = Fit()
+      lastRoundTripMicros = Double.NaN
+    }
+
+    private fun fit() {
+      // Exchanges delayed by USB scheduling or the OS only add noise; keep the fastest quarter
+      val trusted = samples.sortedBy { it.roundTripUs }.take(maxOf(1, samples.size / 4))
+      val newest = samples.last()
+
+      var slope = 0.0
+      var referenceHostUs = trusted[0].hostMidUs
+      var referenceOffsetUs = trusted[0].offsetUs
+
+      if (trusted.size >= 2) {
+        val meanHost = trusted.sumOf { it.hostMidUs } / trusted.size
+        val meanOffset = trusted.sumOf { it.offsetUs } / trusted.size
+
+        var covariance = 0.0
+        var variance = 0.0
+
+        trusted.forEach {
+          covariance += (it.hostMidUs - meanHost) * (it.offsetUs - meanOffset)
+          variance += (it.hostMidUs - meanHost) * (it.hostMidUs - meanHost)
+        }
+
+        if (variance > 0) {
+          slope = covariance / variance
+        }
+
+        referenceHostUs = meanHost
+        referenceOffsetUs = meanOffset
+      }
+
+      val offsetAt = { hostUs: Double -> referenceOffsetUs + slope * (hostUs - referenceHostUs) }
+      val residual = trusted.maxOf { abs(it.offsetUs - offsetAt(it.hostMidUs)) }
+
+      current =
+        Fit(
+          referenceHostUs,
+          referenceOffsetUs,
+          slope,
+          offsetAt(newest.hostMidUs),
+          trusted.minOf { it.roundTripUs } / 2 + residual
+        )
+    }
+  }
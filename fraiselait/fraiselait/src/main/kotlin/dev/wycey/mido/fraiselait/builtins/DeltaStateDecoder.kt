@@ -0,0 +1,41 @@
+package dev.wycey.mido.fraiselait.builtins
+
+import java.nio.ByteBuffer
+
+/**
+ * Rebuilds full states from the device's delta samples, `mask(1) [button(1)] [light(4)] [temperature(4)]`. Fields left
+ * out of the mask keep their last value. Reset it whenever the device restarts its encoder, which then begins with a
+ * keyframe.
+ */
+internal class DeltaStateDecoder {
+  companion object {
+    const val FIELD_BUTTON = 1 shl 0
+    const val FIELD_LIGHT = 1 shl 1
+    const val FIELD_TEMPERATURE = 1 shl 2
+    const val KEYFRAME = 1 shl 7
+  }
+
+  // Null until the first keyframe
+  @Volatile
+  private var last: FraiselaitDeviceState? = null
+
+  fun reset() {
+    last = null
+  }
+
+  /** Reads one sample; null while no keyframe arrived yet. Throws [java.nio.BufferUnderflowException] if truncated. */
+  fun read(buffer: ByteBuffer): FraiselaitDeviceState? {
+    val mask = buffer.get().toInt() and 0xFF
+    val state = last?.copy() ?: FraiselaitDeviceState()
+
+    if ((mask and FIELD_BUTTON) != 0) state.buttonPressing = buffer.get().toInt() != 0
+    if ((mask and FIELD_LIGHT) != 0) state.lightStrength = buffer.int
+    if ((mask and FIELD_TEMPERATURE) != 0) state.temperature = buffer.float
+
+    if (last == null && (mask and KEYFRAME) == 0) return null
+
+    last = state
+
+    return state.copy()
+  }
+}
@@ -0,0 +1,92 @@
+package dev.wycey.mido.fraiselait.builtins
+
+import dev.wycey.mido.fraiselait.packet.Packet
+
+/**
+ * Host side of credit-based flow control. Data frames sent while the device window is spent are held, in order, until
+ * [onCreditUpdate] brings credits back. Data frames from the device are handed back once they have been handled,
+ * batched until half the host window is spent.
+ */
+internal class FlowCredits(
+  private val transmit: (Packet) -> Unit
+) {
+  private val held = ArrayDeque<Packet>()
+
+  private var txGated = false
+  private var txCredits = 0
+
+  private var rxWindow = 0
+  private var rxPending = 0
+
+  /** Data frames waiting for credit. */
+  val heldFrames: Int
+    @Synchronized get() = held.size
+
+  /** Starts a session, dropping anything held from the last one; a window of 0 leaves that direction unmetered. */
+  @Synchronized
+  fun begin(
+    txWindow: Int,
+    rxWindow: Int
+  ) {
+    held.clear()
+
+    txGated = txWindow > 0
+    txCredits = txWindow
+
+    this.rxWindow = rxWindow
+    rxPending = 0
+  }
+
+  /** Turns flow control off for a session that did not negotiate it. */
+  @Synchronized
+  fun reset() {
+    begin(0, 0)
+  }
+
+  /** Sends a Data frame now if a credit is left, otherwise holds it. */
+  @Synchronized
+  fun send(packet: Packet) {
+    if (!txGated) {
+      transmit(packet)
+
+      return
+    }
+
+    held.addLast(packet)
+
+    flush()
+  }
+
+  @Synchronized
+  fun onCreditUpdate(credits: Int) {
+    if (!txGated) return
+
+    txCredits += credits
+
+    flush()
+  }
+
+  /** Charges a handled Data frame; returns the credits to hand back now, or 0 to keep batching. */
+  @Synchronized
+  fun onDataHandled(): Int {
+    if (rxWindow == 0) return 0
+
+    rxPending++
+
+    if (rxPending < (rxWindow / 2).coerceAtLeast(1)) return 0
+
+    val credits = rxPending
+
+    rxPending = 0
+
+    return credits
+  }
+
+  private fun flush() {
+    while (txCredits > 0 && held.isNotEmpty()) {
+      txCredits--
+
+      transmit(held.removeFirst())
+    }
+  }
+}
@@ -3,12 +3,16 @@ package dev.wycey.mido.fraiselait.builtins
 import dev.wycey.mido.fraiselait.BaseSerialDevice
 import dev.wycey.mido.fraiselait.builtins.DevicePortWatcher.addShutdownHook
 import dev.wycey.mido.fraiselait.builtins.capability.BaseCapability
+import dev.wycey.mido.fraiselait.builtins.capability.FlowControlCapability
+import dev.wycey.mido.fraiselait.builtins.capability.SessionResumeCapability
 import dev.wycey.mido.fraiselait.builtins.commands.Command
 import dev.wycey.mido.fraiselait.builtins.models.Serializable
+import dev.wycey.mido.fraiselait.compression.CompressedData
 import dev.wycey.mido.fraiselait.packet.Packet
 import dev.wycey.mido.fraiselait.packet.ReservedErrorCode
 import dev.wycey.mido.fraiselait.util.VariableByteBuffer
 import jssc.SerialPortException
+import java.nio.BufferUnderflowException
 import java.nio.ByteBuffer
 import java.nio.ByteOrder
 import java.util.concurrent.atomic.AtomicReference
@@ -37,15 +41,26 @@ public class FraiselaitDevice
       private const val COMMAND_DATA_GET_IMMEDIATE: UShort = 0x0090u
       private const val COMMAND_DATA_GET_LOOP_OFF: UShort = 0x0092u
       private const val COMMAND_DATA_GET_LOOP_ON: UShort = 0x0093u
+      private const val COMMAND_DATA_STREAM_ON: UShort = 0x0094u
+      private const val COMMAND_PING: UShort = 0x0098u
+      private const val COMMAND_TIME_SYNC: UShort = 0x0099u
+      private const val COMMAND_SCHEMA: UShort = 0x00A0u
       private const val COMMAND_DATA_SET: UShort = 0x00E0u
 
       private const val RESPONSE_DATA_SEND: UShort = 0x00F0u
+      private const val RESPONSE_DATA_STREAM: UShort = 0x00F1u
+      private const val RESPONSE_DATA_DELTA: UShort = 0x00F2u
+      private const val RESPONSE_DATA_STREAM_DELTA: UShort = 0x00F3u
+      private const val RESPONSE_PONG: UShort = 0x00F6u
+      private const val RESPONSE_TIME_SYNC: UShort = 0x00F7u
+      private const val RESPONSE_SCHEMA: UShort = 0x00F9u
     }
 
     private val onStatusChangeCallbacks = mutableListOf<(ConnectionStatus) -> Unit>()
     private val onDisposeCallbacks = mutableListOf<() -> Unit>()
     private val dataCallbacks = mutableListOf<Pair<UShort, (ByteBuffer) -> Unit>>()
     private val errorCallbacks = mutableListOf<Pair<UShort, (ByteBuffer) -> Unit>>()
+    private val telemetryBatchCallbacks = mutableListOf<(TelemetryBatch) -> Unit>()
 
     private val hostCapabilities = hostCapabilities.toMutableList()
     private val backingDeviceCapabilities = mutableListOf<BaseCapability>()
@@ -63,6 +78,10 @@ public class FraiselaitDevice
 
         if (value == ConnectionStatus.NOT_CONNECTED) {
           id = null
+
+          // The device may have rebooted, restarting its clock
+          clock.reset()
+          deltaStates.reset()
         }
       }
 
@@ -70,10 +89,25 @@ public class FraiselaitDevice
     public var id: String? = null
       private set
 
+    /** Maps device timestamps onto [System.nanoTime]; fed by [syncClock]. */
+    public val clock: ClockSync = ClockSync()
+
+    /** Round trip of the last [ping], in nanoseconds. */
+    @Volatile
+    public var roundTripNanos: Long? = null
+      private set
+
+    /** Message layouts the device reported; fetched with [requestSchema]. */
+    @Volatile
+    public var schema: List<MessageSchema>? = null
+      private set
+
     internal inner class FraiselaitSerialDevice(
       serialRate: Int,
       port: String
     ) : BaseSerialDevice(serialRate, port) {
+      private val credits = FlowCredits { send(it) }
+
       override fun onRecv(packet: Packet) {
         val type = PacketType.fromCode(packet.type)
 
@@ -107,6 +141,15 @@ public class FraiselaitDevice
             debugLog("Received reserved error code: $reservedError")
           }
 
+          if (reservedError == ReservedErrorCode.SESSION_EXPIRED && status == ConnectionStatus.CONNECTING) {
+            // The device dropped the session; start a new one
+            sessionResume?.invalidate()
+
+            sendHostHello()
+
+            return
+          }
+
           errorCallbacks
             .filter {
               it.first == errorCode
@@ -121,6 +164,8 @@ public class FraiselaitDevice
 
             throw IllegalStateException("Handshake failed: $it")
           } ?: run {
+            beginFlowControl()
+
             status = ConnectionStatus.CONNECTED
 
             debugLog("Connected")
@@ -129,7 +174,17 @@ public class FraiselaitDevice
           return
         }
 
-        if (type == PacketType.DATA) {
+        if (type == PacketType.CREDIT_UPDATE) {
+          val buffer = ByteBuffer.wrap(packet.payload).order(ByteOrder.LITTLE_ENDIAN)
+
+          if (buffer.remaining() >= 2) {
+            credits.onCreditUpdate(buffer.short.toUShort().toInt())
+          }
+
+          return
+        }
+
+        if (type == PacketType.DATA || type == PacketType.COMPRESSED_DATA) {
           val buffer = ByteBuffer.wrap(packet.payload).order(ByteOrder.LITTLE_ENDIAN)
 
           if (buffer.remaining() < 2) {
@@ -141,14 +196,28 @@ public class FraiselaitDevice
           }
 
           val dataType = buffer.short.toUShort()
-          val data = ByteArray(buffer.remaining())
+          val data =
+            if (type == PacketType.COMPRESSED_DATA) {
+              CompressedData.decode(buffer)
+            } else {
+              ByteArray(buffer.remaining()).also { buffer.get(it) }
+            }
 
-          buffer.get(data)
+          if (data == null) {
+            debugLog("Received malformed compressed data packet")
 
-          dataCallbacks
-            .filter {
-              it.first == dataType
-            }.forEach { it.second(ByteBuffer.wrap(data).order(ByteOrder.LITTLE_ENDIAN)) }
+            sendError(ReservedErrorCode.MALFORMED_PACKET.code)
+          } else {
+            dataCallbacks
+              .filter {
+                it.first == dataType
+              }.forEach { it.second(ByteBuffer.wrap(data).order(ByteOrder.LITTLE_ENDIAN)) }
+          }
+
+          // The device answers pings and time syncs without spending a credit
+          if (dataType != RESPONSE_PONG && dataType != RESPONSE_TIME_SYNC) {
+            returnCredits()
+          }
 
           return
         }
@@ -188,7 +257,7 @@ public class FraiselaitDevice
         payload.putShort(dataType.toShort())
         payload.put(data)
 
-        send(Packet(PacketType.DATA.code, payload.array))
+        credits.send(Packet(PacketType.DATA.code, payload.array))
       }
 
       @JvmOverloads
@@ -268,10 +337,25 @@ public class FraiselaitDevice
         send(Packet(PacketType.HOST_HELLO.code, payload.array))
       }
 
+      fun sendSessionResume(token: Long) {
+        val payload = VariableByteBuffer(ByteOrder.LITTLE_ENDIAN)
+
+        payload.putShort(VERSION.toShort())
+        payload.putLong(token)
+
+        debugLog("Sending Session Resume")
+
+        send(Packet(PacketType.SESSION_RESUME.code, payload.array))
+      }
+
       private fun processHandshake(
         type: PacketType,
         payload: ByteArray
       ): ReservedErrorCode? {
+        if (type == PacketType.SESSION_RESUMED) {
+          return if (processSessionResumed(payload)) null else ReservedErrorCode.HANDSHAKE_NOT_COMPLETED
+        }
+
         if (type != PacketType.DEVICE_HELLO) return ReservedErrorCode.HANDSHAKE_NOT_COMPLETED
 
         if (!processDeviceHello(payload)) return ReservedErrorCode.MISSING_CAPABILITIES
@@ -291,6 +375,7 @@ public class FraiselaitDevice
         val deviceId = payload.getInt()
 
         id = String.format("%08x", deviceId)
+        sessionDeviceId = id
 
         val capabilityCount = payload.get().toInt() and 0xFF
 
@@ -322,6 +407,43 @@ public class FraiselaitDevice
         return true
       }
 
+      private fun processSessionResumed(payload: ByteArray): Boolean {
+        val payload = ByteBuffer.wrap(payload).order(ByteOrder.LITTLE_ENDIAN)
+
+        if (payload.remaining() < 8 || payload.long != sessionResume?.token) return false
+
+        // No DeviceHello this time; the device is the one the session was made with
+        id = sessionDeviceId
+
+        debugLog("Session resumed")
+
+        return true
+      }
+
+      private fun beginFlowControl() {
+        // The device meters as soon as the host asked for it, whether or not the host also reads its window
+        val capability = hostCapabilities.filterIsInstance<FlowControlCapability>().firstOrNull()
+
+        if (capability == null) {
+          credits.reset()
+        } else {
+          credits.begin(capability.deviceWindow, capability.hostWindow)
+        }
+      }
+
+      private fun returnCredits() {
+        val returned = credits.onDataHandled()
+
+        if (returned == 0) return
+
+        val payload = VariableByteBuffer(ByteOrder.LITTLE_ENDIAN)
+
+        payload.putShort(returned.toShort())
+
+        // Never metered itself, or both sides could end up waiting on each other
+        send(Packet(PacketType.CREDIT_UPDATE.code, payload.array))
+      }
+
       private fun sendHostAck() {
         debugLog("Sending Host Ack")
 
@@ -332,6 +454,12 @@ public class FraiselaitDevice
     public val deviceCapabilities: List<BaseCapability>
       get() = backingDeviceCapabilities.toList()
 
+    private val sessionResume: SessionResumeCapability?
+      get() = backingDeviceCapabilities.filterIsInstance<SessionResumeCapability>().firstOrNull()
+
+    @Volatile
+    private var sessionDeviceId: String? = null
+
     private var serial: FraiselaitSerialDevice? = null
 
     public var port: String? = if (portSelection is SerialPortSelection.Manual) portSelection.port else null
@@ -365,11 +493,16 @@ public class FraiselaitDevice
     public val state: FraiselaitDeviceState?
       get() = atomicState.get()
 
+    // The device restarts its delta encoder with each LoopOn and stream start
+    private val deltaStates = DeltaStateDecoder()
+
     public var retrieveStateForever: Boolean = false
       set(value) {
         field = value
 
         if (value) {
+          deltaStates.reset()
+
           serial?.sendData(COMMAND_DATA_GET_LOOP_ON)
         } else {
           serial?.sendData(COMMAND_DATA_GET_LOOP_OFF)
@@ -397,6 +530,39 @@ public class FraiselaitDevice
         atomicState.set(newState)
       }
 
+      onData(RESPONSE_DATA_STREAM) {
+        TelemetryBatch.parse(it)?.let(::receiveTelemetryBatch)
+      }
+
+      onData(RESPONSE_DATA_DELTA) {
+        try {
+          deltaStates.read(it)?.let(atomicState::set)
+        } catch (_: BufferUnderflowException) {
+        }
+      }
+
+      onData(RESPONSE_DATA_STREAM_DELTA) {
+        TelemetryBatch.parse(it, deltaStates::read)?.let(::receiveTelemetryBatch)
+      }
+
+      onData(RESPONSE_PONG) {
+        if (it.remaining() < 8) return@onData
+
+        roundTripNanos = System.nanoTime() - it.long
+      }
+
+      onData(RESPONSE_SCHEMA) {
+        schema = MessageSchema.parseAll(it)
+      }
+
+      onData(RESPONSE_TIME_SYNC) {
+        val receivedAt = System.nanoTime()
+
+        if (it.remaining() < 8 + 8 + 8) return@onData
+
+        clock.addSample(it.long, it.long, it.long, receivedAt)
+      }
+
       connect()
     }
 
@@ -462,14 +628,76 @@ public class FraiselaitDevice
       errorCallbacks.remove(errorCode to callback)
     }
 
+    public fun onTelemetryBatch(callback: (TelemetryBatch) -> Unit) {
+      telemetryBatchCallbacks.add(callback)
+    }
+
+    public fun removeOnTelemetryBatch(callback: (TelemetryBatch) -> Unit) {
+      telemetryBatchCallbacks.remove(callback)
+    }
+
     public fun requestState() {
       serial?.sendData(COMMAND_DATA_GET_IMMEDIATE)
     }
 
+    /**
+     * Has the device sample every [periodMicros] on a hardware timer and send [batchSize] samples at a time, up to 32.
+     * Batches land in [onTelemetryBatch] callbacks and their last sample in [state]. Setting [retrieveStateForever]
+     * stops the stream.
+     */
+    @JvmOverloads
+    public fun startStream(
+      periodMicros: Int,
+      batchSize: Int = 1
+    ) {
+      val payload =
+        ByteBuffer
+          .allocate(4 + 1)
+          .order(ByteOrder.LITTLE_ENDIAN)
+          .putInt(periodMicros)
+          .put(batchSize.toByte())
+          .array()
+
+      deltaStates.reset()
+
+      serial?.sendData(COMMAND_DATA_STREAM_ON, payload)
+    }
+
+    private fun receiveTelemetryBatch(batch: TelemetryBatch) {
+      batch.samples.lastOrNull()?.let { atomicState.set(it.state) }
+
+      telemetryBatchCallbacks.forEach { it(batch) }
+    }
+
     public fun sendCommand(command: Command) {
       serial?.sendData(COMMAND_DATA_SET, command)
     }
 
+    /** Measures the link round trip; the result lands in [roundTripNanos]. */
+    public fun ping() {
+      serial?.sendData(COMMAND_PING, hostTimestamp())
+    }
+
+    /**
+     * Runs one clock exchange with the device; the result feeds [clock]. Call it periodically,
+     * e.g. a few times per second, to keep tracking drift.
+     */
+    public fun syncClock() {
+      serial?.sendData(COMMAND_TIME_SYNC, hostTimestamp())
+    }
+
+    /** Asks the device to describe its fixed-size messages; the result lands in [schema]. */
+    public fun requestSchema() {
+      serial?.sendData(COMMAND_SCHEMA)
+    }
+
+    private fun hostTimestamp(): ByteArray =
+      ByteBuffer
+        .allocate(8)
+        .order(ByteOrder.LITTLE_ENDIAN)
+        .putLong(System.nanoTime())
+        .array()
+
     public fun connect() {
       if (status == ConnectionStatus.CONNECTED || status == ConnectionStatus.CONNECTING) {
         return
@@ -488,7 +716,15 @@ public class FraiselaitDevice
       }
 
       serial?.start()
-      serial?.sendHostHello()
+
+      // A session the device still keeps skips capability negotiation and its state reset
+      val token = sessionResume?.token ?: 0L
+
+      if (token != 0L) {
+        serial?.sendSessionResume(token)
+      } else {
+        serial?.sendHostHello()
+      }
 
       status = ConnectionStatus.CONNECTING
     }
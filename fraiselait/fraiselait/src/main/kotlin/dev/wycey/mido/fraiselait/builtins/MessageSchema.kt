@@ -0,0 +1,73 @@
+package dev.wycey.mido.fraiselait.builtins
+
+import java.nio.BufferUnderflowException
+import java.nio.ByteBuffer
+
+/** Layout of one fixed-size message, as the device describes it in response to [FraiselaitDevice.requestSchema]. */
+public data class MessageSchema(
+  /** Data type of the packet the message travels in. */
+  val code: UShort,
+  val name: String,
+  val fields: List<Field>
+) {
+  public enum class WireType(
+    internal val tag: Int,
+    public val size: Int
+  ) {
+    BOOL(0x00, 1),
+    U8(0x01, 1),
+    I8(0x02, 1),
+    U16(0x03, 2),
+    I16(0x04, 2),
+    U32(0x05, 4),
+    I32(0x06, 4),
+    U64(0x07, 8),
+    I64(0x08, 8),
+    F32(0x09, 4),
+    F64(0x0A, 8)
+  }
+
+  /** Fields are sent back to back in little endian, in list order. */
+  public data class Field(
+    val name: String,
+    val type: WireType
+  )
+
+  public val size: Int
+    get() = fields.sumOf { it.type.size }
+
+  public companion object {
+    /** Parses `count(1) count * message`; null if the description is malformed or uses unknown types. */
+    public fun parseAll(buffer: ByteBuffer): List<MessageSchema>? {
+      try {
+        val count = buffer.get().toInt() and 0xFF
+
+        return List(count) {
+          val code = buffer.short.toUShort()
+          val name = readName(buffer)
+          val fieldCount = buffer.get().toInt() and 0xFF
+
+          val fields =
+            List(fieldCount) {
+              val tag = buffer.get().toInt() and 0xFF
+              val type = WireType.entries.find { it.tag == tag } ?: return null
+
+              Field(readName(buffer), type)
+            }
+
+          MessageSchema(code, name, fields)
+        }
+      } catch (_: BufferUnderflowException) {
+        return null
+      }
+    }
+
+    private fun readName(buffer: ByteBuffer): String {
+      val bytes = ByteArray(buffer.get().toInt() and 0xFF)
+
+      buffer.get(bytes)
+
+      return String(bytes, Charsets.US_ASCII)
+    }
+  }
+}
@@ -8,7 +8,11 @@ internal enum class PacketType(
   HOST_ACK(0x0003u),
   DATA(0x0004u),
   ERROR(0x0005u),
-  DEBUG_ECHO(0x0006u)
+  DEBUG_ECHO(0x0006u),
+  COMPRESSED_DATA(0x0007u),
+  SESSION_RESUME(0x0008u),
+  SESSION_RESUMED(0x0009u),
+  CREDIT_UPDATE(0x000Au)
 
   ;
 
@@ -0,0 +1,53 @@
+package dev.wycey.mido.fraiselait.builtins
+
+import java.nio.BufferUnderflowException
+import java.nio.ByteBuffer
+
+/** One sample of a [TelemetryBatch], taken at [timestampMicros] on the device clock (see [ClockSync]). */
+public data class TimestampedState(
+  val timestampMicros: Long,
+  val state: FraiselaitDeviceState
+)
+
+/**
+ * Samples the device took at a fixed period, sent together after [FraiselaitDevice.startStream]. Batches are numbered
+ * by [sequence] from the start of the stream, and [droppedSamples] counts every sample the device had no room for since
+ * then, so a gap shows up in either. With delta telemetry, the device leaves out samples that changed nothing.
+ */
+public data class TelemetryBatch(
+  val sequence: Long,
+  val droppedSamples: Long,
+  val samples: List<TimestampedState>
+) {
+  internal companion object {
+    /**
+     * Parses `sequence(4) dropped(4) base_us(8) count(1) count * [offset_us(4) state]`; null if malformed. [readState]
+     * reads one state and may return null to leave the sample out.
+     */
+    fun parse(
+      buffer: ByteBuffer,
+      readState: (ByteBuffer) -> FraiselaitDeviceState? = ::readFullState
+    ): TelemetryBatch? {
+      try {
+        val sequence = buffer.int.toUInt().toLong()
+        val droppedSamples = buffer.int.toUInt().toLong()
+        val baseMicros = buffer.long
+        val count = buffer.get().toInt() and 0xFF
+
+        val samples =
+          List(count) {
+            val timestampMicros = baseMicros + buffer.int.toUInt().toLong()
+
+            readState(buffer)?.let { TimestampedState(timestampMicros, it) }
+          }.filterNotNull()
+
+        return TelemetryBatch(sequence, droppedSamples, samples)
+      } catch (_: BufferUnderflowException) {
+        return null
+      }
+    }
+
+    private fun readFullState(buffer: ByteBuffer): FraiselaitDeviceState =
+      FraiselaitDeviceState(buffer.get().toInt() != 0, buffer.int, buffer.float)
+  }
+}
@@ -0,0 +1,39 @@
+package dev.wycey.mido.fraiselait.builtins.capability
+
+import dev.wycey.mido.fraiselait.util.VariableByteBuffer
+import java.nio.ByteBuffer
+
+/**
+ * Lets the device send chunks of up to [maxChunkSize] payload bytes instead of the default 38.
+ * Only add this when the firmware supports it; older firmware rejects unknown capabilities.
+ */
+public class ChunkMtuCapability
+  @JvmOverloads
+  constructor(
+    public val maxChunkSize: Int = 1024
+  ) : BaseCapability {
+    override val id: Short = 0x0043
+    override val minSize: Int
+      get() = 2 + 2
+
+    /** Chunk payload size the device uses after the handshake. */
+    public var txChunkSize: Int = 38
+      private set
+
+    /** Chunk payload size the device accepts. */
+    public var rxChunkSize: Int = 38
+      private set
+
+    override fun serialize(buffer: VariableByteBuffer) {
+      buffer.putShort(maxChunkSize.toShort())
+    }
+
+    override fun deserialize(data: ByteBuffer): Boolean {
+      if (data.remaining() < minSize) return false
+
+      txChunkSize = data.short.toUShort().toInt()
+      rxChunkSize = data.short.toUShort().toInt()
+
+      return true
+    }
+  }
@@ -0,0 +1,33 @@
+package dev.wycey.mido.fraiselait.builtins.capability
+
+import dev.wycey.mido.fraiselait.compression.CompressedData
+import dev.wycey.mido.fraiselait.util.VariableByteBuffer
+import java.nio.ByteBuffer
+
+/**
+ * Lets the device send Data frames compressed; they are decoded before reaching [onData] callbacks. Add the same
+ * instance as host and device capability. Only add this when the firmware supports it; older firmware rejects unknown
+ * capabilities.
+ */
+public class CompressionCapability : BaseCapability {
+  override val id: Short = 0x0044
+  override val minSize: Int
+    get() = 1
+
+  /** Codecs the device can encode, one bit per codec, or 0 until the device reported them. */
+  @Volatile
+  public var deviceCodecs: Int = 0
+    private set
+
+  override fun serialize(buffer: VariableByteBuffer) {
+    buffer.put(CompressedData.SUPPORTED_CODECS.toByte())
+  }
+
+  override fun deserialize(data: ByteBuffer): Boolean {
+    if (data.remaining() < minSize) return false
+
+    deviceCodecs = data.get().toInt() and 0xFF
+
+    return true
+  }
+}
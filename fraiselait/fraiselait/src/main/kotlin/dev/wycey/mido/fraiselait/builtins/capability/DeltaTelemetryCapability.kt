@@ -0,0 +1,41 @@
+package dev.wycey.mido.fraiselait.builtins.capability
+
+import dev.wycey.mido.fraiselait.util.VariableByteBuffer
+import java.nio.ByteBuffer
+
+/**
+ * Has the device send only the fields that changed while it streams state. A field is resent once it moves past its
+ * deadband from the last value sent, and every [keyframeInterval] samples all fields are sent. Add the same instance
+ * as host and device capability. Only add this when the firmware supports it; older firmware rejects unknown
+ * capabilities.
+ */
+public class DeltaTelemetryCapability
+  @JvmOverloads
+  constructor(
+    public val keyframeInterval: Int = 64,
+    public val lightDeadband: Int = 0,
+    public val temperatureDeadband: Float = 0f
+  ) : BaseCapability {
+    override val id: Short = 0x0041
+    override val minSize: Int
+      get() = 1
+
+    /** Fields the device can send as deltas, one bit per field, or 0 until the device reported them. */
+    @Volatile
+    public var deviceFields: Int = 0
+      private set
+
+    override fun serialize(buffer: VariableByteBuffer) {
+      buffer.putShort(keyframeInterval.toShort())
+      buffer.putInt(lightDeadband)
+      buffer.putFloat(temperatureDeadband)
+    }
+
+    override fun deserialize(data: ByteBuffer): Boolean {
+      if (data.remaining() < minSize) return false
+
+      deviceFields = data.get().toInt() and 0xFF
+
+      return true
+    }
+  }
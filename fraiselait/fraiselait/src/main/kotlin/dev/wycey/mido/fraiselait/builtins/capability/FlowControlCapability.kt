@@ -0,0 +1,37 @@
+package dev.wycey.mido.fraiselait.builtins.capability
+
+import dev.wycey.mido.fraiselait.util.VariableByteBuffer
+import java.nio.ByteBuffer
+
+/**
+ * Enables credit-based flow control for Data frames. The device may send [hostWindow] frames before it has to wait for
+ * the host to hand credits back, and the host may send [deviceWindow] frames the same way. Add the same instance as
+ * host and device capability. Only add this when the firmware supports it; older firmware rejects unknown
+ * capabilities.
+ */
+public class FlowControlCapability
+  @JvmOverloads
+  constructor(
+    public val hostWindow: Int = 16
+  ) : BaseCapability {
+    override val id: Short = 0x0042
+    override val minSize: Int
+      get() = 2
+
+    /** Data frames the host may send before it has to wait for credits, or 0 until the device reported it. */
+    @Volatile
+    public var deviceWindow: Int = 0
+      private set
+
+    override fun serialize(buffer: VariableByteBuffer) {
+      buffer.putShort(hostWindow.toShort())
+    }
+
+    override fun deserialize(data: ByteBuffer): Boolean {
+      if (data.remaining() < minSize) return false
+
+      deviceWindow = data.short.toUShort().toInt()
+
+      return true
+    }
+  }
@@ -0,0 +1,41 @@
+package dev.wycey.mido.fraiselait.builtins.capability
+
+import dev.wycey.mido.fraiselait.util.VariableByteBuffer
+import java.nio.ByteBuffer
+
+/**
+ * Lets a reconnecting host resume its session instead of running a full handshake. The device then
+ * keeps its streaming modes and actuator state. Add the same instance as host and device capability.
+ * Only add this when the firmware supports it; older firmware rejects unknown capabilities.
+ */
+public class SessionResumeCapability : BaseCapability {
+  override val id: Short = 0x0045
+  override val minSize: Int
+    get() = 8 + 4
+
+  /** Token for the current session, or 0 if there is none to resume. */
+  @Volatile
+  public var token: Long = 0
+    private set
+
+  /** How long the device keeps a dropped session, in milliseconds. */
+  public var graceMillis: Long = 0
+    private set
+
+  override fun serialize(buffer: VariableByteBuffer) {
+  }
+
+  override fun deserialize(data: ByteBuffer): Boolean {
+    if (data.remaining() < minSize) return false
+
+    token = data.long
+    graceMillis = data.int.toUInt().toLong()
+
+    return true
+  }
+
+  /** Forgets the token, e.g. after the device refused it. */
+  public fun invalidate() {
+    token = 0
+  }
+}
@@ -25,6 +25,10 @@ public data class Command(
   override fun serialize(buffer: VariableByteBuffer) {
     buffer.put(flags.toByte())
 
+    innerObject.executeAtMicros?.let {
+      buffer.putLong(it.toLong())
+    }
+
     innerObject.waveformType?.let {
       buffer.putShort(it.code.toShort())
     }
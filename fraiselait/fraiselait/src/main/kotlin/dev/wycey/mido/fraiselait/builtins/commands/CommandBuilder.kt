@@ -7,9 +7,10 @@ public class CommandBuilder {
   internal var changeColor: Commands.ChangeColor? = null
   internal var changeLedBuiltin: Boolean? = null
   internal var tone: Commands.Tone? = null
+  internal var executeAtMicros: ULong? = null
 
   public var flags: UByte =
-    0u // LSB First, 1st=[unused], 2nd=changeWaveform, 3rd=noTone, 4th=tone, 5th=changeLedBuiltin, 6th=changeColor
+    0u // LSB First, 1st=scheduled, 2nd=changeWaveform, 3rd=noTone, 4th=tone, 5th=changeLedBuiltin, 6th=changeColor
     private set
 
   private fun setFlagFor(position: Int) {
@@ -22,6 +23,23 @@ public class CommandBuilder {
 
   private fun hasFlagFor(position: Int) = flags and ((1u shl position).toUByte()) != 0u.toUByte()
 
+  /**
+   * Applies the whole command at the given device time (microseconds since device boot) instead of on arrival.
+   */
+  public fun at(deviceTimeMicros: ULong): CommandBuilder {
+    executeAtMicros = deviceTimeMicros
+    setFlagFor(0)
+
+    return this
+  }
+
+  public fun unsetAt(): CommandBuilder {
+    executeAtMicros = null
+    unsetFlagFor(0)
+
+    return this
+  }
+
   public fun changeWaveform(type: WaveformType): CommandBuilder {
     waveformType = type
     setFlagFor(1)
@@ -122,10 +140,12 @@ public class CommandBuilder {
     val newChangeColor = other.changeColor ?: changeColor
     val newChangeLedBuiltin = other.changeLedBuiltin ?: changeLedBuiltin
     val newTone = other.tone ?: tone
+    val newExecuteAtMicros = other.executeAtMicros ?: executeAtMicros
 
     val newFlags = flags or other.flags
 
     return CommandBuilder().apply {
+      executeAtMicros = newExecuteAtMicros
       changeColor = newChangeColor
       changeLedBuiltin = newChangeLedBuiltin
       tone = newTone
@@ -0,0 +1,148 @@
+package dev.wycey.mido.fraiselait.compression
+
+import java.nio.ByteBuffer
+
+/**
+ * Decodes the body of a CompressedData frame after its data code:
+ * `codec(1) raw_size(2) [verbatim_prefix(2), Adc12Delta only] data`.
+ */
+internal object CompressedData {
+  const val CODEC_LZ: Int = 0x01
+  const val CODEC_ADC12_DELTA: Int = 0x02
+
+  /** Codecs [decode] understands, one bit per codec as in the capability. */
+  const val SUPPORTED_CODECS: Int = (1 shl CODEC_LZ) or (1 shl CODEC_ADC12_DELTA)
+
+  private const val MIN_MATCH = 4
+
+  /** Returns the original body, or null if [body] is malformed. [body] must be little endian. */
+  fun decode(body: ByteBuffer): ByteArray? {
+    if (body.remaining() < 1 + 2) return null
+
+    val codec = body.get().toInt() and 0xFF
+    val rawSize = body.short.toUShort().toInt()
+
+    return when (codec) {
+      CODEC_LZ -> decodeLz(body, rawSize)
+      CODEC_ADC12_DELTA -> {
+        if (body.remaining() < 2) return null
+
+        decodeAdc12Delta(body, rawSize, body.short.toUShort().toInt())
+      }
+      else -> null
+    }
+  }
+
+  // LZ4 block layout: token(1) [literal_length+] literals [offset(2) [match_length+]]; the last sequence has no
+  // match
+  private fun decodeLz(
+    input: ByteBuffer,
+    rawSize: Int
+  ): ByteArray? {
+    val out = ByteArray(rawSize)
+    var size = 0
+
+    // Ends with the literals-only sequence; running out of input anywhere else means the body was cut short
+    while (input.hasRemaining()) {
+      val token = input.get().toInt() and 0xFF
+      val literalLength = readLength(input, token ushr 4) ?: return null
+
+      if (literalLength > input.remaining() || literalLength > rawSize - size) return null
+
+      input.get(out, size, literalLength)
+
+      size += literalLength
+
+      if (!input.hasRemaining()) return if (size == rawSize) out else null
+
+      if (input.remaining() < 2) return null
+
+      val offset = input.short.toUShort().toInt()
+      val matchLength = (readLength(input, token and 0x0F) ?: return null) + MIN_MATCH
+
+      if (offset == 0 || offset > size || matchLength > rawSize - size) return null
+
+      // A match may overlap the bytes it produces, so it is copied one byte at a time
+      repeat(matchLength) {
+        out[size] = out[size - offset]
+
+        size++
+      }
+    }
+
+    return null
+  }
+
+  // A nibble of 15 continues in 255-saturated extension bytes
+  private fun readLength(
+    input: ByteBuffer,
+    nibble: Int
+  ): Int? {
+    if (nibble != 15) return nibble
+
+    var length = nibble
+
+    while (input.hasRemaining()) {
+      val byte = input.get().toInt() and 0xFF
+
+      length += byte
+
+      if (byte != 255) return length
+    }
+
+    return null
+  }
+
+  // The prefix verbatim, then each packed 12-bit sample pair as two zigzag varints of the difference to the previous
+  // sample, then the leftover bytes verbatim
+  private fun decodeAdc12Delta(
+    input: ByteBuffer,
+    rawSize: Int,
+    prefix: Int
+  ): ByteArray? {
+    if (prefix > rawSize || prefix > input.remaining()) return null
+
+    val out = ByteArray(rawSize)
+
+    input.get(out, 0, prefix)
+
+    val pairs = (rawSize - prefix) / 3
+    var previous = 0
+
+    for (i in 0 until pairs) {
+      val first = previous + (readZigzag(input) ?: return null)
+      val second = first + (readZigzag(input) ?: return null)
+      val at = prefix + i * 3
+
+      out[at] = first.toByte()
+      out[at + 1] = ((first shr 8 and 0x0F) or (second shl 4)).toByte()
+      out[at + 2] = (second shr 4).toByte()
+
+      previous = second
+    }
+
+    val leftover = rawSize - prefix - pairs * 3
+
+    if (input.remaining() != leftover) return null
+
+    input.get(out, rawSize - leftover, leftover)
+
+    return out
+  }
+
+  private fun readZigzag(input: ByteBuffer): Int? {
+    var value = 0
+
+    for (shift in 0..28 step 7) {
+      if (!input.hasRemaining()) return null
+
+      val byte = input.get().toInt() and 0xFF
+
+      value = value or ((byte and 0x7F) shl shift)
+
+      if ((byte and 0x80) == 0) return (value ushr 1) xor -(value and 1)
+    }
+
+    return null
+  }
+}
@@ -8,6 +8,7 @@ internal enum class ReservedErrorCode(
   UNSUPPORTED_PROTOCOL_VERSION(0x0003u),
   MISSING_CAPABILITIES(0x0004u),
   HANDSHAKE_NOT_COMPLETED(0x0005u),
+  SESSION_EXPIRED(0x0006u),
   INTERNAL_ERROR(0x00FFu)
 
   ;
@@ -0,0 +1,99 @@
+package dev.wycey.mido.fraiselait.builtins
+
+import dev.wycey.mido.fraiselait.builtins.DeltaStateDecoder.Companion.FIELD_BUTTON
+import dev.wycey.mido.fraiselait.builtins.DeltaStateDecoder.Companion.FIELD_LIGHT
+import dev.wycey.mido.fraiselait.builtins.DeltaStateDecoder.Companion.FIELD_TEMPERATURE
+import dev.wycey.mido.fraiselait.builtins.DeltaStateDecoder.Companion.KEYFRAME
+import org.junit.jupiter.api.Assertions.assertEquals
+import org.junit.jupiter.api.Assertions.assertNull
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.assertThrows
+import java.nio.BufferUnderflowException
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+class DeltaStateDecoderTest {
+  private val decoder = DeltaStateDecoder()
+  private val keyframe = KEYFRAME or FIELD_BUTTON or FIELD_LIGHT or FIELD_TEMPERATURE
+
+  private fun buffer() = ByteBuffer.allocate(64).order(ByteOrder.LITTLE_ENDIAN)
+
+  private fun ByteBuffer.putSample(
+    mask: Int,
+    state: FraiselaitDeviceState
+  ): ByteBuffer {
+    put(mask.toByte())
+
+    if ((mask and FIELD_BUTTON) != 0) put((if (state.buttonPressing) 1 else 0).toByte())
+    if ((mask and FIELD_LIGHT) != 0) putInt(state.lightStrength)
+    if ((mask and FIELD_TEMPERATURE) != 0) putFloat(state.temperature)
+
+    return this
+  }
+
+  private fun read(
+    mask: Int,
+    state: FraiselaitDeviceState
+  ): FraiselaitDeviceState? = decoder.read(buffer().putSample(mask, state).flip())
+
+  @Test
+  fun `test samples before the first keyframe are skipped`() {
+    val buffer = buffer().putSample(FIELD_LIGHT, FraiselaitDeviceState(lightStrength = 5)).flip()
+
+    assertNull(decoder.read(buffer))
+    assertEquals(0, buffer.remaining())
+  }
+
+  @Test
+  fun `test missing fields keep their last value`() {
+    read(keyframe, FraiselaitDeviceState(true, 310, 27.5f))
+
+    assertEquals(FraiselaitDeviceState(true, 320, 27.5f), read(FIELD_LIGHT, FraiselaitDeviceState(lightStrength = 320)))
+    assertEquals(FraiselaitDeviceState(false, 320, 27.5f), read(FIELD_BUTTON, FraiselaitDeviceState()))
+    assertEquals(FraiselaitDeviceState(false, 320, 27.5f), read(0, FraiselaitDeviceState()))
+  }
+
+  @Test
+  fun `test reset waits for the next keyframe`() {
+    read(keyframe, FraiselaitDeviceState(true, 310, 27.5f))
+
+    decoder.reset()
+
+    assertNull(read(FIELD_LIGHT, FraiselaitDeviceState(lightStrength = 320)))
+    assertEquals(FraiselaitDeviceState(false, 1, 2f), read(keyframe, FraiselaitDeviceState(false, 1, 2f)))
+  }
+
+  @Test
+  fun `test truncated sample throws`() {
+    val buffer = buffer().putSample(keyframe, FraiselaitDeviceState()).flip()
+
+    assertThrows<BufferUnderflowException> { decoder.read(buffer.limit(buffer.limit() - 1)) }
+  }
+
+  @Test
+  fun `test delta stream batch`() {
+    // sequence(4) dropped(4) base_us(8) count(1), then offset_us(4) and a delta sample each
+    val body =
+      buffer()
+        .putInt(7)
+        .putInt(0)
+        .putLong(1_000_000)
+        .put(2.toByte())
+        .putInt(0)
+        .putSample(keyframe, FraiselaitDeviceState(false, 310, 27.5f))
+        .putInt(3_000)
+        .putSample(FIELD_TEMPERATURE, FraiselaitDeviceState(temperature = 28f))
+        .flip()
+
+    val batch = TelemetryBatch.parse(body, decoder::read)!!
+
+    assertEquals(7L, batch.sequence)
+    assertEquals(
+      listOf(
+        TimestampedState(1_000_000, FraiselaitDeviceState(false, 310, 27.5f)),
+        TimestampedState(1_003_000, FraiselaitDeviceState(false, 310, 28f))
+      ),
+      batch.samples
+    )
+  }
+}
@@ -0,0 +1,70 @@
+package dev.wycey.mido.fraiselait.builtins
+
+import dev.wycey.mido.fraiselait.packet.Packet
+import org.junit.jupiter.api.Assertions.assertEquals
+import org.junit.jupiter.api.Test
+
+class FlowCreditsTest {
+  private val sent = mutableListOf<Int>()
+  private val credits = FlowCredits { sent.add(it.payload[0].toInt()) }
+
+  private fun data(id: Int) = Packet(PacketType.DATA.code, byteArrayOf(id.toByte()))
+
+  @Test
+  fun `test sends pass through without flow control`() {
+    credits.reset()
+
+    (1..3).forEach { credits.send(data(it)) }
+
+    assertEquals(listOf(1, 2, 3), sent)
+  }
+
+  @Test
+  fun `test sends are held when credits run out`() {
+    credits.begin(2, 16)
+
+    (1..4).forEach { credits.send(data(it)) }
+
+    assertEquals(listOf(1, 2), sent)
+    assertEquals(2, credits.heldFrames)
+  }
+
+  @Test
+  fun `test credit update resumes sending in order`() {
+    credits.begin(1, 16)
+
+    (1..4).forEach { credits.send(data(it)) }
+
+    credits.onCreditUpdate(2)
+
+    assertEquals(listOf(1, 2, 3), sent)
+    assertEquals(1, credits.heldFrames)
+
+    credits.onCreditUpdate(5)
+    credits.send(data(5))
+
+    assertEquals(listOf(1, 2, 3, 4, 5), sent)
+    assertEquals(0, credits.heldFrames)
+  }
+
+  @Test
+  fun `test a new session drops held frames`() {
+    credits.begin(1, 16)
+
+    (1..3).forEach { credits.send(data(it)) }
+
+    credits.begin(4, 16)
+    credits.onCreditUpdate(4)
+
+    assertEquals(listOf(1), sent)
+  }
+
+  @Test
+  fun `test received frames are returned in batches of half the window`() {
+    credits.begin(16, 8)
+
+    val returned = (1..8).map { credits.onDataHandled() }
+
+    assertEquals(listOf(0, 0, 0, 4, 0, 0, 0, 4), returned)
+  }
+}
@@ -0,0 +1,46 @@
+package dev.wycey.mido.fraiselait.builtins
+
+import org.junit.jupiter.api.Assertions.assertEquals
+import org.junit.jupiter.api.Assertions.assertFalse
+import org.junit.jupiter.api.Assertions.assertNull
+import org.junit.jupiter.api.Assertions.assertTrue
+import org.junit.jupiter.api.Test
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+// telemetry.bin is a ResponseDataStream body written by the native bench with --write-fixtures
+class TelemetryBatchTest {
+  private val body =
+    requireNotNull(javaClass.getResourceAsStream("/compressed/telemetry.bin")) { "Missing fixture telemetry" }
+      .use { it.readBytes() }
+
+  private fun parse(body: ByteArray): TelemetryBatch? =
+    TelemetryBatch.parse(ByteBuffer.wrap(body).order(ByteOrder.LITTLE_ENDIAN))
+
+  @Test
+  fun `test header`() {
+    val batch = parse(body)!!
+
+    assertEquals(1234L, batch.sequence)
+    assertEquals(0L, batch.droppedSamples)
+    assertEquals(32, batch.samples.size)
+  }
+
+  @Test
+  fun `test samples`() {
+    val samples = parse(body)!!.samples
+
+    assertEquals(987_654_321L, samples[0].timestampMicros)
+    assertTrue(samples.zipWithNext().all { (a, b) -> b.timestampMicros - a.timestampMicros in 998L..1002L })
+    assertFalse(samples[20].state.buttonPressing)
+    assertTrue(samples[21].state.buttonPressing)
+    assertTrue(samples.all { it.state.lightStrength in 310..312 })
+    assertTrue(samples.all { it.state.temperature == 27.4f || it.state.temperature == 27.9f })
+  }
+
+  @Test
+  fun `test truncated body is refused`() {
+    assertNull(parse(body.copyOf(body.size - 1)))
+    assertNull(parse(body.copyOf(16)))
+  }
+}
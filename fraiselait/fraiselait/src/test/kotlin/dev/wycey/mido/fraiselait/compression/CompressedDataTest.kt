@@ -0,0 +1,56 @@
+package dev.wycey.mido.fraiselait.compression
+
+import org.junit.jupiter.api.Assertions.assertArrayEquals
+import org.junit.jupiter.api.Assertions.assertNull
+import org.junit.jupiter.api.Test
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+// The fixtures are the firmware encoder's output, written by the native bench with --write-fixtures
+class CompressedDataTest {
+  private fun fixture(name: String): ByteArray =
+    requireNotNull(javaClass.getResourceAsStream("/compressed/$name.bin")) { "Missing fixture $name" }
+      .use { it.readBytes() }
+
+  private fun decode(body: ByteArray): ByteArray? =
+    CompressedData.decode(ByteBuffer.wrap(body).order(ByteOrder.LITTLE_ENDIAN))
+
+  @Test
+  fun `test lz telemetry batch`() {
+    assertArrayEquals(fixture("telemetry"), decode(fixture("telemetry.lz")))
+  }
+
+  @Test
+  fun `test lz raw block`() {
+    assertArrayEquals(fixture("raw_block"), decode(fixture("raw_block.lz")))
+  }
+
+  @Test
+  fun `test adc12 delta raw block`() {
+    assertArrayEquals(fixture("raw_block"), decode(fixture("raw_block.adc12")))
+  }
+
+  @Test
+  fun `test truncated bodies are refused`() {
+    for (name in listOf("telemetry.lz", "raw_block.lz", "raw_block.adc12")) {
+      val body = fixture(name)
+
+      assertNull(decode(body.copyOf(body.size - 1)), name)
+    }
+  }
+
+  @Test
+  fun `test unknown codec is refused`() {
+    val body = fixture("telemetry.lz")
+
+    body[0] = 0x03
+
+    assertNull(decode(body))
+  }
+
+  @Test
+  fun `test match before the start is refused`() {
+    // Token: no literals, a 4-byte match at offset 1 with nothing written yet
+    assertNull(decode(byteArrayOf(CompressedData.CODEC_LZ.toByte(), 4, 0, 0x00, 1, 0)))
+  }
+}